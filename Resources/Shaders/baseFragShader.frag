@@ -1,14 +1,33 @@
 #version 330 core
 
+//variants:
+//USE_SECOND_TEXTURE	blend texSampler2 over texSampler1
+//USE_VERTEX_COLOR	tint with the vertex color
+
 out vec4 FragColor;
 
 in vec3 vertexColor;
 in vec2 TexCoord;
 
 uniform sampler2D texSampler1;
+#ifdef USE_SECOND_TEXTURE
 uniform sampler2D texSampler2;
 
+//per-draw data, filled from a uniformRing
+layout(std140) uniform drawData
+{
+	float mixFactor;	//amount of texSampler2
+};
+#endif
+
 void main()
 {
-	FragColor = mix(texture(texSampler1, TexCoord), texture(texSampler2, TexCoord), 0.2);
+#ifdef USE_SECOND_TEXTURE
+	FragColor = mix(texture(texSampler1, TexCoord), texture(texSampler2, TexCoord), mixFactor);
+#else
+	FragColor = texture(texSampler1, TexCoord);
+#endif
+#ifdef USE_VERTEX_COLOR
+	FragColor.rgb *= vertexColor;
+#endif
 }
\ No newline at end of file
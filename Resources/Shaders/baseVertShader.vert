@@ -1,15 +1,36 @@
 #version 330 core
 
+//variants:
+//USE_INSTANCING	place, scale, rotate and tint the quad with per instance attributes
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 
+#ifdef USE_INSTANCING
+layout (location = 3) in vec4 instanceTransform;	//position xy and scale zw
+layout (location = 4) in vec2 instanceRotationLayer;	//rotation in radians and texture array layer
+layout (location = 5) in vec4 instanceColor;
+
+flat out float TexLayer;
+#endif
+
 out vec3 vertexColor;
 out vec2 TexCoord;
 
 void main()
 {
+#ifdef USE_INSTANCING
+	float sine = sin(instanceRotationLayer.x);
+	float cosine = cos(instanceRotationLayer.x);
+	vec2 scaled = aPos.xy * instanceTransform.zw;
+	vec2 rotated = vec2(scaled.x * cosine - scaled.y * sine, scaled.x * sine + scaled.y * cosine);
+	gl_Position = vec4(instanceTransform.xy + rotated, aPos.z, 1.0);
+	vertexColor = instanceColor.rgb;
+	TexLayer = instanceRotationLayer.y;
+#else
 	gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);
 	vertexColor = aColor;
+#endif
 	TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+
+//fullscreen triangle generated from the vertex index, drawn with 3 vertices and an empty vertex array
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,74 @@
+#version 330 core
+
+//variants:
+//JFA_SEED	start the flood, occupied pixels seed the distance to the occluders and free pixels the distance to the free space
+//JFA_RESOLVE	turn the nearest seeds into signed distances
+//without a variant one step of the flood is done
+
+out vec4 FragColor;
+
+uniform sampler2D seeds;	//nearest occupied pixel in xy and nearest free pixel in zw
+uniform sampler2D occupancy;	//R8 mask of the occluders
+
+uniform vec2 windowMin;	//the flood does not read pixels outside of [windowMin, windowMax)
+uniform vec2 windowMax;
+uniform float stepSize;
+uniform float maxDistance;
+
+const float farAway = 1e7;	//seed coordinate of pixels that have not found a seed yet
+
+float distanceSquared(vec2 seed, vec2 pixel)
+{
+	vec2 offset = seed - pixel;
+	return offset.x * offset.x + offset.y * offset.y;
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec2 position = vec2(pixel);
+
+#if defined(JFA_SEED)
+	bool occupied = texelFetch(occupancy, pixel, 0).r > 0.0;
+	FragColor = occupied ? vec4(position, farAway, farAway) : vec4(farAway, farAway, position);
+#elif defined(JFA_RESOLVE)
+	vec4 nearest = texelFetch(seeds, pixel, 0);
+	bool occupied = texelFetch(occupancy, pixel, 0).r > 0.0;
+
+	//half a pixel is taken off so the zero crossing lies on the edge of the occluder
+	float distance = sqrt(distanceSquared(occupied ? nearest.zw : nearest.xy, position)) - 0.5;
+	distance = min(distance, maxDistance);
+	FragColor = vec4(occupied ? -distance : distance, 0.0, 0.0, 1.0);
+#else
+	vec4 best = texelFetch(seeds, pixel, 0);
+	vec2 bestDistance = vec2(distanceSquared(best.xy, position), distanceSquared(best.zw, position));
+
+	//same order as the CPU flood, so both implementations agree on ties
+	int step = int(stepSize);
+	for (int dy = -1; dy <= 1; dy++)
+	{
+		for (int dx = -1; dx <= 1; dx++)
+		{
+			ivec2 neighbour = pixel + ivec2(dx, dy) * step;
+			if ((dx == 0 && dy == 0) || any(lessThan(vec2(neighbour), windowMin)) || any(greaterThanEqual(vec2(neighbour), windowMax)))
+			{
+				continue;
+			}
+
+			vec4 candidate = texelFetch(seeds, neighbour, 0);
+			vec2 candidateDistance = vec2(distanceSquared(candidate.xy, position), distanceSquared(candidate.zw, position));
+			if (candidateDistance.x < bestDistance.x)
+			{
+				best.xy = candidate.xy;
+				bestDistance.x = candidateDistance.x;
+			}
+			if (candidateDistance.y < bestDistance.y)
+			{
+				best.zw = candidate.zw;
+				bestDistance.y = candidateDistance.y;
+			}
+		}
+	}
+	FragColor = best;
+#endif
+}
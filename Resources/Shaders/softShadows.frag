@@ -0,0 +1,85 @@
+#version 330 core
+
+//2D lighting pass, every pixel sphere traces a shadow ray through the distance field to each light
+//the visibility is the narrowest cone around the ray that stays clear of the occluders, relative to the cone the light covers
+
+out vec4 FragColor;
+
+uniform sampler2D distanceField;	//R32F signed distances in field pixels, negative inside of the occluders
+uniform vec2 fieldSize;
+uniform vec2 viewportOrigin;
+uniform vec2 viewportSize;
+
+const int maxLights = 16;
+
+layout(std140) uniform lightData
+{
+	vec4 ambient;	//added to every pixel outside of the occluders
+	vec4 occluderColor;
+	vec4 lightPositionRadius[maxLights];	//position and radius in field pixels
+	vec4 lightColorRange[maxLights];	//color and distance at which the light has faded out
+	int lightCount;
+};
+
+//tracing constants, lightDistanceField on the CPU uses the same values
+const int maxSteps = 64;
+const float startOffset = 1.0;	//the ray starts one pixel away so it does not stop on the edge it starts next to
+const float minimumStep = 0.5;
+const float hitDistance = 0.1;
+
+float sampleField(vec2 position)
+{
+	return texture(distanceField, position / fieldSize).r;
+}
+
+float traceLight(vec2 position, int light)
+{
+	vec2 toLight = lightPositionRadius[light].xy - position;
+	float lightDistance = length(toLight);
+	float range = lightColorRange[light].w;
+	if (lightDistance >= range)
+	{
+		return 0.0;
+	}
+	float falloff = 1.0 - lightDistance / range;
+	vec2 direction = toLight / max(lightDistance, 1e-6);
+	float cone = lightPositionRadius[light].z / max(lightDistance, 1e-6);	//tangent of the half angle the light covers
+
+	float visibility = 1.0;
+	float t = startOffset;
+	float previousH = 1e20;
+	for (int step = 0; step < maxSteps && t < lightDistance; step++)
+	{
+		float h = sampleField(position + direction * t);
+		if (h < hitDistance)
+		{
+			visibility = 0.0;
+			break;
+		}
+
+		//closest approach to the occluder between this step and the last one, estimated from the two circles of clearance
+		float back = h * h / (2.0 * previousH);
+		float closest = sqrt(max(h * h - back * back, 0.0));
+		visibility = min(visibility, closest / (cone * max(t - back, 1e-6)));
+		previousH = h;
+		t += max(h, minimumStep);
+	}
+	return falloff * falloff * smoothstep(0.0, 1.0, visibility);
+}
+
+void main()
+{
+	vec2 position = (gl_FragCoord.xy - viewportOrigin) / viewportSize * fieldSize;
+	if (sampleField(position) < 0.0)	//occluders are drawn flat
+	{
+		FragColor = vec4(occluderColor.rgb, 1.0);
+		return;
+	}
+
+	vec3 color = ambient.rgb;
+	for (int light = 0; light < lightCount; light++)
+	{
+		color += lightColorRange[light].rgb * traceLight(position, light);
+	}
+	FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+//variants:
+//USE_TEXTURE_ARRAY	spriteTexture is a GL_TEXTURE_2D_ARRAY, the layer comes from the vertices
+
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec4 spriteColor;
+#ifdef USE_TEXTURE_ARRAY
+flat in float TexLayer;
+
+uniform sampler2DArray spriteTexture;
+#else
+uniform sampler2D spriteTexture;
+#endif
+
+void main()
+{
+#ifdef USE_TEXTURE_ARRAY
+	FragColor = texture(spriteTexture, vec3(TexCoord, TexLayer)) * spriteColor;
+#else
+	FragColor = texture(spriteTexture, TexCoord) * spriteColor;
+#endif
+}
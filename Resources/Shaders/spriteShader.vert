@@ -0,0 +1,24 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aLayer;
+
+out vec2 TexCoord;
+out vec4 spriteColor;
+#ifdef USE_TEXTURE_ARRAY
+flat out float TexLayer;
+#endif
+
+uniform vec2 viewSize;
+
+void main()
+{
+	gl_Position = vec4(aPos / viewSize * 2.0 - 1.0, 0.0, 1.0);	//convert pixel position into normalized device coordinates
+	TexCoord = aTexCoord;
+	spriteColor = aColor;
+#ifdef USE_TEXTURE_ARRAY
+	TexLayer = aLayer;
+#endif
+}
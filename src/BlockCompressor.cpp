@@ -0,0 +1,574 @@
+#include "BlockCompressor.h"
+#include "ShaderLoader.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static const int blockRowsPerJob = 8;
+
+static size_t blockBytes(blockFormat format)
+{
+	return format == blockFormat::bc1 ? 8 : 16;
+}
+
+size_t compressedSize(int width, int height, blockFormat format)
+{
+	if (format == blockFormat::none)
+	{
+		return (size_t)width * height * 4;
+	}
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+GLenum compressedInternalFormat(blockFormat format)
+{
+	switch (format)
+	{
+	case blockFormat::bc1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case blockFormat::bc3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return GL_RGBA8;
+	}
+}
+
+bool compressionSupported()
+{
+	return hasExtension("GL_EXT_texture_compression_s3tc");
+}
+
+static unsigned short packColor(int r, int g, int b)
+{
+	return (unsigned short)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+static void unpackColor(unsigned short color, int rgb[3])
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+//copy the texels of a block, blocks at the right and bottom edge repeat the last column and row
+static void loadBlock(const unsigned char* pixels, int width, int height, int blockX, int blockY, unsigned char block[64])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int sourceY = std::min(blockY * 4 + y, height - 1);
+		const unsigned char* row = pixels + (size_t)sourceY * width * 4;
+		if (blockX * 4 + 3 < width)
+		{
+			memcpy(block + y * 16, row + blockX * 16, 16);
+			continue;
+		}
+		for (int x = 0; x < 4; x++)
+		{
+			int sourceX = std::min(blockX * 4 + x, width - 1);
+			memcpy(block + y * 16 + x * 4, row + sourceX * 4, 4);
+		}
+	}
+}
+
+//2 bit index of every texel for the endpoints color0 >= color1, texels are projected onto the line between the endpoints
+//the four palette colors are evenly spaced on that line, so the closest projection is also the closest color
+static unsigned int colorIndices(const unsigned char block[64], unsigned short color0, unsigned short color1)
+{
+	int end0[3];
+	int end1[3];
+	unpackColor(color0, end0);
+	unpackColor(color1, end1);
+
+	int axis[3] = { end0[0] - end1[0], end0[1] - end1[1], end0[2] - end1[2] };
+	int lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	if (lengthSquared == 0)
+	{
+		return 0;	//every texel uses color0
+	}
+	float scale = 3.0f / lengthSquared;
+
+	int steps[16];	//position on the line, 0 at color1 and 3 at color0
+#ifdef BC_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i origin = _mm_setr_epi16((short)end1[0], (short)end1[1], (short)end1[2], 0, (short)end1[0], (short)end1[1], (short)end1[2], 0);
+	const __m128i direction = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], 0, (short)axis[0], (short)axis[1], (short)axis[2], 0);
+	const __m128 scaleVector = _mm_set1_ps(scale);
+	const __m128 maxStep = _mm_set1_ps(3.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		//four texels, widened to 16 bit and moved relative to color1
+		__m128i texels = _mm_loadu_si128((const __m128i*)(block + i * 16));
+		__m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), origin);
+		__m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), origin);
+
+		//partial dot products r*x+g*y and b*z per texel, then summed per texel
+		__m128 lowDots = _mm_castsi128_ps(_mm_madd_epi16(low, direction));
+		__m128 highDots = _mm_castsi128_ps(_mm_madd_epi16(high, direction));
+		__m128i redGreen = _mm_castps_si128(_mm_shuffle_ps(lowDots, highDots, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i blue = _mm_castps_si128(_mm_shuffle_ps(lowDots, highDots, _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128 dots = _mm_cvtepi32_ps(_mm_add_epi32(redGreen, blue));
+
+		__m128 step = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dots, scaleVector), _mm_setzero_ps()), maxStep);
+		_mm_storeu_si128((__m128i*)(steps + i * 4), _mm_cvtps_epi32(step));
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		const unsigned char* texel = block + i * 4;
+		int dot = (texel[0] - end1[0]) * axis[0] + (texel[1] - end1[1]) * axis[1] + (texel[2] - end1[2]) * axis[2];
+		float step = std::min(std::max(dot * scale, 0.0f), 3.0f);
+		steps[i] = (int)lrintf(step);
+	}
+#endif
+
+	//palette order of the format is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+	static const unsigned int stepIndex[4] = { 1, 3, 2, 0 };
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		indices |= stepIndex[steps[i]] << (i * 2);
+	}
+	return indices;
+}
+
+//squared error of a block encoded with the given endpoints and indices
+static int colorError(const unsigned char block[64], unsigned short color0, unsigned short color1, unsigned int indices)
+{
+	int end0[3];
+	int end1[3];
+	unpackColor(color0, end0);
+	unpackColor(color1, end1);
+
+	int palette[4][3];
+	for (int c = 0; c < 3; c++)
+	{
+		palette[0][c] = end0[c];
+		palette[1][c] = end1[c];
+		palette[2][c] = (2 * end0[c] + end1[c]) / 3;
+		palette[3][c] = (end0[c] + 2 * end1[c]) / 3;
+	}
+
+	int error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		const int* color = palette[(indices >> (i * 2)) & 3];
+		for (int c = 0; c < 3; c++)
+		{
+			int difference = block[i * 4 + c] - color[c];
+			error += difference * difference;
+		}
+	}
+	return error;
+}
+
+static void writeColorBlock(unsigned short color0, unsigned short color1, unsigned int indices, unsigned char* destination)
+{
+	memcpy(destination, &color0, 2);
+	memcpy(destination + 2, &color1, 2);
+	memcpy(destination + 4, &indices, 4);
+}
+
+static void orderEndpoints(unsigned short& color0, unsigned short& color1)
+{
+	if (color0 < color1)	//color0 > color1 selects the 4 color mode
+	{
+		std::swap(color0, color1);
+	}
+}
+
+//endpoints from the bounding box of the block, moved inwards by 1/16 of its size as the extremes are rarely hit exactly
+static void encodeColorFast(const unsigned char block[64], unsigned char* destination)
+{
+	unsigned char minColor[4];
+	unsigned char maxColor[4];
+#ifdef BC_USE_SSE2
+	__m128i row0 = _mm_loadu_si128((const __m128i*)block);
+	__m128i row1 = _mm_loadu_si128((const __m128i*)(block + 16));
+	__m128i row2 = _mm_loadu_si128((const __m128i*)(block + 32));
+	__m128i row3 = _mm_loadu_si128((const __m128i*)(block + 48));
+	__m128i minimum = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+	__m128i maximum = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+	//reduce the four texels left in each register to one
+	minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+	minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+	maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+	maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+
+	int packedMin = _mm_cvtsi128_si32(minimum);
+	int packedMax = _mm_cvtsi128_si32(maximum);
+	memcpy(minColor, &packedMin, 4);
+	memcpy(maxColor, &packedMax, 4);
+#else
+	memcpy(minColor, block, 4);
+	memcpy(maxColor, block, 4);
+	for (int i = 1; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+			maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+		}
+	}
+#endif
+
+	int low[3];
+	int high[3];
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		low[c] = minColor[c] + inset;
+		high[c] = maxColor[c] - inset;
+	}
+
+	unsigned short color0 = packColor(high[0], high[1], high[2]);
+	unsigned short color1 = packColor(low[0], low[1], low[2]);
+	orderEndpoints(color0, color1);
+	writeColorBlock(color0, color1, colorIndices(block, color0, color1), destination);
+}
+
+//endpoints on the principal axis of the texel colors, then refined once by a least squares fit to the chosen indices
+static void encodeColorHigh(const unsigned char block[64], unsigned char* destination)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] += block[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[6] = {};	//rr, rg, rb, gg, gb, bb
+	for (int i = 0; i < 16; i++)
+	{
+		float r = block[i * 4] - mean[0];
+		float g = block[i * 4 + 1] - mean[1];
+		float b = block[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	//power iteration for the direction of the largest variance
+	float axis[3] = { 0.9f, 1.0f, 0.7f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+		float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+		float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+		float length = std::max(std::max(fabsf(r), fabsf(g)), fabsf(b));
+		if (length < 1e-6f)
+		{
+			break;	//flat block, any axis works
+		}
+		axis[0] = r / length;
+		axis[1] = g / length;
+		axis[2] = b / length;
+	}
+
+	//texels with the smallest and largest projection become the endpoints
+	int minTexel = 0;
+	int maxTexel = 0;
+	float minDot = 1e30f;
+	float maxDot = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		float dot = block[i * 4] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+		if (dot < minDot)
+		{
+			minDot = dot;
+			minTexel = i;
+		}
+		if (dot > maxDot)
+		{
+			maxDot = dot;
+			maxTexel = i;
+		}
+	}
+
+	const unsigned char* high = block + maxTexel * 4;
+	const unsigned char* low = block + minTexel * 4;
+	unsigned short color0 = packColor(high[0], high[1], high[2]);
+	unsigned short color1 = packColor(low[0], low[1], low[2]);
+	orderEndpoints(color0, color1);
+	unsigned int indices = colorIndices(block, color0, color1);
+	int error = colorError(block, color0, color1, indices);
+
+	//solve for the endpoints that minimize the error of the chosen indices
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };	//weight of color0 per index
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float atx[3] = { 0.0f, 0.0f, 0.0f };
+	float btx[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float a = weights[(indices >> (i * 2)) & 3];
+		float b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < 3; c++)
+		{
+			atx[c] += a * block[i * 4 + c];
+			btx[c] += b * block[i * 4 + c];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) > 1e-6f)
+	{
+		int refined0[3];
+		int refined1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			refined0[c] = std::min(std::max((int)lrintf((atx[c] * bb - btx[c] * ab) / determinant), 0), 255);
+			refined1[c] = std::min(std::max((int)lrintf((btx[c] * aa - atx[c] * ab) / determinant), 0), 255);
+		}
+
+		unsigned short refinedColor0 = packColor(refined0[0], refined0[1], refined0[2]);
+		unsigned short refinedColor1 = packColor(refined1[0], refined1[1], refined1[2]);
+		orderEndpoints(refinedColor0, refinedColor1);
+		unsigned int refinedIndices = colorIndices(block, refinedColor0, refinedColor1);
+		if (colorError(block, refinedColor0, refinedColor1, refinedIndices) < error)
+		{
+			color0 = refinedColor0;
+			color1 = refinedColor1;
+			indices = refinedIndices;
+		}
+	}
+
+	writeColorBlock(color0, color1, indices, destination);
+}
+
+//8 alpha values interpolated between the largest and smallest alpha of the block
+static void encodeAlpha(const unsigned char block[64], unsigned char* destination)
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minAlpha = std::min(minAlpha, (int)block[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, (int)block[i * 4 + 3]);
+	}
+
+	destination[0] = (unsigned char)maxAlpha;	//alpha0 > alpha1 selects the 8 value mode
+	destination[1] = (unsigned char)minAlpha;
+
+	unsigned long long indices = 0;
+	int range = maxAlpha - minAlpha;
+	if (range > 0)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			//step 0 is alpha1 and step 7 alpha0, the steps in between are stored as index 8 - step
+			int step = ((block[i * 4 + 3] - minAlpha) * 14 + range) / (2 * range);
+			unsigned long long index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			indices |= index << (i * 3);
+		}
+	}
+	memcpy(destination + 2, &indices, 6);
+}
+
+static void compressBlockRows(const unsigned char* pixels, int width, int height, blockFormat format, compressionQuality quality, unsigned char* destination, int firstRow, int lastRow)
+{
+	int blocksX = (width + 3) / 4;
+	size_t bytes = blockBytes(format);
+	unsigned char block[64];
+
+	for (int blockY = firstRow; blockY < lastRow; blockY++)
+	{
+		unsigned char* output = destination + (size_t)blockY * blocksX * bytes;
+		for (int blockX = 0; blockX < blocksX; blockX++, output += bytes)
+		{
+			loadBlock(pixels, width, height, blockX, blockY, block);
+
+			unsigned char* colorBlock = output;
+			if (format == blockFormat::bc3)
+			{
+				encodeAlpha(block, output);
+				colorBlock += 8;
+			}
+
+			if (quality == compressionQuality::fast)
+			{
+				encodeColorFast(block, colorBlock);
+			}
+			else
+			{
+				encodeColorHigh(block, colorBlock);
+			}
+		}
+	}
+}
+
+void compressImage(const unsigned char* pixels, int width, int height, blockFormat format, compressionQuality quality, unsigned char* destination, threadPool* pool)
+{
+	if (format == blockFormat::none)
+	{
+		memcpy(destination, pixels, compressedSize(width, height, format));
+		return;
+	}
+
+	int blockRows = (height + 3) / 4;
+	if (!pool || blockRows <= blockRowsPerJob)
+	{
+		compressBlockRows(pixels, width, height, format, quality, destination, 0, blockRows);
+		return;
+	}
+
+	//blocks are independent, so every job writes its own rows
+	std::mutex doneMutex;
+	std::condition_variable done;
+	int remaining = (blockRows + blockRowsPerJob - 1) / blockRowsPerJob;
+	for (int firstRow = 0; firstRow < blockRows; firstRow += blockRowsPerJob)
+	{
+		int lastRow = std::min(firstRow + blockRowsPerJob, blockRows);
+		pool->run([&, firstRow, lastRow]()
+		{
+			compressBlockRows(pixels, width, height, format, quality, destination, firstRow, lastRow);
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			remaining--;
+			done.notify_one();	//notified under the lock, the waiting thread destroys the condition variable once it sees 0
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void decompressImage(const unsigned char* blocks, int width, int height, blockFormat format, unsigned char* pixels)
+{
+	if (format == blockFormat::none)
+	{
+		memcpy(pixels, blocks, compressedSize(width, height, format));
+		return;
+	}
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t bytes = blockBytes(format);
+
+	for (int blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksX; blockX++)
+		{
+			const unsigned char* input = blocks + ((size_t)blockY * blocksX + blockX) * bytes;
+
+			unsigned char alphas[8] = { 255, 255, 255, 255, 255, 255, 255, 255 };
+			unsigned long long alphaIndices = 0;
+			if (format == blockFormat::bc3)
+			{
+				int alpha0 = input[0];
+				int alpha1 = input[1];
+				alphas[0] = (unsigned char)alpha0;
+				alphas[1] = (unsigned char)alpha1;
+				if (alpha0 > alpha1)
+				{
+					for (int i = 2; i < 8; i++)
+					{
+						alphas[i] = (unsigned char)(((8 - i) * alpha0 + (i - 1) * alpha1) / 7);
+					}
+				}
+				else
+				{
+					for (int i = 2; i < 6; i++)
+					{
+						alphas[i] = (unsigned char)(((6 - i) * alpha0 + (i - 1) * alpha1) / 5);
+					}
+					alphas[6] = 0;
+					alphas[7] = 255;
+				}
+				memcpy(&alphaIndices, input + 2, 6);
+				input += 8;
+			}
+
+			unsigned short color0;
+			unsigned short color1;
+			unsigned int indices;
+			memcpy(&color0, input, 2);
+			memcpy(&color1, input + 2, 2);
+			memcpy(&indices, input + 4, 4);
+
+			int palette[4][4];
+			unpackColor(color0, palette[0]);
+			unpackColor(color1, palette[1]);
+			palette[0][3] = 255;
+			palette[1][3] = 255;
+			palette[2][3] = 255;
+			palette[3][3] = 255;
+			for (int c = 0; c < 3; c++)
+			{
+				if (color0 > color1 || format == blockFormat::bc3)	//the color block of BC3 always uses 4 colors
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				else
+				{
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					palette[3][c] = 0;
+				}
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int x = blockX * 4 + i % 4;
+				int y = blockY * 4 + i / 4;
+				if (x >= width || y >= height)
+				{
+					continue;
+				}
+
+				unsigned char* texel = pixels + ((size_t)y * width + x) * 4;
+				const int* color = palette[(indices >> (i * 2)) & 3];
+				texel[0] = (unsigned char)color[0];
+				texel[1] = (unsigned char)color[1];
+				texel[2] = (unsigned char)color[2];
+				texel[3] = format == blockFormat::bc3 ? alphas[(alphaIndices >> (i * 3)) & 7] : (unsigned char)color[3];
+			}
+		}
+	}
+}
+
+double imagePSNR(const unsigned char* reference, const unsigned char* pixels, int width, int height, bool compareAlpha)
+{
+	int channels = compareAlpha ? 4 : 3;
+	double squaredError = 0.0;
+	size_t texelCount = (size_t)width * height;
+	for (size_t i = 0; i < texelCount; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			double difference = (double)reference[i * 4 + c] - pixels[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanError = squaredError / ((double)texelCount * channels);
+	if (meanError == 0.0)
+	{
+		return 99.0;	//identical images
+	}
+	return 10.0 * log10(255.0 * 255.0 / meanError);
+}
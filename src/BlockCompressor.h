@@ -0,0 +1,45 @@
+#pragma once
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include "ThreadPool.h"
+
+#include <cstddef>
+
+//S3TC is an extension and not part of the generated loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//storage of texture data, the compressed formats store every 4x4 block of texels in a fixed number of bytes
+enum class blockFormat
+{
+	none,	//uncompressed RGBA8
+	bc1,	//8 bytes per block, two 565 endpoints and 2 bit indices, alpha is dropped
+	bc3	//16 bytes per block, interpolated alpha followed by a BC1 color block
+};
+
+//trade off between encoding speed and quality
+enum class compressionQuality
+{
+	fast,	//endpoints from the inset bounding box of the block
+	high	//endpoints on the principal axis of the block, refined by least squares
+};
+
+size_t compressedSize(int width, int height, blockFormat format);	//bytes of one image, partial blocks at the edges take a full block
+GLenum compressedInternalFormat(blockFormat format);	//internal format passed to glCompressedTexImage2D
+bool compressionSupported();	//check if the context can sample S3TC textures
+
+//compress an RGBA8 image into destination which has to hold compressedSize bytes, the texel indices are chosen with SSE2 if available
+//with a pool the block rows are split over its workers, this must not be called from a job running on the same pool
+void compressImage(const unsigned char* pixels, int width, int height, blockFormat format, compressionQuality quality, unsigned char* destination, threadPool* pool = NULL);
+
+void decompressImage(const unsigned char* blocks, int width, int height, blockFormat format, unsigned char* pixels);	//decode into RGBA8, used to measure the quality
+double imagePSNR(const unsigned char* reference, const unsigned char* pixels, int width, int height, bool compareAlpha);	//peak signal to noise ratio of two RGBA8 images in dB
+
+#endif // !BLOCK_COMPRESSOR_H
@@ -0,0 +1,166 @@
+#include "CommandBuffer.h"
+#include "GLState.h"
+
+#include <chrono>
+
+unsigned long long makeSortKey(unsigned int layer, unsigned int shaderIndex, unsigned int textureIndex, float depth)
+{
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	unsigned long long depthBits = (unsigned long long)(depth * 16777215.0f);
+
+	return ((unsigned long long)(layer & 0xFF) << 56) |
+		((unsigned long long)(shaderIndex & 0xFFF) << 44) |
+		((unsigned long long)(textureIndex & 0xFFFFF) << 24) |
+		depthBits;
+}
+
+commandBuffer::commandBuffer(size_t maxCommands, size_t maxUniforms) : commands(maxCommands), uniforms(maxUniforms), commandCount(0), uniformCount(0)
+{
+}
+
+drawCommand* commandBuffer::record(unsigned long long key)
+{
+	size_t index = commandCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= commands.size())
+	{
+		commandCount.fetch_sub(1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	drawCommand* command = &commands[index];
+	*command = drawCommand();
+	command->key = key;
+	return command;
+}
+
+uniformValue* commandBuffer::allocateUniforms(int count)
+{
+	size_t first = uniformCount.fetch_add(count, std::memory_order_relaxed);
+	if (first + count > uniforms.size())
+	{
+		uniformCount.fetch_sub(count, std::memory_order_relaxed);
+		return NULL;
+	}
+	return &uniforms[first];
+}
+
+size_t commandBuffer::size() const
+{
+	size_t count = commandCount.load(std::memory_order_relaxed);
+	return count < commands.size() ? count : commands.size();
+}
+
+void commandBuffer::sort()
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	size_t count = size();
+	sorted.resize(count);
+	sortScratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		sorted[i].key = commands[i].key;
+		sorted[i].index = (unsigned int)i;
+	}
+
+	//least significant digit radix sort with 8 bit digits, stable so equal keys keep their recording order
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(sorted[i].key >> shift) & 0xFF]++;
+		}
+
+		//skip digits that are the same for every key, most keys only use a few of their bits
+		if (count == 0 || histogram[(sorted[0].key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram)
+		{
+			size_t bucketSize = bucket;
+			bucket = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			sortScratch[histogram[(sorted[i].key >> shift) & 0xFF]++] = sorted[i];
+		}
+		sorted.swap(sortScratch);
+	}
+
+	lastStats.sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void commandBuffer::replay()
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	if (sorted.size() != size())	//replay in recording order if the commands were not sorted
+	{
+		sorted.resize(size());
+		for (size_t i = 0; i < sorted.size(); i++)
+		{
+			sorted[i].key = commands[i].key;
+			sorted[i].index = (unsigned int)i;
+		}
+	}
+
+	glStateCache& state = glState();
+	for (const sortEntry& entry : sorted)
+	{
+		const drawCommand& command = commands[entry.index];
+		if (!command.drawShader || command.count <= 0)
+		{
+			continue;
+		}
+
+		command.drawShader->use();
+		for (int i = 0; i < command.uniformCount; i++)
+		{
+			const uniformValue& value = command.uniforms[i];
+			switch (value.type)
+			{
+			case uniformValue::intValue:
+				command.drawShader->setInt(value.uniform, value.intData);
+				break;
+			case uniformValue::floatValue:
+				command.drawShader->setFloat(value.uniform, value.floatData[0]);
+				break;
+			case uniformValue::vec2Value:
+				command.drawShader->setVec2(value.uniform, value.floatData[0], value.floatData[1]);
+				break;
+			}
+		}
+
+		for (unsigned int unit = 0; unit < 2; unit++)
+		{
+			if (command.textures[unit] != 0)
+			{
+				state.bindTexture(unit, GL_TEXTURE_2D, command.textures[unit]);
+			}
+		}
+		if (command.blockBinding >= 0 && command.block.data)
+		{
+			state.bindBufferRange(GL_UNIFORM_BUFFER, command.blockBinding, command.block.buffer, command.block.offset, command.block.size);
+		}
+		state.setBlend(command.blend);
+		state.bindVertexArray(command.vertexArray);
+
+		glDrawElementsBaseVertex(command.mode, command.count, GL_UNSIGNED_INT, (void*)command.indexOffset, command.baseVertex);
+	}
+
+	lastStats.commands = (int)sorted.size();
+	lastStats.replayMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void commandBuffer::reset()
+{
+	commandCount.store(0, std::memory_order_relaxed);
+	uniformCount.store(0, std::memory_order_relaxed);
+	sorted.clear();
+}
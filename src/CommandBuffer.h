@@ -0,0 +1,89 @@
+#pragma once
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "ShaderLoader.h"
+#include "UniformBuffer.h"
+
+#include <atomic>
+#include <vector>
+
+//uniform value set before a draw command is replayed
+struct uniformValue
+{
+	enum valueType { intValue, floatValue, vec2Value };
+
+	uniformHandle uniform;
+	valueType type;
+	int intData;
+	float floatData[2];
+};
+
+//draw packet recorded into a commandBuffer
+struct drawCommand
+{
+	unsigned long long key = 0;	//commands are replayed in ascending key order, see makeSortKey
+	shader* drawShader = NULL;
+	unsigned int vertexArray = 0;
+	unsigned int textures[2] = { 0, 0 };	//textures bound to unit 0 and 1, 0 leaves the unit untouched
+	bool blend = false;
+	GLenum mode = GL_TRIANGLES;
+	int count = 0;	//number of indices
+	size_t indexOffset = 0;	//byte offset into the element buffer, indices are GL_UNSIGNED_INT
+	int baseVertex = 0;
+	const uniformValue* uniforms = NULL;	//allocated with commandBuffer::allocateUniforms
+	int uniformCount = 0;
+	int blockBinding = -1;	//uniform block binding point the block range is bound to, -1 for none
+	uniformAllocation block;	//block data allocated from a uniformRing
+};
+
+//build a sort key out of layer (8 bit), shader (12 bit), texture (20 bit) and depth (24 bit, clamped to [0, 1])
+//layer has the highest priority, sorting by shader and texture minimizes state changes within a layer
+unsigned long long makeSortKey(unsigned int layer, unsigned int shaderIndex, unsigned int textureIndex, float depth);
+
+//statistics of the last replay
+struct commandBufferStats
+{
+	int commands = 0;
+	double sortMilliseconds = 0.0;
+	double replayMilliseconds = 0.0;
+};
+
+//records draw commands into a frame-linear arena and replays them sorted by key
+//recording is thread safe, sorting and replay have to happen on the GL thread
+class commandBuffer
+{
+public:
+	commandBuffer(size_t maxCommands = 1 << 17, size_t maxUniforms = 1 << 18);
+
+	drawCommand* record(unsigned long long key);	//allocate command in the arena, returns NULL if the arena is full
+	uniformValue* allocateUniforms(int count);	//allocate uniform values for a command, returns NULL if the arena is full
+
+	void sort();	//radix sort all recorded commands by key
+	void replay();	//issue all commands through the state cache in sorted order
+	void reset();	//discard all commands for the next frame
+
+	size_t size() const;
+	const commandBufferStats& stats() const { return lastStats; }
+
+private:
+	//key and index of a command, sorted instead of the commands themselves
+	struct sortEntry
+	{
+		unsigned long long key;
+		unsigned int index;
+	};
+
+	std::vector<drawCommand> commands;
+	std::vector<uniformValue> uniforms;
+	std::atomic<size_t> commandCount;
+	std::atomic<size_t> uniformCount;
+
+	std::vector<sortEntry> sorted;
+	std::vector<sortEntry> sortScratch;
+	commandBufferStats lastStats;
+};
+
+#endif // !COMMAND_BUFFER_H
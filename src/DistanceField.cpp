@@ -0,0 +1,465 @@
+#include "DistanceField.h"
+#include "GLState.h"
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SDF_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static const float farAway = 1e7f;	//seed coordinate of pixels that have not found a seed yet
+static const int rowsPerBand = 16;
+
+//first step of the flood, large enough to reach seeds maxDistance away
+static int firstStep(float maxDistance, int width, int height)
+{
+	int limit = std::max(width, height);
+	int step = 1;
+	while (step < maxDistance && step < limit)
+	{
+		step *= 2;
+	}
+	return step;
+}
+
+//call rows(first, end) for bands of the rows [y0, y1), on the pool if there is one
+static void forEachBand(int y0, int y1, threadPool* pool, const std::function<void(int first, int end)>& rows)
+{
+	int bandCount = (y1 - y0 + rowsPerBand - 1) / rowsPerBand;
+	if (pool == NULL)
+	{
+		rows(y0, y1);
+		return;
+	}
+	pool->parallelFor(bandCount, [&](int band)
+	{
+		int first = y0 + band * rowsPerBand;
+		rows(first, std::min(first + rowsPerBand, y1));
+	});
+}
+
+//replace the seeds of the pixels [start, end) of row y by the seeds of the candidate row shifted by offset where those are closer
+static void takeCloserSeeds(const float* candidateX, const float* candidateY, int offset, float* seedX, float* seedY, float* bestDistance, int start, int end, float y)
+{
+	int x = start;
+#ifdef __AVX2__
+	const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 row = _mm256_set1_ps(y);
+	for (; x + 8 <= end; x += 8)
+	{
+		__m256 column = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+		__m256 nearX = _mm256_loadu_ps(candidateX + x + offset);
+		__m256 nearY = _mm256_loadu_ps(candidateY + x + offset);
+		__m256 offsetX = _mm256_sub_ps(nearX, column);
+		__m256 offsetY = _mm256_sub_ps(nearY, row);
+		__m256 distance = _mm256_add_ps(_mm256_mul_ps(offsetX, offsetX), _mm256_mul_ps(offsetY, offsetY));
+
+		__m256 best = _mm256_loadu_ps(bestDistance + x);
+		__m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+		_mm256_storeu_ps(bestDistance + x, _mm256_blendv_ps(best, distance, closer));
+		_mm256_storeu_ps(seedX + x, _mm256_blendv_ps(_mm256_loadu_ps(seedX + x), nearX, closer));
+		_mm256_storeu_ps(seedY + x, _mm256_blendv_ps(_mm256_loadu_ps(seedY + x), nearY, closer));
+	}
+#endif
+#ifdef SDF_USE_SSE2
+	const __m128 laneOffsets4 = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 row4 = _mm_set1_ps(y);
+	for (; x + 4 <= end; x += 4)
+	{
+		__m128 column = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets4);
+		__m128 nearX = _mm_loadu_ps(candidateX + x + offset);
+		__m128 nearY = _mm_loadu_ps(candidateY + x + offset);
+		__m128 offsetX = _mm_sub_ps(nearX, column);
+		__m128 offsetY = _mm_sub_ps(nearY, row4);
+		__m128 distance = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY));
+
+		__m128 best = _mm_loadu_ps(bestDistance + x);
+		__m128 closer = _mm_cmplt_ps(distance, best);
+		_mm_storeu_ps(bestDistance + x, _mm_or_ps(_mm_and_ps(closer, distance), _mm_andnot_ps(closer, best)));
+		_mm_storeu_ps(seedX + x, _mm_or_ps(_mm_and_ps(closer, nearX), _mm_andnot_ps(closer, _mm_loadu_ps(seedX + x))));
+		_mm_storeu_ps(seedY + x, _mm_or_ps(_mm_and_ps(closer, nearY), _mm_andnot_ps(closer, _mm_loadu_ps(seedY + x))));
+	}
+#endif
+	for (; x < end; x++)
+	{
+		float offsetX = candidateX[x + offset] - (float)x;
+		float offsetY = candidateY[x + offset] - y;
+		float distance = offsetX * offsetX + offsetY * offsetY;
+		if (distance < bestDistance[x])
+		{
+			bestDistance[x] = distance;
+			seedX[x] = candidateX[x + offset];
+			seedY[x] = candidateY[x + offset];
+		}
+	}
+}
+
+void rasterizeOccluders(const rayScene& scene, glm::vec2 viewMin, glm::vec2 viewMax, int width, int height, unsigned char* mask)
+{
+	std::fill(mask, mask + (size_t)width * height, (unsigned char)0);
+
+	//work in pixel units, pixel centers sit at half integers
+	glm::vec2 scale = glm::vec2((float)width, (float)height) / (viewMax - viewMin);
+	for (const rayScene::primitive& shape : scene.orderedPrimitives())
+	{
+		glm::vec2 a = (shape.a - viewMin) * scale;
+		glm::vec2 b = (shape.b - viewMin) * scale;
+		glm::vec2 radius = shape.circle ? shape.b.x * scale : glm::vec2(0.5f);
+
+		glm::vec2 boundsMin = shape.circle ? a - radius : glm::min(a, b) - radius;
+		glm::vec2 boundsMax = shape.circle ? a + radius : glm::max(a, b) + radius;
+		int x0 = std::max((int)floorf(boundsMin.x), 0);
+		int y0 = std::max((int)floorf(boundsMin.y), 0);
+		int x1 = std::min((int)ceilf(boundsMax.x), width);
+		int y1 = std::min((int)ceilf(boundsMax.y), height);
+
+		glm::vec2 edge = b - a;
+		float edgeLength2 = std::max(glm::dot(edge, edge), 1e-12f);
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				glm::vec2 center((float)x + 0.5f, (float)y + 0.5f);
+				bool covered;
+				if (shape.circle)
+				{
+					glm::vec2 offset = (center - a) / radius;	//the scale of the view may differ between the axes
+					covered = glm::dot(offset, offset) <= 1.0f;
+				}
+				else
+				{
+					float along = std::min(std::max(glm::dot(center - a, edge) / edgeLength2, 0.0f), 1.0f);
+					glm::vec2 offset = center - (a + edge * along);
+					covered = glm::dot(offset, offset) <= 0.25f;
+				}
+				if (covered)
+				{
+					mask[(size_t)y * width + x] = 255;
+				}
+			}
+		}
+	}
+}
+
+distanceField::distanceField(int width, int height, float maxDistance)
+	: fieldWidth(width), fieldHeight(height), clampDistance(maxDistance)
+{
+	size_t pixels = (size_t)width * height;
+	occupancy.assign(pixels, 0);
+	field.assign(pixels, maxDistance);
+	for (int i = 0; i < 2; i++)
+	{
+		seedX[i].resize(pixels);
+		seedY[i].resize(pixels);
+	}
+}
+
+void distanceField::generate(threadPool* pool)
+{
+	flood(false, 0, 0, fieldWidth, fieldHeight, 0, 0, fieldWidth, fieldHeight, pool);
+	flood(true, 0, 0, fieldWidth, fieldHeight, 0, 0, fieldWidth, fieldHeight, pool);
+}
+
+void distanceField::update(int x0, int y0, int x1, int y1, threadPool* pool)
+{
+	//a changed pixel can only move the clamped distance of pixels within maxDistance of it
+	//and the seeds of those are again at most maxDistance away, so the flood has to cover twice the margin
+	int margin = (int)ceilf(clampDistance) + 1;
+	int writeX0 = std::max(x0 - margin, 0);
+	int writeY0 = std::max(y0 - margin, 0);
+	int writeX1 = std::min(x1 + margin, fieldWidth);
+	int writeY1 = std::min(y1 + margin, fieldHeight);
+	if (writeX0 >= writeX1 || writeY0 >= writeY1)
+	{
+		return;
+	}
+
+	int floodX0 = std::max(writeX0 - margin, 0);
+	int floodY0 = std::max(writeY0 - margin, 0);
+	int floodX1 = std::min(writeX1 + margin, fieldWidth);
+	int floodY1 = std::min(writeY1 + margin, fieldHeight);
+	flood(false, floodX0, floodY0, floodX1, floodY1, writeX0, writeY0, writeX1, writeY1, pool);
+	flood(true, floodX0, floodY0, floodX1, floodY1, writeX0, writeY0, writeX1, writeY1, pool);
+}
+
+void distanceField::flood(bool inside, int floodX0, int floodY0, int floodX1, int floodY1, int x0, int y0, int x1, int y1, threadPool* pool)
+{
+	//seeds are the pixels the distance is measured to
+	forEachBand(floodY0, floodY1, pool, [&](int first, int end)
+	{
+		for (int y = first; y < end; y++)
+		{
+			size_t row = (size_t)y * fieldWidth;
+			for (int x = floodX0; x < floodX1; x++)
+			{
+				bool seed = (occupancy[row + x] != 0) != inside;
+				seedX[0][row + x] = seed ? (float)x : farAway;
+				seedY[0][row + x] = seed ? (float)y : farAway;
+			}
+		}
+	});
+
+	//halve the step down to 1 and finish with another step of 1, which fixes most of the pixels the plain flood gets wrong
+	int current = 0;
+	int step = firstStep(clampDistance, fieldWidth, fieldHeight);
+	bool extraStep = true;
+	while (step >= 1)
+	{
+		const float* sourceX = seedX[current].data();
+		const float* sourceY = seedY[current].data();
+		float* targetX = seedX[1 - current].data();
+		float* targetY = seedY[1 - current].data();
+
+		forEachBand(floodY0, floodY1, pool, [&](int first, int end)
+		{
+			std::vector<float> bestDistance(fieldWidth);
+			for (int y = first; y < end; y++)
+			{
+				size_t row = (size_t)y * fieldWidth;
+				for (int x = floodX0; x < floodX1; x++)
+				{
+					float offsetX = sourceX[row + x] - (float)x;
+					float offsetY = sourceY[row + x] - (float)y;
+					bestDistance[x] = offsetX * offsetX + offsetY * offsetY;
+					targetX[row + x] = sourceX[row + x];
+					targetY[row + x] = sourceY[row + x];
+				}
+
+				//neighbours in the same order as the shader, so both implementations agree on ties
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					int neighbourY = y + dy * step;
+					if (neighbourY < floodY0 || neighbourY >= floodY1)
+					{
+						continue;
+					}
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						if (dx == 0 && dy == 0)
+						{
+							continue;
+						}
+						int offset = dx * step;
+						int start = std::max(floodX0, floodX0 - offset);
+						int end = std::min(floodX1, floodX1 - offset);
+						size_t neighbourRow = (size_t)neighbourY * fieldWidth;
+						takeCloserSeeds(sourceX + neighbourRow, sourceY + neighbourRow, offset, targetX + row, targetY + row, bestDistance.data(), start, end, (float)y);
+					}
+				}
+			}
+		});
+
+		current = 1 - current;
+		if (step == 1 && extraStep)
+		{
+			extraStep = false;
+		}
+		else
+		{
+			step /= 2;
+		}
+	}
+
+	//distances are measured between pixel centers, half a pixel is taken off so the zero crossing lies on the edge of the occluder
+	const float* nearestX = seedX[current].data();
+	const float* nearestY = seedY[current].data();
+	forEachBand(y0, y1, pool, [&](int first, int end)
+	{
+		for (int y = first; y < end; y++)
+		{
+			size_t row = (size_t)y * fieldWidth;
+			for (int x = x0; x < x1; x++)
+			{
+				if ((occupancy[row + x] != 0) != inside)
+				{
+					continue;
+				}
+				float offsetX = nearestX[row + x] - (float)x;
+				float offsetY = nearestY[row + x] - (float)y;
+				float distance = std::min(sqrtf(offsetX * offsetX + offsetY * offsetY) - 0.5f, clampDistance);
+				field[row + x] = inside ? -distance : distance;
+			}
+		}
+	});
+}
+
+void distanceField::upload(unsigned int texture) const
+{
+	glState().bindTexture(0, GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, fieldWidth, fieldHeight, 0, GL_RED, GL_FLOAT, field.data());
+}
+
+gpuDistanceField::gpuDistanceField(int width, int height, float maxDistance)
+	: fieldWidth(width), fieldHeight(height), clampDistance(maxDistance),
+	seedShader("Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag", { "JFA_SEED" }),
+	floodShader("Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag"),
+	resolveShader("Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag", { "JFA_RESOLVE" })
+{
+	auto createTexture = [&](GLenum internalFormat, GLenum format, GLenum type)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glState().bindTexture(0, GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, internalFormat == GL_R32F ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, internalFormat == GL_R32F ? GL_LINEAR : GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+		return texture;
+	};
+	auto createFramebuffer = [&](unsigned int texture)
+	{
+		unsigned int framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR: distance field framebuffer is incomplete" << std::endl;
+		}
+		return framebuffer;
+	};
+
+	maskTexture = createTexture(GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+	for (int i = 0; i < 2; i++)
+	{
+		seedTextures[i] = createTexture(GL_RGBA32F, GL_RGBA, GL_FLOAT);
+		seedFramebuffers[i] = createFramebuffer(seedTextures[i]);
+	}
+	fieldTexture = createTexture(GL_R32F, GL_RED, GL_FLOAT);
+	fieldFramebuffer = createFramebuffer(fieldTexture);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &emptyVertexArray);
+
+	seedShader.use();
+	seedShader.setInt("occupancy", 0);
+	floodShader.use();
+	floodShader.setInt("seeds", 0);
+	resolveShader.use();
+	resolveShader.setInt("seeds", 0);
+	resolveShader.setInt("occupancy", 1);
+	resolveShader.setFloat("maxDistance", maxDistance);
+}
+
+gpuDistanceField::~gpuDistanceField()
+{
+	glDeleteFramebuffers(2, seedFramebuffers);
+	glDeleteFramebuffers(1, &fieldFramebuffer);
+	unsigned int textures[] = { maskTexture, seedTextures[0], seedTextures[1], fieldTexture };
+	glDeleteTextures(4, textures);
+	for (unsigned int texture : textures)
+	{
+		glState().textureDeleted(texture);
+	}
+	glDeleteVertexArrays(1, &emptyVertexArray);
+	glState().vertexArrayDeleted(emptyVertexArray);
+}
+
+void gpuDistanceField::generate(const unsigned char* mask)
+{
+	uploadMask(mask, 0, 0, fieldWidth, fieldHeight);
+	flood(0, 0, fieldWidth, fieldHeight, 0, 0, fieldWidth, fieldHeight);
+}
+
+void gpuDistanceField::update(const unsigned char* mask, int x0, int y0, int x1, int y1)
+{
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, fieldWidth);
+	y1 = std::min(y1, fieldHeight);
+	if (x0 >= x1 || y0 >= y1)
+	{
+		return;
+	}
+	uploadMask(mask, x0, y0, x1, y1);
+
+	//same margins as distanceField::update
+	int margin = (int)ceilf(clampDistance) + 1;
+	int writeX0 = std::max(x0 - margin, 0);
+	int writeY0 = std::max(y0 - margin, 0);
+	int writeX1 = std::min(x1 + margin, fieldWidth);
+	int writeY1 = std::min(y1 + margin, fieldHeight);
+	flood(std::max(writeX0 - margin, 0), std::max(writeY0 - margin, 0), std::min(writeX1 + margin, fieldWidth), std::min(writeY1 + margin, fieldHeight), writeX0, writeY0, writeX1, writeY1);
+}
+
+void gpuDistanceField::readBack(float* distances)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fieldFramebuffer);
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, fieldWidth, fieldHeight, GL_RED, GL_FLOAT, distances);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void gpuDistanceField::uploadMask(const unsigned char* mask, int x0, int y0, int x1, int y1)
+{
+	glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glState().bindTexture(0, GL_TEXTURE_2D, maskTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, fieldWidth);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RED, GL_UNSIGNED_BYTE, mask + (size_t)y0 * fieldWidth + x0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void gpuDistanceField::flood(int floodX0, int floodY0, int floodX1, int floodY1, int x0, int y0, int x1, int y1)
+{
+	//the passes only touch the flooded area, the rest of the seed buffers keeps stale data that is never read
+	glViewport(0, 0, fieldWidth, fieldHeight);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(floodX0, floodY0, floodX1 - floodX0, floodY1 - floodY0);
+	glState().setBlend(false);
+	glState().bindVertexArray(emptyVertexArray);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, seedFramebuffers[0]);
+	seedShader.use();
+	glState().bindTexture(0, GL_TEXTURE_2D, maskTexture);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	floodShader.use();
+	floodShader.setVec2("windowMin", (float)floodX0, (float)floodY0);
+	floodShader.setVec2("windowMax", (float)floodX1, (float)floodY1);
+	int current = 0;
+	int step = firstStep(clampDistance, fieldWidth, fieldHeight);
+	bool extraStep = true;
+	while (step >= 1)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, seedFramebuffers[1 - current]);
+		glState().bindTexture(0, GL_TEXTURE_2D, seedTextures[current]);
+		floodShader.setFloat("stepSize", (float)step);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		current = 1 - current;
+		if (step == 1 && extraStep)
+		{
+			extraStep = false;
+		}
+		else
+		{
+			step /= 2;
+		}
+	}
+
+	glScissor(x0, y0, x1 - x0, y1 - y0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fieldFramebuffer);
+	resolveShader.use();
+	glState().bindTexture(0, GL_TEXTURE_2D, seedTextures[current]);
+	glState().bindTexture(1, GL_TEXTURE_2D, maskTexture);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
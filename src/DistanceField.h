@@ -0,0 +1,86 @@
+#pragma once
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include "RayScene.h"
+#include "ThreadPool.h"
+#include "ShaderLoader.h"
+
+#include <vector>
+
+//mark the pixels covered by the occluders of a scene, pixels are set to 255 if their center lies inside of a circle or within half a pixel of a segment
+//viewMin and viewMax give the area of the scene covered by the mask, rows are stored bottom to top
+void rasterizeOccluders(const rayScene& scene, glm::vec2 viewMin, glm::vec2 viewMax, int width, int height, unsigned char* mask);
+
+//signed distance field of an occupancy mask built with the jump flood algorithm, positive outside and negative inside of the occluders
+//distances are in pixels and clamped to maxDistance, which bounds the number of flood steps and the area an update has to flood again
+//the nearest occluder and the nearest free pixel are flooded separately, the steps are split into bands of rows over a thread pool and use SSE2 and AVX2 if the compiler targets them
+class distanceField
+{
+public:
+	distanceField(int width, int height, float maxDistance = 64.0f);
+
+	unsigned char* mask() { return occupancy.data(); }	//non zero for occluders, change it and call generate or update
+	const unsigned char* mask() const { return occupancy.data(); }
+
+	void generate(threadPool* pool = NULL);	//flood the whole field
+	void update(int x0, int y0, int x1, int y1, threadPool* pool = NULL);	//refresh after the mask changed inside of [x0, x1) x [y0, y1), only pixels within maxDistance of it are touched
+	void upload(unsigned int texture) const;	//store the distances in an R32F texture, the texture is allocated with the size of the field
+
+	const float* distances() const { return field.data(); }	//one float per pixel, bottom row first
+	int width() const { return fieldWidth; }
+	int height() const { return fieldHeight; }
+	float maxDistance() const { return clampDistance; }
+
+private:
+	int fieldWidth;
+	int fieldHeight;
+	float clampDistance;
+	std::vector<unsigned char> occupancy;
+	std::vector<float> field;
+	std::vector<float> seedX[2];	//coordinates of the nearest seed of every pixel, ping-ponged between the steps
+	std::vector<float> seedY[2];
+
+	//flood the seeds inside of [floodX0, floodX1) x [floodY0, floodY1) and write the distances of [x0, x1) x [y0, y1)
+	//the inside pass floods from the free pixels and writes the occupied ones, the outside pass the other way around
+	void flood(bool inside, int floodX0, int floodY0, int floodX1, int floodY1, int x0, int y0, int x1, int y1, threadPool* pool);
+};
+
+//the same jump flood on the GPU, fragment shaders ping-pong the nearest seeds between two RGBA32F framebuffers
+//the nearest occluder is kept in xy and the nearest free pixel in zw, so both fields are flooded in one pass
+class gpuDistanceField
+{
+public:
+	gpuDistanceField(int width, int height, float maxDistance = 64.0f);
+	~gpuDistanceField();
+
+	void generate(const unsigned char* mask);	//upload a full mask and flood the whole field
+	void update(const unsigned char* mask, int x0, int y0, int x1, int y1);	//upload the changed area of the mask and refresh the pixels within maxDistance of it
+	void readBack(float* distances);	//copy the field into width * height floats
+
+	unsigned int texture() const { return fieldTexture; }	//R32F signed distances in pixels, same layout as distanceField
+	int width() const { return fieldWidth; }
+	int height() const { return fieldHeight; }
+
+private:
+	int fieldWidth;
+	int fieldHeight;
+	float clampDistance;
+	unsigned int maskTexture;
+	unsigned int seedTextures[2];
+	unsigned int seedFramebuffers[2];
+	unsigned int fieldTexture;
+	unsigned int fieldFramebuffer;
+	unsigned int emptyVertexArray;	//the fullscreen triangle is generated from gl_VertexID
+	shader seedShader;
+	shader floodShader;
+	shader resolveShader;
+
+	void uploadMask(const unsigned char* mask, int x0, int y0, int x1, int y1);
+	void flood(int floodX0, int floodY0, int floodX1, int floodY1, int x0, int y0, int x1, int y1);
+};
+
+#endif // !DISTANCE_FIELD_H
@@ -0,0 +1,256 @@
+#include "GLState.h"
+
+//index into the shadowed buffer bindings, -1 for targets that are not tracked
+static int bufferTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_PIXEL_PACK_BUFFER: return 2;
+	case GL_PIXEL_UNPACK_BUFFER: return 3;
+	case GL_UNIFORM_BUFFER: return 4;
+	case GL_DRAW_INDIRECT_BUFFER: return 5;
+	case GL_SHADER_STORAGE_BUFFER: return 6;
+	case GL_COPY_READ_BUFFER: return 7;
+	case GL_COPY_WRITE_BUFFER: return 8;
+	default: return -1;
+	}
+}
+
+//index into the shadowed texture bindings of a unit, -1 for targets that are not tracked
+static int textureTargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	default: return -1;
+	}
+}
+
+glStateCache::glStateCache()
+{
+	invalidate();
+}
+
+bool glStateCache::changeState(unsigned int& current, unsigned int value)
+{
+	if (current == value)
+	{
+		callCounters.elided++;
+		return false;
+	}
+	current = value;
+	callCounters.issued++;
+	return true;
+}
+
+void glStateCache::useProgram(unsigned int program)
+{
+	if (changeState(this->program, program))
+	{
+		glUseProgram(program);
+	}
+}
+
+void glStateCache::bindVertexArray(unsigned int vertexArray)
+{
+	if (changeState(this->vertexArray, vertexArray))
+	{
+		glBindVertexArray(vertexArray);
+		buffers[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = unknown;	//the element buffer binding is part of the vertex array
+	}
+}
+
+void glStateCache::bindBuffer(GLenum target, unsigned int buffer)
+{
+	int index = bufferTargetIndex(target);
+	if (index < 0)
+	{
+		callCounters.issued++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (changeState(buffers[index], buffer))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+void glStateCache::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+	if (target != GL_UNIFORM_BUFFER || index >= (unsigned int)uniformBindingCount)
+	{
+		callCounters.issued++;
+		glBindBufferRange(target, index, buffer, offset, size);
+		int targetIndex = bufferTargetIndex(target);
+		if (targetIndex >= 0)
+		{
+			buffers[targetIndex] = buffer;
+		}
+		return;
+	}
+
+	bufferRange& range = uniformRanges[index];
+	if (range.buffer == buffer && range.offset == offset && range.size == size)
+	{
+		callCounters.elided++;
+		return;
+	}
+	range.buffer = buffer;
+	range.offset = offset;
+	range.size = size;
+	buffers[bufferTargetIndex(GL_UNIFORM_BUFFER)] = buffer;
+	callCounters.issued++;
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void glStateCache::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+	int index = textureTargetIndex(target);
+	if (index < 0 || unit >= (unsigned int)textureUnitCount)
+	{
+		if (changeState(activeUnit, unit))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+		callCounters.issued++;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (textures[unit][index] == texture)
+	{
+		callCounters.elided++;
+		return;
+	}
+
+	if (changeState(activeUnit, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	changeState(textures[unit][index], texture);
+	glBindTexture(target, texture);
+}
+
+void glStateCache::setBlend(bool enabled)
+{
+	if (changeState(blend, enabled ? 1 : 0))
+	{
+		enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+	}
+}
+
+void glStateCache::setBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	if (blendSource == sourceFactor && blendDestination == destinationFactor)
+	{
+		callCounters.elided++;
+		return;
+	}
+	blendSource = sourceFactor;
+	blendDestination = destinationFactor;
+	callCounters.issued++;
+	glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void glStateCache::setDepthTest(bool enabled)
+{
+	if (changeState(depthTest, enabled ? 1 : 0))
+	{
+		enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void glStateCache::setDepthFunc(GLenum func)
+{
+	if (changeState(depthFunc, func))
+	{
+		glDepthFunc(func);
+	}
+}
+
+void glStateCache::programDeleted(unsigned int program)
+{
+	if (this->program == program)
+	{
+		this->program = unknown;
+	}
+}
+
+void glStateCache::vertexArrayDeleted(unsigned int vertexArray)
+{
+	if (this->vertexArray == vertexArray)
+	{
+		this->vertexArray = unknown;
+		buffers[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+	}
+}
+
+void glStateCache::bufferDeleted(unsigned int buffer)
+{
+	for (unsigned int& binding : buffers)
+	{
+		if (binding == buffer)
+		{
+			binding = unknown;
+		}
+	}
+	for (bufferRange& range : uniformRanges)
+	{
+		if (range.buffer == buffer)
+		{
+			range.buffer = unknown;
+		}
+	}
+}
+
+void glStateCache::textureDeleted(unsigned int texture)
+{
+	for (auto& unit : textures)
+	{
+		for (unsigned int& binding : unit)
+		{
+			if (binding == texture)
+			{
+				binding = unknown;
+			}
+		}
+	}
+}
+
+void glStateCache::invalidate()
+{
+	program = unknown;
+	vertexArray = unknown;
+	for (unsigned int& binding : buffers)
+	{
+		binding = unknown;
+	}
+	for (bufferRange& range : uniformRanges)
+	{
+		range.buffer = unknown;
+	}
+	activeUnit = unknown;
+	for (auto& unit : textures)
+	{
+		for (unsigned int& binding : unit)
+		{
+			binding = unknown;
+		}
+	}
+	blend = unknown;
+	blendSource = unknown;
+	blendDestination = unknown;
+	depthTest = unknown;
+	depthFunc = unknown;
+}
+
+glStateCache& glState()
+{
+	static glStateCache cache;
+	return cache;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+//number of GL calls that went through the state cache
+struct stateCounters
+{
+	int issued = 0;	//calls passed on to GL
+	int elided = 0;	//calls dropped because the state was already set
+};
+
+//shadows GL binding and render state and drops calls that would not change anything
+//all binds of the tracked state have to go through the cache, after changing state directly call invalidate
+class glStateCache
+{
+public:
+	glStateCache();
+
+	void useProgram(unsigned int program);
+	void bindVertexArray(unsigned int vertexArray);
+	void bindBuffer(GLenum target, unsigned int buffer);
+	void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);	//indexed binding, also changes the generic binding of target
+	void bindTexture(unsigned int unit, GLenum target, unsigned int texture);	//bind texture to a texture unit, GL_TEXTUREi is only activated if needed
+
+	void setBlend(bool enabled);
+	void setBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+	void setDepthTest(bool enabled);
+	void setDepthFunc(GLenum func);
+
+	//deleted objects have to be forgotten, GL reuses their names
+	void programDeleted(unsigned int program);
+	void vertexArrayDeleted(unsigned int vertexArray);
+	void bufferDeleted(unsigned int buffer);
+	void textureDeleted(unsigned int texture);
+
+	void invalidate();	//forget all shadowed state, the next call of every kind is issued
+
+	const stateCounters& counters() const { return callCounters; }
+	void resetCounters() { callCounters = stateCounters(); }
+
+private:
+	static const unsigned int unknown = 0xFFFFFFFF;	//state that has to be set on the next call
+	static const int bufferTargetCount = 9;
+	static const int textureTargetCount = 3;
+	static const int textureUnitCount = 32;
+	static const int uniformBindingCount = 16;
+
+	//range bound to an indexed binding point
+	struct bufferRange
+	{
+		unsigned int buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int buffers[bufferTargetCount];
+	bufferRange uniformRanges[uniformBindingCount];
+	unsigned int activeUnit;
+	unsigned int textures[textureUnitCount][textureTargetCount];
+	unsigned int blend;
+	GLenum blendSource;
+	GLenum blendDestination;
+	unsigned int depthTest;
+	GLenum depthFunc;
+
+	stateCounters callCounters;
+
+	bool changeState(unsigned int& current, unsigned int value);	//update shadowed value and count the call, returns true if the call has to be issued
+};
+
+glStateCache& glState();	//state cache of the GL context, the renderer only uses one context
+
+#endif // !GL_STATE_H
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+
+//64 bit FNV-1a hash, seed can be used to chain multiple buffers into one hash
+inline unsigned long long hashBytes(const void* data, size_t size, unsigned long long seed = 14695981039346656037ull)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+//64 bit multiply and xorshift hash, unrelated to hashBytes so data colliding in one of them is unlikely to collide in the other
+inline unsigned long long mixBytes(const void* data, size_t size, unsigned long long seed = 0x9E3779B97F4A7C15ull)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash + bytes[i]) * 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 29;
+	}
+	return hash;
+}
+
+#endif // !HASH_H
@@ -0,0 +1,267 @@
+#include "Headless.h"
+#include "GLState.h"
+#include "ShaderCache.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay headlessDisplay = EGL_NO_DISPLAY;
+static EGLContext headlessContext = EGL_NO_CONTEXT;
+#else
+#include <GLFW/glfw3.h>
+
+static GLFWwindow* headlessWindow = NULL;
+#endif
+
+bool createHeadlessContext()
+{
+#ifdef __linux__
+	//get a display that does not need a window system
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+	{
+		headlessDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (headlessDisplay == EGL_NO_DISPLAY)
+	{
+		headlessDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major;
+	EGLint minor;
+	if (headlessDisplay == EGL_NO_DISPLAY || !eglInitialize(headlessDisplay, &major, &minor))
+	{
+		std::cout << "ERROR: EGL display could not be initialized" << std::endl;
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	//same version and profile as the windowed context, no config or surface is needed with EGL_KHR_no_config_context and EGL_KHR_surfaceless_context
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	headlessContext = eglCreateContext(headlessDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+
+	if (headlessContext == EGL_NO_CONTEXT || !eglMakeCurrent(headlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, headlessContext))
+	{
+		std::cout << "ERROR: EGL context could not be created" << std::endl;
+		return false;
+	}
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))	//initalize GLAD and check if the initialisation was successful
+	{
+		std::cout << "ERROR: GLAD could not be initialized" << std::endl;
+		return false;
+	}
+	loadShaderCacheFunctions((GLADloadproc)eglGetProcAddress);
+#else
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	//Version number before dot (x.)
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);	//Version number after dot (.x)
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	//set to core profile
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);	//the window is only needed for its context
+
+	headlessWindow = glfwCreateWindow(1, 1, "SushRay2D", NULL, NULL);
+	if (headlessWindow == NULL)
+	{
+		std::cout << "ERROR: window could not be created" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(headlessWindow);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))	//initalize GLAD and check if the initialisation was successful
+	{
+		std::cout << "ERROR: GLAD could not be initialized" << std::endl;
+		return false;
+	}
+	loadShaderCacheFunctions((GLADloadproc)glfwGetProcAddress);
+	glfwSwapInterval(0);	//frames are never presented, make sure vsync can not throttle
+#endif
+	return true;
+}
+
+void destroyHeadlessContext()
+{
+#ifdef __linux__
+	if (headlessDisplay != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(headlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (headlessContext != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(headlessDisplay, headlessContext);
+		}
+		eglTerminate(headlessDisplay);
+	}
+	headlessDisplay = EGL_NO_DISPLAY;
+	headlessContext = EGL_NO_CONTEXT;
+#else
+	glfwTerminate();	//clear allocated resources
+	headlessWindow = NULL;
+#endif
+}
+
+size_t peakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;	//bytes on macOS
+#else
+	return (size_t)usage.ru_maxrss * 1024;	//kilobytes on linux
+#endif
+#endif
+}
+
+offscreenTarget::offscreenTarget(int width, int height) : width(width), height(height)
+{
+	glGenRenderbuffers(1, &colorBuff);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuff);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);	//allocate color storage
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuff);	//attach color buffer
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: offscreen framebuffer is incomplete" << std::endl;
+	}
+}
+
+offscreenTarget::~offscreenTarget()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteRenderbuffers(1, &colorBuff);
+}
+
+void offscreenTarget::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, width, height);
+}
+
+frameReadback::frameReadback(int width, int height, int ringSize, frameCallback callback) : width(width), height(height), callback(callback)
+{
+	slots.resize(ringSize > 0 ? ringSize : 1);
+	for (readbackSlot& slot : slots)
+	{
+		glGenBuffers(1, &slot.pixelBuff);
+		glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuff);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);	//allocate buffer for one frame
+	}
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+frameReadback::~frameReadback()
+{
+	for (readbackSlot& slot : slots)
+	{
+		if (slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		glDeleteBuffers(1, &slot.pixelBuff);
+		glState().bufferDeleted(slot.pixelBuff);
+	}
+}
+
+void frameReadback::readFrame(int frameIndex)
+{
+	//the ring is full, the oldest frame has to be delivered before its buffer can be reused
+	if (pendingCount == (int)slots.size())
+	{
+		deliver(slots[oldestSlot], true);
+		oldestSlot = (oldestSlot + 1) % slots.size();
+		pendingCount--;
+	}
+
+	readbackSlot& slot = slots[nextSlot];
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuff);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);	//copy into buffer, returns without waiting for the copy
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);	//signaled once the copy has finished
+	slot.frameIndex = frameIndex;
+
+	nextSlot = (nextSlot + 1) % slots.size();
+	pendingCount++;
+}
+
+void frameReadback::poll()
+{
+	while (pendingCount > 0 && deliver(slots[oldestSlot], false))
+	{
+		oldestSlot = (oldestSlot + 1) % slots.size();
+		pendingCount--;
+	}
+}
+
+void frameReadback::flush()
+{
+	while (pendingCount > 0)
+	{
+		deliver(slots[oldestSlot], true);
+		oldestSlot = (oldestSlot + 1) % slots.size();
+		pendingCount--;
+	}
+}
+
+bool frameReadback::deliver(readbackSlot& slot, bool wait)
+{
+	GLuint64 timeout = wait ? 1000000000ull : 0;	//1 second per try when waiting
+	GLenum result;
+	do
+	{
+		result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	} while (wait && result == GL_TIMEOUT_EXPIRED);
+
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuff);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+	if (pixels)
+	{
+		callback(slot.frameIndex, pixels);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		std::cout << "ERROR: readback buffer could not be mapped" << std::endl;
+	}
+	glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+//create a context without a visible window and load GL
+//uses an EGL surfaceless context on linux (works on Mesa llvmpipe without a display) and a hidden GLFW window elsewhere
+bool createHeadlessContext();
+void destroyHeadlessContext();
+
+size_t peakMemoryUsage();	//largest resident memory of the process so far in bytes, reported by the headless benchmarks
+
+//framebuffer object with a RGBA8 color attachment used as render target in headless mode
+class offscreenTarget
+{
+public:
+	unsigned int FBO;
+	unsigned int colorBuff;
+	int width;
+	int height;
+
+	offscreenTarget(int width, int height);
+	~offscreenTarget();
+	void bind();	//bind framebuffer for drawing and reading and set the viewport
+};
+
+//ring of pixel buffer objects used to read frames back asynchronously
+//the readback of a frame is only waited for once its slot gets reused, so the copy overlaps the rendering of the following frames
+class frameReadback
+{
+public:
+	typedef std::function<void(int frameIndex, const unsigned char* pixels)> frameCallback;	//pixels are RGBA8, bottom row first
+
+	frameReadback(int width, int height, int ringSize, frameCallback callback);
+	~frameReadback();
+
+	void readFrame(int frameIndex);	//start copying the bound read framebuffer into the next buffer of the ring
+	void poll();	//deliver all frames whose copy has finished without waiting
+	void flush();	//wait for and deliver all pending frames
+
+private:
+	//slot of the ring
+	struct readbackSlot
+	{
+		unsigned int pixelBuff = 0;
+		GLsync fence = 0;
+		int frameIndex = -1;
+	};
+
+	std::vector<readbackSlot> slots;
+	int width;
+	int height;
+	int nextSlot = 0;	//slot used for the next readFrame
+	int oldestSlot = 0;	//slot with the oldest pending frame
+	int pendingCount = 0;
+	frameCallback callback;
+
+	bool deliver(readbackSlot& slot, bool wait);	//map slot and hand its pixels to the callback, returns false if the copy has not finished yet
+};
+
+#endif // !HEADLESS_H
@@ -0,0 +1,156 @@
+#include "ImageDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const size_t decodeSlack = 16;
+
+//caller memory of the decode running on this thread, stb_image receives it in place of the allocation of its result
+struct decodeTarget
+{
+	unsigned char* memory = NULL;
+	size_t minimumSize = 0;	//smaller allocations are temporary buffers of the decoder
+	size_t capacity = 0;
+	bool claimed = false;	//the memory is currently handed out
+};
+
+static thread_local decodeTarget target;
+
+static void* decoderMalloc(size_t size)
+{
+	if (target.memory && !target.claimed && size >= target.minimumSize && size <= target.capacity)
+	{
+		target.claimed = true;
+		return target.memory;
+	}
+	return malloc(size);
+}
+
+static void decoderFree(void* pointer)
+{
+	if (pointer && pointer == target.memory)
+	{
+		target.claimed = false;	//the caller memory is never freed
+		return;
+	}
+	free(pointer);
+}
+
+static void* decoderRealloc(void* pointer, size_t oldSize, size_t newSize)
+{
+	if (pointer && pointer == target.memory)
+	{
+		if (newSize <= target.capacity)
+		{
+			return pointer;
+		}
+
+		//move out of the caller memory
+		void* moved = malloc(newSize);
+		if (moved)
+		{
+			memcpy(moved, pointer, oldSize);
+			target.claimed = false;
+		}
+		return moved;
+	}
+	return realloc(pointer, newSize);
+}
+
+#define STBI_MALLOC(size) decoderMalloc(size)
+#define STBI_FREE(pointer) decoderFree(pointer)
+#define STBI_REALLOC_SIZED(pointer, oldSize, newSize) decoderRealloc(pointer, oldSize, newSize)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image/stb_image.h>
+
+bool readImageInfo(const unsigned char* fileData, size_t fileSize, int channels, bool highPrecision, imageInfo& info)
+{
+	int nrChannels;	//number of color channels in the file
+	if (!stbi_info_from_memory(fileData, (int)fileSize, &info.width, &info.height, &nrChannels))
+	{
+		return false;
+	}
+
+	info.channels = channels != 0 ? channels : nrChannels;
+	info.type = pixelType::unorm8;
+	if (highPrecision && stbi_is_hdr_from_memory(fileData, (int)fileSize))
+	{
+		info.type = pixelType::float32;
+	}
+	else if (highPrecision && stbi_is_16_bit_from_memory(fileData, (int)fileSize))
+	{
+		info.type = pixelType::unorm16;
+	}
+
+	if (info.channels == 3)	//drivers store RGB textures as RGBA, expanding while decoding saves a conversion on every upload
+	{
+		info.channels = 4;
+	}
+	return true;
+}
+
+unsigned char* decodeImage(const unsigned char* fileData, size_t fileSize, const imageInfo& info, bool flipVertically)
+{
+	int width;
+	int height;
+	int nrChannels;
+	unsigned char* pixels;
+
+	stbi_set_flip_vertically_on_load_thread(flipVertically);	//flip is set per thread as other threads might decode with a different setting
+	switch (info.type)
+	{
+	case pixelType::float32:
+		pixels = (unsigned char*)stbi_loadf_from_memory(fileData, (int)fileSize, &width, &height, &nrChannels, info.channels);
+		break;
+	case pixelType::unorm16:
+		pixels = (unsigned char*)stbi_load_16_from_memory(fileData, (int)fileSize, &width, &height, &nrChannels, info.channels);
+		break;
+	default:
+		pixels = stbi_load_from_memory(fileData, (int)fileSize, &width, &height, &nrChannels, info.channels);
+		break;
+	}
+
+	if (pixels && (width != info.width || height != info.height))
+	{
+		freeImage(pixels);
+		return NULL;
+	}
+	return pixels;
+}
+
+void freeImage(const void* pixels)
+{
+	stbi_image_free((void*)pixels);
+}
+
+bool decodeImageInto(const unsigned char* fileData, size_t fileSize, const imageInfo& info, bool flipVertically, unsigned char* destination, bool* inPlace)
+{
+	target.memory = destination;
+	target.minimumSize = info.size();
+	target.capacity = decodeBufferSize(info);
+	target.claimed = false;
+
+	unsigned char* pixels = decodeImage(fileData, fileSize, info, flipVertically);
+	target = decodeTarget();
+
+	if (inPlace)
+	{
+		*inPlace = pixels == destination;
+	}
+	if (!pixels)
+	{
+		return false;
+	}
+
+	if (pixels != destination)
+	{
+		memcpy(destination, pixels, info.size());
+		freeImage(pixels);
+	}
+	return true;
+}
+
+size_t decodeBufferSize(const imageInfo& info)
+{
+	return info.size() + decodeSlack;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include "TextureFormat.h"
+
+#include <cstddef>
+
+//size and layout of an image after decoding, known before the pixels are decoded
+struct imageInfo
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;	//channels after decoding, RGB images are expanded to RGBA
+	pixelType type = pixelType::unorm8;
+
+	size_t size() const { return (size_t)width * height * pixelSize(channels, type); }
+};
+
+//read the header of an encoded image, channels 0 keeps the channels of the file and highPrecision keeps 16 bit and HDR data
+bool readImageInfo(const unsigned char* fileData, size_t fileSize, int channels, bool highPrecision, imageInfo& info);
+
+unsigned char* decodeImage(const unsigned char* fileData, size_t fileSize, const imageInfo& info, bool flipVertically);	//decode into memory allocated by the decoder, release it with freeImage
+void freeImage(const void* pixels);
+
+//decode into memory owned by the caller, e.g. a mapped GL_PIXEL_UNPACK_BUFFER, without a temporary image that has to be copied and freed
+//the destination has to hold decodeBufferSize bytes, stb_image is handed the destination when it allocates its result
+//if the decoder takes a path where that does not work the result is copied instead and inPlace is set to false
+//PNG unfiltering reads the previous row back, so mappings should be readable (GL_MAP_READ_BIT) rather than write combined
+bool decodeImageInto(const unsigned char* fileData, size_t fileSize, const imageInfo& info, bool flipVertically, unsigned char* destination, bool* inPlace = NULL);
+size_t decodeBufferSize(const imageInfo& info);	//image size plus the slack some decoders add to their allocation
+
+#endif // !IMAGE_DECODER_H
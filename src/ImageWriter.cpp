@@ -0,0 +1,196 @@
+#include "ImageWriter.h"
+
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+//lookup table for the crc used by png chunks
+static const unsigned int* crcTable()
+{
+	static unsigned int table[256];
+	static bool initialized = false;
+	if (!initialized)
+	{
+		for (unsigned int i = 0; i < 256; i++)
+		{
+			unsigned int crc = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+			}
+			table[i] = crc;
+		}
+		initialized = true;
+	}
+	return table;
+}
+
+static void appendBigEndian(std::vector<unsigned char>& buffer, unsigned int value)
+{
+	buffer.push_back((unsigned char)(value >> 24));
+	buffer.push_back((unsigned char)(value >> 16));
+	buffer.push_back((unsigned char)(value >> 8));
+	buffer.push_back((unsigned char)value);
+}
+
+//write png chunk consisting of length, type, data and crc over type and data
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+{
+	const unsigned int* table = crcTable();
+	std::vector<unsigned char> chunk;
+	appendBigEndian(chunk, (unsigned int)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+
+	unsigned int crc = 0xFFFFFFFFu;
+	for (size_t i = 4; i < chunk.size(); i++)
+	{
+		crc = table[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+	}
+	appendBigEndian(chunk, crc ^ 0xFFFFFFFFu);
+
+	file.write((const char*)chunk.data(), chunk.size());
+}
+
+bool writeRawImage(const char* path, int width, int height, const unsigned char* pixels)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	file.write((const char*)pixels, (size_t)width * height * 4);
+	return (bool)file;
+}
+
+bool writePngImage(const char* path, int width, int height, const unsigned char* pixels)
+{
+	return writePngImage(path, width, height, 4, 8, pixels);
+}
+
+bool writePngImage(const char* path, int width, int height, int channels, int bitDepth, const void* pixels)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+
+	//header: size, bit depth, color type, default compression, filter and interlace
+	const unsigned char colorTypes[4] = { 0, 4, 2, 6 };	//grey, grey alpha, RGB, RGBA
+	std::vector<unsigned char> header;
+	appendBigEndian(header, (unsigned int)width);
+	appendBigEndian(header, (unsigned int)height);
+	header.push_back((unsigned char)bitDepth);
+	header.push_back(colorTypes[channels - 1]);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	writeChunk(file, "IHDR", header);
+
+	//build scanlines top to bottom, every row starts with filter type 0
+	const unsigned char* source = (const unsigned char*)pixels;
+	size_t rowSize = (size_t)width * channels * (bitDepth / 8);
+	std::vector<unsigned char> scanlines;
+	scanlines.reserve((rowSize + 1) * height);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		scanlines.push_back(0);
+		if (bitDepth == 16)	//png stores 16 bit samples big endian
+		{
+			const unsigned short* row = (const unsigned short*)(source + rowSize * y);
+			for (size_t i = 0; i < rowSize / 2; i++)
+			{
+				scanlines.push_back((unsigned char)(row[i] >> 8));
+				scanlines.push_back((unsigned char)row[i]);
+			}
+		}
+		else
+		{
+			scanlines.insert(scanlines.end(), source + rowSize * y, source + rowSize * (y + 1));
+		}
+	}
+
+	//zlib stream made of stored deflate blocks, frames are written fast instead of small
+	std::vector<unsigned char> imageData;
+	imageData.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+	imageData.push_back(0x78);
+	imageData.push_back(0x01);
+
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = scanlines.size() - offset < 65535 ? scanlines.size() - offset : 65535;
+		bool lastBlock = offset + blockSize == scanlines.size();
+
+		imageData.push_back(lastBlock ? 1 : 0);
+		imageData.push_back((unsigned char)blockSize);
+		imageData.push_back((unsigned char)(blockSize >> 8));
+		imageData.push_back((unsigned char)~blockSize);
+		imageData.push_back((unsigned char)(~blockSize >> 8));
+		imageData.insert(imageData.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+
+		offset += blockSize;
+	} while (offset < scanlines.size());
+
+	//adler32 checksum of the uncompressed data, the modulo is only needed every 5552 bytes
+	unsigned int a = 1;
+	unsigned int b = 0;
+	for (size_t start = 0; start < scanlines.size(); start += 5552)
+	{
+		size_t end = start + 5552 < scanlines.size() ? start + 5552 : scanlines.size();
+		for (size_t i = start; i < end; i++)
+		{
+			a += scanlines[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	appendBigEndian(imageData, (b << 16) | a);
+
+	writeChunk(file, "IDAT", imageData);
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+	return (bool)file;
+}
+
+bool writeHdrImage(const char* path, int width, int height, const float* pixels)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << height << " +X " << width << "\n";
+
+	//flat scanlines top to bottom, every pixel is the mantissa of each channel and the exponent of the largest channel
+	std::vector<unsigned char> row((size_t)width * 4);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const float* pixel = pixels + ((size_t)y * width + x) * 3;
+			unsigned char* rgbe = row.data() + x * 4;
+			float largest = std::max(pixel[0], std::max(pixel[1], pixel[2]));
+			if (largest < 1e-32f)
+			{
+				rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+				continue;
+			}
+
+			int exponent;
+			float scale = frexp(largest, &exponent) * 256.0f / largest;
+			rgbe[0] = (unsigned char)(pixel[0] * scale);
+			rgbe[1] = (unsigned char)(pixel[1] * scale);
+			rgbe[2] = (unsigned char)(pixel[2] * scale);
+			rgbe[3] = (unsigned char)(exponent + 128);
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+	return (bool)file;
+}
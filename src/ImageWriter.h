@@ -0,0 +1,11 @@
+#pragma once
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+//image writers, rows are expected bottom to top as returned by glReadPixels
+bool writeRawImage(const char* path, int width, int height, const unsigned char* pixels);	//write plain RGBA bytes without header
+bool writePngImage(const char* path, int width, int height, const unsigned char* pixels);	//write uncompressed RGBA png
+bool writePngImage(const char* path, int width, int height, int channels, int bitDepth, const void* pixels);	//write uncompressed grey, grey alpha, RGB or RGBA png with 8 or 16 bit channels in native byte order
+bool writeHdrImage(const char* path, int width, int height, const float* pixels);	//write RGB floats as uncompressed Radiance HDR, precision is reduced to a shared 8 bit exponent
+
+#endif // !IMAGE_WRITER_H
@@ -0,0 +1,230 @@
+#include "IndirectBatch.h"
+#include "GLState.h"
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+//map a range of the buffer bound to target for writing without waiting for the GPU, the caller makes sure the range is not in use
+static void* mapRange(GLenum target, size_t offset, size_t size)
+{
+	return glMapBufferRange(target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+indirectBatch::indirectBatch(const vertexFormat& format, size_t maxVertices, size_t maxIndices, int maxDraws, unsigned int firstInstanceLocation) : meshFormat(format), maxVertices(maxVertices), maxIndices(maxIndices), maxDraws(maxDraws)
+{
+	multiDraw = GLAD_GL_VERSION_4_3 != 0;
+
+	//per draw data has the layout of the instanceBatch instance stream
+	drawDataFormat.add(firstInstanceLocation, 4, attribType::float32).add(firstInstanceLocation + 1, 2, attribType::float32).add(firstInstanceLocation + 2, 4, attribType::unorm8).setDivisor(1);
+
+	size_t drawDataSize = (size_t)segmentCount * maxDraws * sizeof(quadInstance);
+	size_t commandSize = (size_t)segmentCount * maxDraws * sizeof(drawElementsIndirectCommand);
+
+	glGenVertexArrays(1, &VAO);
+	glState().bindVertexArray(VAO);
+
+	//create shared vertex and elemental buffer objects
+	glGenBuffers(1, &vertexBuff);
+	glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);
+	glBufferData(GL_ARRAY_BUFFER, maxVertices * meshFormat.stride(), NULL, GL_STATIC_DRAW);
+	meshFormat.apply();
+
+	glGenBuffers(1, &elementBuff);
+	glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuff);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+	//create per draw data and indirect buffer objects, mapped once and kept mapped if possible
+	glGenBuffers(1, &drawDataBuff);
+	glGenBuffers(1, &indirectBuff);
+	glState().bindBuffer(GL_ARRAY_BUFFER, drawDataBuff);
+
+	if (GLAD_GL_VERSION_4_4)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, drawDataSize, NULL, flags);
+		mappedDrawData = (quadInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, drawDataSize, flags);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, drawDataSize, NULL, GL_STREAM_DRAW);
+	}
+	drawDataFormat.apply();
+
+	if (multiDraw)	//GL_DRAW_INDIRECT_BUFFER does not exist before GL 4.0
+	{
+		glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuff);
+		if (GLAD_GL_VERSION_4_4)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_DRAW_INDIRECT_BUFFER, commandSize, NULL, flags);
+			mappedCommands = (drawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, commandSize, flags);
+		}
+		else
+		{
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commandSize, NULL, GL_STREAM_DRAW);
+		}
+	}
+}
+
+indirectBatch::~indirectBatch()
+{
+	for (GLsync fence : segmentFences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (mappedDrawData)
+	{
+		glState().bindBuffer(GL_ARRAY_BUFFER, drawDataBuff);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	if (mappedCommands)
+	{
+		glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuff);
+		glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+	}
+
+	glDeleteVertexArrays(1, &VAO);
+	unsigned int buffers[] = { vertexBuff, elementBuff, drawDataBuff, indirectBuff };
+	glDeleteBuffers(4, buffers);
+	glState().vertexArrayDeleted(VAO);
+	for (unsigned int buffer : buffers)
+	{
+		glState().bufferDeleted(buffer);
+	}
+}
+
+meshRange indirectBatch::addMesh(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	meshRange mesh;
+	if (this->vertexCount + vertexCount > maxVertices || this->indexCount + indexCount > maxIndices)
+	{
+		std::cout << "ERROR: indirect batch is out of mesh memory" << std::endl;
+		return mesh;
+	}
+
+	//indices stay relative to the mesh, the base vertex of the draw moves them to the vertices of the mesh
+	glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);
+	glBufferSubData(GL_ARRAY_BUFFER, this->vertexCount * meshFormat.stride(), vertexCount * meshFormat.stride(), vertices);
+	glState().bindVertexArray(VAO);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, this->indexCount * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+
+	mesh.firstIndex = (unsigned int)this->indexCount;
+	mesh.indexCount = (unsigned int)indexCount;
+	mesh.baseVertex = (int)this->vertexCount;
+
+	this->vertexCount += vertexCount;
+	this->indexCount += indexCount;
+	return mesh;
+}
+
+void indirectBatch::begin(shader& program)
+{
+	this->program = &program;
+	frameStats = indirectBatchStats();
+}
+
+void indirectBatch::draw(const meshRange& mesh, const quadInstance& drawData)
+{
+	if ((int)queuedCommands.size() == maxDraws)	//segment is full
+	{
+		flush();
+	}
+
+	drawElementsIndirectCommand command;
+	command.count = mesh.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = (unsigned int)((size_t)segment * maxDraws + queuedCommands.size());	//index of the per draw data in the whole buffer
+	queuedCommands.push_back(command);
+	queuedDrawData.push_back(drawData);
+}
+
+void indirectBatch::end()
+{
+	flush();
+	lastStats = frameStats;
+}
+
+void indirectBatch::flush()
+{
+	if (queuedCommands.empty())
+	{
+		return;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	//wait until the GPU has finished reading this segment
+	if (segmentFences[segment])
+	{
+		glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(segmentFences[segment]);
+		segmentFences[segment] = 0;
+	}
+
+	size_t firstDraw = (size_t)segment * maxDraws;
+	size_t drawCount = queuedCommands.size();
+
+	//write per draw data
+	glState().bindBuffer(GL_ARRAY_BUFFER, drawDataBuff);
+	quadInstance* drawData = mappedDrawData ? mappedDrawData + firstDraw : (quadInstance*)mapRange(GL_ARRAY_BUFFER, firstDraw * sizeof(quadInstance), drawCount * sizeof(quadInstance));
+	memcpy(drawData, queuedDrawData.data(), drawCount * sizeof(quadInstance));
+	if (!mappedDrawData)
+	{
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	glState().bindVertexArray(VAO);
+	program->use();
+
+	if (multiDraw)
+	{
+		//write records and draw everything with one call
+		glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuff);
+		drawElementsIndirectCommand* commands = mappedCommands ? mappedCommands + firstDraw : (drawElementsIndirectCommand*)mapRange(GL_DRAW_INDIRECT_BUFFER, firstDraw * sizeof(drawElementsIndirectCommand), drawCount * sizeof(drawElementsIndirectCommand));
+		memcpy(commands, queuedCommands.data(), drawCount * sizeof(drawElementsIndirectCommand));
+		if (!mappedCommands)
+		{
+			glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+		}
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(firstDraw * sizeof(drawElementsIndirectCommand)), (GLsizei)drawCount, 0);
+		frameStats.submits++;
+	}
+	else
+	{
+		//draw the records one by one, without base instance (GL 4.2) the per draw data pointers are moved to each record
+		for (const drawElementsIndirectCommand& command : queuedCommands)
+		{
+			if (GLAD_GL_VERSION_4_2)
+			{
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned int)), 1, command.baseVertex, command.baseInstance);
+			}
+			else
+			{
+				glState().bindBuffer(GL_ARRAY_BUFFER, drawDataBuff);
+				drawDataFormat.apply(command.baseInstance * sizeof(quadInstance));
+				glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned int)), command.baseVertex);
+			}
+		}
+		if (!GLAD_GL_VERSION_4_2)
+		{
+			drawDataFormat.apply();
+		}
+		frameStats.submits += (int)drawCount;
+	}
+
+	segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);	//signaled once the GPU is done with this segment
+	segment = (segment + 1) % segmentCount;
+
+	frameStats.draws += (int)drawCount;
+	frameStats.flushMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	queuedCommands.clear();
+	queuedDrawData.clear();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef INDIRECT_BATCH_H
+#define INDIRECT_BATCH_H
+
+#include <glad/glad.h>
+
+#include "ShaderLoader.h"
+#include "VertexFormat.h"
+#include "InstanceBatch.h"
+
+#include <vector>
+
+//mesh packed into the shared buffers of an indirectBatch
+struct meshRange
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	int baseVertex = 0;
+};
+
+//statistics of the last frame
+struct indirectBatchStats
+{
+	int draws = 0;
+	int submits = 0;	//GL draw calls issued for all draws
+	double flushMilliseconds = 0.0;	//CPU time spent writing records and issuing draws
+};
+
+//draws many different meshes with one glMultiDrawElementsIndirect
+//all meshes share one vertex and one index buffer, every draw gets a record in the indirect buffer and a quadInstance as per draw data
+//the base instance of a record points at its per draw data, so shaders read it through the divisor 1 instance stream like with instanceBatch
+//without GL 4.3 the records are drawn one by one
+class indirectBatch
+{
+public:
+	//mesh vertices use format, per draw data uses firstInstanceLocation to firstInstanceLocation + 2
+	indirectBatch(const vertexFormat& format, size_t maxVertices, size_t maxIndices, int maxDraws = 65536, unsigned int firstInstanceLocation = 3);
+	~indirectBatch();
+
+	meshRange addMesh(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);	//copy mesh into the shared buffers, vertices have to be in the format of the batch
+
+	void begin(shader& program);	//start collecting draws
+	void draw(const meshRange& mesh, const quadInstance& drawData);	//queue draw, flushes automatically if the current segment is full
+	void end();	//draw all queued draws
+
+	unsigned int vertexArray() const { return VAO; }
+	bool multiDrawSupported() const { return multiDraw; }
+	const indirectBatchStats& stats() const { return lastStats; }
+
+private:
+	//record layout read by glMultiDrawElementsIndirect
+	struct drawElementsIndirectCommand
+	{
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	static const int segmentCount = 3;
+
+	vertexFormat meshFormat;
+	vertexFormat drawDataFormat;
+	size_t maxVertices;
+	size_t maxIndices;
+	int maxDraws;	//capacity of one segment
+	size_t vertexCount = 0;	//vertices used in the vertex buffer
+	size_t indexCount = 0;	//indices used in the index buffer
+	bool multiDraw;	//true if glMultiDrawElementsIndirect is available
+
+	unsigned int VAO;
+	unsigned int vertexBuff;
+	unsigned int elementBuff;
+	unsigned int drawDataBuff;
+	unsigned int indirectBuff;
+	quadInstance* mappedDrawData = NULL;	//persistent mappings of the whole per draw buffers, NULL if buffer storage is not supported
+	drawElementsIndirectCommand* mappedCommands = NULL;
+	GLsync segmentFences[segmentCount] = {};
+	int segment = 0;	//segment written by the next flush
+
+	shader* program = NULL;
+	std::vector<drawElementsIndirectCommand> queuedCommands;
+	std::vector<quadInstance> queuedDrawData;
+	indirectBatchStats frameStats;
+	indirectBatchStats lastStats;
+
+	void flush();	//write and draw all queued draws
+};
+
+#endif // !INDIRECT_BATCH_H
@@ -0,0 +1,165 @@
+#include "InstanceBatch.h"
+#include "GLState.h"
+
+#include <chrono>
+#include <cstring>
+
+instanceBatch::instanceBatch(unsigned int vertexArray, int indexCount, int maxInstances, unsigned int firstLocation) : VAO(vertexArray), indexCount(indexCount), maxInstances(maxInstances), firstLocation(firstLocation)
+{
+	//position and scale, rotation and layer, normalized color
+	instanceFormat.add(firstLocation, 4, attribType::float32).add(firstLocation + 1, 2, attribType::float32).add(firstLocation + 2, 4, attribType::unorm8).setDivisor(1);
+
+	size_t bufferSize = (size_t)segmentCount * maxInstances * sizeof(quadInstance);
+
+	//create instance buffer object
+	glGenBuffers(1, &instanceBuff);
+	glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuff);
+
+	if (GLAD_GL_VERSION_4_4)	//map the instance buffer once and keep it mapped
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, bufferSize, NULL, flags);
+		mappedInstances = (quadInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+	}
+
+	//add the instance stream to the vertex array, the pointers are moved to the current segment on every flush
+	glState().bindVertexArray(VAO);
+	instanceFormat.apply();
+}
+
+instanceBatch::~instanceBatch()
+{
+	for (GLsync fence : segmentFences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (mappedInstances)
+	{
+		glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuff);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	//remove the instance stream from the vertex array
+	glState().bindVertexArray(VAO);
+	for (unsigned int location = firstLocation; location < firstLocation + 3; location++)
+	{
+		glDisableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 0);
+	}
+
+	glDeleteBuffers(1, &instanceBuff);
+	glState().bufferDeleted(instanceBuff);
+}
+
+void instanceBatch::begin(shader& program, instanceDrawMode mode)
+{
+	this->program = &program;
+	this->mode = mode;
+	frameStats = instanceBatchStats();
+}
+
+void instanceBatch::draw(const quadInstance& instance)
+{
+	if ((int)queued.size() == maxInstances)	//segment is full
+	{
+		flush();
+	}
+	queued.push_back(instance);
+}
+
+void instanceBatch::end()
+{
+	flush();
+	lastStats = frameStats;
+}
+
+void instanceBatch::flush()
+{
+	if (queued.empty())
+	{
+		return;
+	}
+
+	if (mode == instanceDrawMode::perDraw)
+	{
+		flushPerDraw();
+		return;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	//wait until the GPU has finished reading this segment
+	if (segmentFences[segment])
+	{
+		glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(segmentFences[segment]);
+		segmentFences[segment] = 0;
+	}
+
+	size_t firstInstance = (size_t)segment * maxInstances;
+	size_t dataSize = queued.size() * sizeof(quadInstance);
+
+	glState().bindBuffer(GL_ARRAY_BUFFER, instanceBuff);
+	quadInstance* instances = mappedInstances ? mappedInstances + firstInstance :
+		(quadInstance*)glMapBufferRange(GL_ARRAY_BUFFER, firstInstance * sizeof(quadInstance), dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	memcpy(instances, queued.data(), dataSize);	//quadInstance already has the layout of the instance stream
+	if (!mappedInstances)
+	{
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	//point the instance stream at this segment, without base instance (GL 4.2) the offset has to go into the attribute pointers
+	glState().bindVertexArray(VAO);
+	instanceFormat.apply(firstInstance * sizeof(quadInstance));
+
+	program->use();
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0, (GLsizei)queued.size());
+	frameStats.drawCalls++;
+
+	segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);	//signaled once the GPU is done with this segment
+	segment = (segment + 1) % segmentCount;
+
+	frameStats.instances += (int)queued.size();
+	frameStats.flushMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	queued.clear();
+}
+
+void instanceBatch::flushPerDraw()
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	glState().bindVertexArray(VAO);
+	program->use();
+
+	//without the attribute arrays the shader reads the constant attribute values
+	for (unsigned int location = firstLocation; location < firstLocation + 3; location++)
+	{
+		glDisableVertexAttribArray(location);
+	}
+
+	for (const quadInstance& instance : queued)
+	{
+		glVertexAttrib4f(firstLocation, instance.x, instance.y, instance.scaleX, instance.scaleY);
+		glVertexAttrib2f(firstLocation + 1, instance.rotation, instance.layer);
+		glVertexAttrib4Nub(firstLocation + 2, instance.color & 0xFF, (instance.color >> 8) & 0xFF, (instance.color >> 16) & 0xFF, instance.color >> 24);
+		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0);
+	}
+	frameStats.drawCalls += (int)queued.size();
+
+	for (unsigned int location = firstLocation; location < firstLocation + 3; location++)
+	{
+		glEnableVertexAttribArray(location);
+	}
+
+	frameStats.instances += (int)queued.size();
+	frameStats.flushMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	queued.clear();
+}
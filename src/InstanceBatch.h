@@ -0,0 +1,77 @@
+#pragma once
+#ifndef INSTANCE_BATCH_H
+#define INSTANCE_BATCH_H
+
+#include <glad/glad.h>
+
+#include "ShaderLoader.h"
+#include "VertexFormat.h"
+
+#include <vector>
+
+//per instance data of a quad, uploaded as is so the layout has to match instanceBatch::instanceFormat
+struct quadInstance
+{
+	float x = 0.0f;	//position of the center
+	float y = 0.0f;
+	float scaleX = 1.0f;
+	float scaleY = 1.0f;
+	float rotation = 0.0f;	//rotation around the center in radians
+	float layer = 0.0f;	//texture array layer
+	unsigned int color = 0xFFFFFFFF;	//tint as RGBA8, red in the lowest byte
+};
+
+//how queued instances are drawn
+enum class instanceDrawMode
+{
+	instanced,	//one glDrawElementsInstanced per flush
+	perDraw	//one draw per instance with the instance data set as constant attributes, used for comparison
+};
+
+//statistics of the last frame
+struct instanceBatchStats
+{
+	int instances = 0;
+	int drawCalls = 0;
+	double flushMilliseconds = 0.0;	//CPU time spent writing instances and issuing draws
+};
+
+//draws many copies of the mesh of an existing vertex array, the instance data is streamed into a divisor 1 attribute stream
+//the instance buffer is split into three segments so the CPU writes one segment while the GPU still reads the others
+class instanceBatch
+{
+public:
+	//vertexArray needs an element buffer with indexCount indices, instance attributes use firstLocation to firstLocation + 2
+	instanceBatch(unsigned int vertexArray, int indexCount, int maxInstances = 100000, unsigned int firstLocation = 3);
+	~instanceBatch();
+
+	void begin(shader& program, instanceDrawMode mode = instanceDrawMode::instanced);	//start collecting instances
+	void draw(const quadInstance& instance);	//queue instance, flushes automatically if the current segment is full
+	void end();	//draw all queued instances
+
+	const instanceBatchStats& stats() const { return lastStats; }
+
+private:
+	static const int segmentCount = 3;
+
+	unsigned int VAO;
+	int indexCount;
+	int maxInstances;	//capacity of one segment
+	unsigned int firstLocation;
+	vertexFormat instanceFormat;
+	unsigned int instanceBuff;
+	quadInstance* mappedInstances = NULL;	//persistent mapping of the whole instance buffer, NULL if buffer storage is not supported
+	GLsync segmentFences[segmentCount] = {};
+	int segment = 0;	//segment written by the next flush
+
+	shader* program = NULL;
+	instanceDrawMode mode = instanceDrawMode::instanced;
+	std::vector<quadInstance> queued;
+	instanceBatchStats frameStats;
+	instanceBatchStats lastStats;
+
+	void flush();	//write and draw all queued instances
+	void flushPerDraw();
+};
+
+#endif // !INSTANCE_BATCH_H
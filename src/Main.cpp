@@ -1,53 +1,165 @@
 #include<iostream>
+#include<string>
+#include<vector>
+#include<cstdio>
+#include<cstring>
+#include<chrono>
+#include<fstream>
+#include<algorithm>
+#include<cmath>
+#include<random>
+#include<memory>
+#include<thread>
+#include<filesystem>
+#include<iterator>
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
+#include<glm/common.hpp>
+#include<glm/geometric.hpp>
 #include"ShaderLoader.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image/stb_image.h>
+#include"ShaderBatch.h"
+#include"ShaderCache.h"
+#include"Headless.h"
+#include"ImageWriter.h"
+#include"TextureManager.h"
+#include"VertexFormat.h"
+#include"GLState.h"
+#include"CommandBuffer.h"
+#include"ShaderWatcher.h"
+#include"UniformBuffer.h"
+#include"InstanceBatch.h"
+#include"IndirectBatch.h"
+#include"TextureAtlas.h"
+#include"SpriteBatch.h"
+#include"MipGenerator.h"
+#include"BlockCompressor.h"
+#include"ImageDecoder.h"
+#include"RayScene.h"
+#include"PathTracer.h"
+#include"DistanceField.h"
+#include"SoftShadows.h"
+#include"ShaderVariants.h"
+#include<stb_image/stb_image.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);	//function used to change the viewport size in case of a resize from the user
-void checkButtonClose(GLFWwindow* window);	//function for checking if the window should close when escape is pushed											//
+void checkButtonClose(GLFWwindow* window);	//function for checking if the window should close when escape is pushed
+void buildPathTraceScene(rayScene& scene, std::vector<surfaceMaterial>& materials);	//lamps, walls, a mirror and glass lit by the path tracer
+void buildShadowScene(rayScene& occluders, std::vector<light2D>& lights, int lightCount);	//boxes and circles with lights of different sizes between them											//
 
-int main()
+//settings given on the command line
+struct launchOptions
 {
-	//initialisation of GLFW
-	//==================================================================
-	glfwInit();	//first initialisation
+	bool headless = false;	//render into an offscreen framebuffer instead of a window
+	int frameCount = 100;	//number of frames rendered in headless mode
+	std::string outputDir;	//directory the headless frames are written to, empty to not write frames
+	bool writePng = true;	//write frames as png instead of raw RGBA
+	int drawCount = 1;	//quads drawn per frame, raise to measure the per draw cost
+	bool shaderCacheBench = false;	//build every program of the renderer with an empty and with a filled shader cache in headless mode
+	int shaderBatchPrograms = 0;	//programs compiled one at a time and as one batch in headless mode, 0 to skip it
+	int uniformUpdates = 0;	//uniform updates set through glGetUniformLocation, by name and by handle in headless mode, 0 to skip it
+	int commandCount = 0;	//commands with mixed layers, shaders, textures and depths recorded, sorted and replayed in headless mode, 0 to skip it
+	int spriteCount = 0;	//sprites drawn per frame with a sprite batch in headless mode, 0 to skip it
+	int vertexBenchQuads = 0;	//quads drawn with 32 byte float vertices and with 16 byte packed vertices in headless mode, 0 to skip it
+	std::string convertInput;	//file of 32 byte float vertices (position, color, texture coordinates) converted into the packed 16 byte format, empty to run normally
+	std::string convertOutput;	//file the packed vertices are written to
+	int instanceCount = 0;	//quads of the instancing comparison in headless mode, 0 to skip it
+	int atlasImageCount = 0;	//generated images packed into an atlas in headless mode, 0 to skip it
+	std::string loadBenchDirectory;	//directory of PNG and JPEG files loaded with an empty and with a filled texture cache in headless mode, empty to skip it
+	bool textureSelfTest = false;	//load images of every channel count and bit depth with both storage paths, read them back and exit with 1 on a mismatch in headless mode
+	int mipBenchSize = 0;	//edge length of the image of the CPU vs driver mipmap comparison in headless mode, 0 to skip it
+	blockFormat textureCompression = blockFormat::none;	//block compression of the scene textures
+	bool compressionBench = false;	//measure block compression speed, quality and upload time in headless mode
+	std::string decodeBenchFile;	//image decoded straight into a pixel buffer in headless mode, empty to skip it
+	int rayBenchPrimitives = 0;	//largest random scene of the ray throughput and packet benchmark, scenes start at 1000 primitives and grow tenfold, 0 to skip it
+	int sdfBenchSize = 0;	//largest edge length of the distance field benchmark, fields start at 512 and double, 0 to skip it
+	int shadowLights = 0;	//lights of the distance field lighting pass, shown in place of the textures and measured per light in headless mode, 0 to skip it
+	int pathTraceSamples = 0;	//samples per pixel of the path tracer, measured at 1 to all hardware threads in headless mode and accumulated in place of the textures in the window, 0 to skip it
+};
 
-	//setup
-	
-	//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);	//Version number before dot (x.)
-	//glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);	//Version number after dot (.x)
+launchOptions parseOptions(int argc, char* argv[]);	//read launch options from the command line arguments
+bool convertVertexFile(const std::string& inputPath, const std::string& outputPath, const vertexFormat& sourceFormat, const vertexFormat& targetFormat);	//convert a file of vertices from one format into another
+bool textureSelfTest();	//upload generated images through the texture manager and compare the readback with the decoded pixels, returns false on a mismatch
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	//Version number before dot (x.)
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);	//Version number after dot (.x)
+int main(int argc, char* argv[])
+{
+	launchOptions options = parseOptions(argc, argv);
 
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	//set to core profile
+#ifndef SUSHRAY_HEADLESS_ONLY
+	GLFWwindow* window = NULL;
+#endif
 
-	//==================================================================
+	//layout of vertices[]: float position, float color and float texture coordinates
+	vertexFormat sourceFormat;
+	sourceFormat.add(0, 3, attribType::float32).add(1, 3, attribType::float32).add(2, 2, attribType::float32);
 
-	//open Window
-	//==================================================================
-	GLFWwindow* window = glfwCreateWindow(1000, 800, "SushRay2D", NULL, NULL);	//create window object
-	
-	if (window == NULL)	//check if window has been created
+	//layout used on the GPU: normalized 16 bit position, 8 bit color and half float texture coordinates (16 instead of 32 bytes per vertex)
+	vertexFormat quadFormat;
+	quadFormat.add(0, 3, attribType::snorm16).add(1, 4, attribType::unorm8).add(2, 2, attribType::half16);
+
+	//vertex conversion does not need a context, convert the file and exit
+	if (!options.convertInput.empty())
 	{
-		std::cout << "ERROR: window could not be created" << std::endl;
-		glfwTerminate();
-		return -1;
+		return convertVertexFile(options.convertInput, options.convertOutput, sourceFormat, quadFormat) ? 0 : -1;
 	}
-	glfwMakeContextCurrent(window);	//make context of window the main context of current thread
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))	//initalize GLAD and check if the initialisation was successful
+#ifdef SUSHRAY_HEADLESS_ONLY
+	if (!options.headless)
 	{
-		std::cout << "ERROR: GLAD could not be initialized" << std::endl;
+		std::cout << "ERROR: built without glfw, only --headless is available" << std::endl;
 		return -1;
 	}
+#endif
 
-	glViewport(0, 0, 1000, 800);	//define viewport
+	if (options.headless)
+	{
+		if (!createHeadlessContext())	//create context without window
+		{
+			return -1;
+		}
+	}
+#ifndef SUSHRAY_HEADLESS_ONLY
+	else
+	{
+		//initialisation of GLFW
+		//==================================================================
+		glfwInit();	//first initialisation
 
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);	//set the framebuffer_size_callback function to be called whenever the window gets resized
+		//setup
+	
+		//glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);	//Version number before dot (x.)
+		//glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);	//Version number after dot (.x)
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);	//Version number before dot (x.)
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);	//Version number after dot (.x)
+
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	//set to core profile
+
+		//==================================================================
+
+		//open Window
+		//==================================================================
+		window = glfwCreateWindow(1000, 800, "SushRay2D", NULL, NULL);	//create window object
+	
+		if (window == NULL)	//check if window has been created
+		{
+			std::cout << "ERROR: window could not be created" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);	//make context of window the main context of current thread
+
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))	//initalize GLAD and check if the initialisation was successful
+		{
+			std::cout << "ERROR: GLAD could not be initialized" << std::endl;
+			return -1;
+		}
+		loadShaderCacheFunctions((GLADloadproc)glfwGetProcAddress);
+
+		glViewport(0, 0, 1000, 800);	//define viewport
+
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);	//set the framebuffer_size_callback function to be called whenever the window gets resized
+	}
+#endif
 
 	//define vertices
 	float vertices[] = {
@@ -62,116 +174,1381 @@ int main()
 		1, 2, 3		//tri2
 	};
 
+	std::vector<unsigned char> packedVertices = convertVertices(vertices, 4, sourceFormat, quadFormat);
+
 	//create vertex buffer object
 	unsigned int vertexBuff;
 	glGenBuffers(1, &vertexBuff);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuff);	//bind vertexBuff to the GL_ARRAY_BUFFER target
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);	//copy data from triVert into GL_ARRAY_BUFFER which is bound to vertexBuff
 
 	//create elemental buffer object
 	unsigned int elementBuff;
 	glGenBuffers(1, &elementBuff);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuff);	//bind elementBuff to the GL_ELEMENT_ARRAY_BUFFER target
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);	//copy data from triVert into GL_ELEMENT_ARRAY_BUFFER which is bound to vertexBuff
 
 	//create vertex array object
 	//==================================================================
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);	//generate vertex array object of size 1
 
-	glBindVertexArray(VAO);	//bind vertex array
+	glState().bindVertexArray(VAO);	//bind vertex array
 
-	//copy vertices from vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuff);	//bind vertex buff
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);	//copy vertices from buffer
+	//copy vertices into vertex buffer
+	glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);	//bind vertexBuff to the GL_ARRAY_BUFFER target
+	glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);	//copy packed vertices into GL_ARRAY_BUFFER which is bound to vertexBuff
 
-	//copy data from elemental buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuff);	//bind elementBuff to the GL_ELEMENT_ARRAY_BUFFER target
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);	//copy data from triVert into GL_ELEMENT_ARRAY_BUFFER which is bound to vertexBuff
+	//copy data into elemental buffer
+	glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuff);	//bind elementBuff to the GL_ELEMENT_ARRAY_BUFFER target
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);	//copy indices into GL_ELEMENT_ARRAY_BUFFER which is bound to elementBuff
 
-	//set vertex attribute pointers
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);	//define how to interpret vertex data for location in vertex attribute with position 0
-	glEnableVertexAttribArray(0);	//enable vertex attribute with position 0
-
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));	//define how to interpret vertex data for color in vertex attribute with position 1
-	glEnableVertexAttribArray(1);	//enable vertex attribute with position 1
-
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));	//define how to interpret vertex data for color in vertex attribute with position 2
-	glEnableVertexAttribArray(2);	//enable vertex attribute with position 1
+	//set vertex attribute pointers for position, color and texture coordinates
+	quadFormat.apply();
 	//==================================================================
 
-	float timeValue = glfwGetTime();
+#ifdef SUSHRAY_HEADLESS_ONLY
+	float timeValue = 0.0f;
+#else
+	float timeValue = options.headless ? 0.0f : (float)glfwGetTime();
+#endif
 	float offsetValue = (sin(timeValue) / 2.0f) + 0.5f;
 
-	shader baseShader("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag");	//load shader
+	//start compiling shaders, the driver works on them while the textures are loaded
+	shaderBatch shaders;
+	shaderBatchHandle baseShaderHandle = shaders.add("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", { "USE_SECOND_TEXTURE" });	//blend of both textures without vertex color
+	shaders.submit();
 
 	//define texture Parameters and load textures
 	//==================================================================
+	textureParams params;
 
 	//texture wrapping
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);	//set texture wrapping on the s axis to mirrored repeat
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);	//set texture wrapping on the t axis to clamp to border
+	params.wrapS = GL_MIRRORED_REPEAT;	//set texture wrapping on the s axis to mirrored repeat
+	params.wrapT = GL_CLAMP_TO_BORDER;	//set texture wrapping on the t axis to clamp to border
 
 	float borderColor[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);	//set border color
+	std::copy(borderColor, borderColor + 4, params.borderColor);	//set border color
 
 	//texture filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);	//set linear filtering mode mode for downscaling on texture and mipmap
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);	//set linear filtering mode for upscaling on texture
-
-	//load textures
-	int width;
-	int height;
-	int nrChannels;	//number of color channels
-	
-	unsigned int texture1;
-	glGenTextures(1, &texture1);	//generate texture object
-	glBindTexture(GL_TEXTURE_2D, texture1);	//bind texture to GL_TEXTURE_2D
+	params.minFilter = GL_LINEAR_MIPMAP_LINEAR;	//set linear filtering mode mode for downscaling on texture and mipmap
+	params.magFilter = GL_LINEAR;	//set linear filtering mode for upscaling on texture
 
-	stbi_set_flip_vertically_on_load(true);	//set image loader to load image flipped on y axis
+	params.flipVertically = true;	//set image loader to load image flipped on y axis
+	params.compression = options.textureCompression;
 
-	unsigned char* data = stbi_load("Resources/Textures/container.jpg", &width, &height, &nrChannels, 0);	//load image
-	
-	if (data)	//check if there is data is not NULL
+	//load textures, images are decoded in parallel and uploaded once decoded
+	unsigned int texture1;
+	unsigned int texture2;
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);	//generate texture
-		glGenerateMipmap(GL_TEXTURE_2D);	//generate Mipmap
+		textureManager textures;
+		texture1 = textures.load("Resources/Textures/container.jpg", params);
+		texture2 = textures.load("Resources/Textures/awesomeface.png", params);
+		textures.finish();
 	}
-	else
+	//==================================================================
+
+#ifndef SUSHRAY_HEADLESS_ONLY
+	//keep presenting frames until all shaders have finished compiling
+	while (window && !shaders.allReady() && !glfwWindowShouldClose(window))
 	{
-		std::cout << "ERROR: texture loading failed" << std::endl;
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);	//set clear color
+		glClear(GL_COLOR_BUFFER_BIT);	//clear the color buffer with previosly set color
+		glfwSwapBuffers(window);
+		glfwPollEvents();
 	}
+#endif
 
-	stbi_image_free(data);	//free image memory
-	
+	shader baseShader = shaders.finish(baseShaderHandle);	//load shader
 
-	unsigned int texture2;
-	glGenTextures(1, &texture2);	//generate texture object
-	glBindTexture(GL_TEXTURE_2D, texture2);	//bind texture to GL_TEXTURE_2D
-	
-	data = stbi_load("Resources/Textures/awesomeface.png", &width, &height, &nrChannels, 0);	//load image
+	baseShader.use();
+	baseShader.setInt("texSampler1", 0);	//set texture 1 to GL_TEXTURE0
+	baseShader.setInt("texSampler2", 1);	//set texture 2 to GL_TEXTURE1
+
+	//per draw data of the base shader lives in a uniform block which is sub-allocated from a ring every frame
+	const unsigned int drawDataBinding = 0;
+	baseShader.bindUniformBlock("drawData", drawDataBinding);
 
-	if (data)	//check if there is data is not NULL
+	uniformBlockLayout drawDataLayout;
+	unsigned int drawDataProgram = 0;	//program the layout was reflected from
+	int mixFactorOffset = -1;
+	uniformRing drawUniforms;
+
+	float ratio = 0.0f;
+
+	//draws are recorded into a command buffer and replayed sorted by their key
+	commandBuffer frameCommands(std::max(options.drawCount, 64), 64);
+
+	auto drawScene = [&]()
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);	//generate texture
-		glGenerateMipmap(GL_TEXTURE_2D);	//generate Mipmap
+		if (drawDataProgram != baseShader.ID)	//the layout can change when the shader is reloaded
+		{
+			drawDataLayout.reflect(baseShader.ID, "drawData");
+			mixFactorOffset = drawDataLayout.offset("mixFactor");
+			drawDataProgram = baseShader.ID;
+		}
+
+		drawUniforms.beginFrame();
+
+		for (int i = 0; i < options.drawCount; i++)
+		{
+			drawCommand* quad = frameCommands.record(makeSortKey(0, 0, 0, 0.0f));
+			quad->drawShader = &baseShader;
+			quad->vertexArray = VAO;
+			quad->textures[0] = texture1;
+			quad->textures[1] = texture2;
+			quad->count = 6;
+			quad->blockBinding = drawDataBinding;
+			quad->block = drawUniforms.allocate(drawDataLayout.size());
+			writeUniform(quad->block.data, mixFactorOffset, 0.2f);
+		}
+
+		drawUniforms.flush();	//upload block data before the draws read it
+		frameCommands.sort();
+		frameCommands.replay();
+		frameCommands.reset();
+		drawUniforms.endFrame();
+	};
+
+	//path traced light of a 2D scene, accumulated progressively and shown on the quad instead of the textures
+	std::unique_ptr<pathTracer> tracer;
+	rayScene traceScene;
+	std::vector<float> traceImage;
+	unsigned int traceTexture = 0;
+	shaderVariants baseVariants("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag");
+	if (options.pathTraceSamples > 0)
+	{
+		std::vector<surfaceMaterial> traceMaterials;
+		buildPathTraceScene(traceScene, traceMaterials);
+		tracer.reset(new pathTracer(1000, 800));
+		tracer->setScene(&traceScene, traceMaterials);
+		traceImage.resize((size_t)tracer->width() * tracer->height() * 3);
+
+		glGenTextures(1, &traceTexture);
+		glState().bindTexture(0, GL_TEXTURE_2D, traceTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, tracer->width(), tracer->height(), 0, GL_RGB, GL_FLOAT, NULL);
 	}
-	else
+
+	//upload the average of the samples so far and draw it with the single texture variant of the base shader
+	auto drawPathTrace = [&]()
 	{
-		std::cout << "ERROR: texture loading failed" << std::endl;
+		tracer->resolve(traceImage.data());
+		glState().bindTexture(0, GL_TEXTURE_2D, traceTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tracer->width(), tracer->height(), GL_RGB, GL_FLOAT, traceImage.data());
+
+		shader& traceShader = baseVariants.get({});
+		traceShader.use();
+		traceShader.setInt("texSampler1", 0);
+		glState().bindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	};
+
+	//soft shadows sphere traced through the distance field of an occluder scene, drawn as a fullscreen pass instead of the textures
+	rayScene shadowOccluders;
+	std::vector<light2D> shadowLights;
+	std::unique_ptr<distanceField> shadowField;
+	std::unique_ptr<shadowRenderer> shadows;
+	unsigned int shadowFieldTexture = 0;
+	lightingSettings lighting;
+	if (options.shadowLights > 0)
+	{
+		buildShadowScene(shadowOccluders, shadowLights, options.shadowLights);
+		shadowField.reset(new distanceField(1000, 800));
+		rasterizeOccluders(shadowOccluders, glm::vec2(0.0f), glm::vec2(1000.0f, 800.0f), shadowField->width(), shadowField->height(), shadowField->mask());
+		threadPool fieldPool;
+		shadowField->generate(&fieldPool);
+
+		glGenTextures(1, &shadowFieldTexture);
+		shadowField->upload(shadowFieldTexture);
+		shadows.reset(new shadowRenderer());
 	}
 
-	stbi_image_free(data);	//free image memory
+	if (options.headless)
+	{
+		//headless rendering
+		//==================================================================
+		offscreenTarget target(1000, 800);
 
-	baseShader.use();
-	baseShader.setInt("texSampler1", 0);	//set texture 1 to GL_TEXTURE0
-	baseShader.setInt("texSampler2", 1);	//set texture 2 to GL_TEXTURE1
+		//frames are written once their readback has finished, while later frames are already rendering
+		frameReadback readback(target.width, target.height, 3, [&](int frameIndex, const unsigned char* pixels)
+		{
+			if (options.outputDir.empty())
+			{
+				return;
+			}
 
-	float ratio = 0.0f;
+			char fileName[32];
+			snprintf(fileName, sizeof(fileName), options.writePng ? "/frame%05d.png" : "/frame%05d.rgba", frameIndex);
+			std::string path = options.outputDir + fileName;
+
+			bool written = options.writePng ? writePngImage(path.c_str(), target.width, target.height, pixels) : writeRawImage(path.c_str(), target.width, target.height, pixels);
+			if (!written)
+			{
+				std::cout << "ERROR: frame could not be written to " << path << std::endl;
+			}
+		});
+
+		auto startTime = std::chrono::steady_clock::now();
+		glState().resetCounters();
+
+		for (int frame = 0; frame < options.frameCount; frame++)
+		{
+			target.bind();
+
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);	//set clear color
+			glClear(GL_COLOR_BUFFER_BIT);	//clear the color buffer with previosly set color
+
+			//draw, time advances at a fixed 60 frames per second
+			timeValue = frame / 60.0f;
+			offsetValue = (sin(timeValue) / 2.0f) + 0.5f;
+
+			drawScene();
+
+			readback.readFrame(frame);	//start readback of this frame
+			readback.poll();	//write frames that have arrived
+		}
+		readback.flush();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		std::cout << "headless: " << options.frameCount << " frames in " << seconds << " s (" << options.frameCount / seconds << " frames/s, " << (double)options.frameCount * options.drawCount / seconds << " draws/s)" << std::endl;
+
+		const stateCounters& counters = glState().counters();
+		double frames = options.frameCount > 0 ? options.frameCount : 1;
+		std::cout << "state cache: " << counters.issued / frames << " calls issued, " << counters.elided / frames << " calls elided per frame" << std::endl;
+
+		//program creation of every shader of the renderer after deleting the cache, then again with all programs cached and once more after deleting the cache
+		//the last run shows how much the driver caches by itself within the process, point MESA_SHADER_CACHE_DIR at an empty directory to keep the Mesa disk cache out of the cold run
+		if (options.shaderCacheBench)
+		{
+			struct programSource
+			{
+				const char* vertexPath;
+				const char* fragmentPath;
+				shaderDefines defines;
+			};
+			std::vector<programSource> programs = {
+				{ "Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", {} },
+				{ "Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", { "USE_SECOND_TEXTURE" } },
+				{ "Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", { "USE_INSTANCING", "USE_VERTEX_COLOR" } },
+				{ "Resources/Shaders/spriteShader.vert", "Resources/Shaders/spriteShader.frag", {} },
+				{ "Resources/Shaders/spriteShader.vert", "Resources/Shaders/spriteShader.frag", { "USE_TEXTURE_ARRAY" } },
+				{ "Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag", { "JFA_SEED" } },
+				{ "Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag", {} },
+				{ "Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag", { "JFA_RESOLVE" } },
+				{ "Resources/Shaders/fullscreen.vert", "Resources/Shaders/softShadows.frag", {} }
+			};
+			for (programSource& program : programs)
+			{
+				program.defines.push_back("SHADER_CACHE_BENCH");	//keeps the sources apart from the programs built earlier in this process
+			}
+
+			const char* runNames[] = { "cold", "warm", "cold again" };
+			for (int run = 0; run < 3; run++)
+			{
+				if (run != 1)
+				{
+					clearShaderCache();
+				}
+				resetShaderCacheStats();
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (const programSource& program : programs)
+				{
+					shader built(program.vertexPath, program.fragmentPath, program.defines);
+					glDeleteProgram(built.ID);
+				}
+				glFinish();
+				double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				std::cout << "shader cache " << runNames[run] << ": " << programs.size() << " programs in " << milliseconds << " ms, " << shaderCacheStats().hits << " loaded from the cache, "
+					<< shaderCacheStats().misses << " built from source" << (shaderCacheSupported() ? "" : " (program binaries are not supported by the driver)") << std::endl;
+			}
+		}
+
+		//variants of the base shader compiled one at a time, waiting for each, and all submitted as one batch before the first status query
+		//every variant gets its own define so neither the shader cache nor the driver has seen it, the binaries stored on the way are deleted afterwards
+		if (options.shaderBatchPrograms > 0)
+		{
+			auto variantDefines = [&](int round, int index)
+			{
+				return shaderDefines({ "USE_SECOND_TEXTURE", "BATCH_BENCH_VARIANT " + std::to_string(round * options.shaderBatchPrograms + index) });
+			};
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < options.shaderBatchPrograms; i++)
+			{
+				shader single("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", variantDefines(0, i));
+				glDeleteProgram(single.ID);
+			}
+			double singleMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			shaderBatch batch;
+			std::vector<shaderBatchHandle> handles;
+			for (int i = 0; i < options.shaderBatchPrograms; i++)
+			{
+				handles.push_back(batch.add("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", variantDefines(1, i)));
+			}
+			batch.submit();
+			double submitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			for (shaderBatchHandle handle : handles)
+			{
+				glDeleteProgram(batch.finish(handle).ID);
+			}
+			double batchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			clearShaderCache();
+
+			std::cout << "shader batch " << options.shaderBatchPrograms << " programs: one at a time " << singleMilliseconds << " ms, batched " << batchMilliseconds << " ms (submit returned after " << submitMilliseconds
+				<< " ms, parallel compile " << (batch.parallelCompileSupported() ? "supported" : "not supported") << ")" << std::endl;
+		}
+
+		//two vec2 and a float set per update, looked up by the driver every time, through the uniform table of the shader by name and with pre-resolved handles
+		if (options.uniformUpdates > 0)
+		{
+			shader floodShader("Resources/Shaders/fullscreen.vert", "Resources/Shaders/jumpFlood.frag");
+			floodShader.use();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < options.uniformUpdates; i++)
+			{
+				glUniform2f(glGetUniformLocation(floodShader.ID, "windowMin"), (float)i, 0.0f);
+				glUniform2f(glGetUniformLocation(floodShader.ID, "windowMax"), (float)i, 1.0f);
+				glUniform1f(glGetUniformLocation(floodShader.ID, "stepSize"), (float)i);
+			}
+			glFinish();
+			double locationMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < options.uniformUpdates; i++)
+			{
+				floodShader.setVec2("windowMin", (float)i, 0.0f);
+				floodShader.setVec2("windowMax", (float)i, 1.0f);
+				floodShader.setFloat("stepSize", (float)i);
+			}
+			glFinish();
+			double nameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			uniformHandle windowMin = floodShader.getUniform("windowMin");
+			uniformHandle windowMax = floodShader.getUniform("windowMax");
+			uniformHandle stepSize = floodShader.getUniform("stepSize");
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < options.uniformUpdates; i++)
+			{
+				floodShader.setVec2(windowMin, (float)i, 0.0f);
+				floodShader.setVec2(windowMax, (float)i, 1.0f);
+				floodShader.setFloat(stepSize, (float)i);
+			}
+			glFinish();
+			double handleMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			double sets = options.uniformUpdates * 3.0;
+			std::cout << "uniforms " << options.uniformUpdates << " updates of 3 uniforms: glGetUniformLocation " << locationMilliseconds << " ms (" << locationMilliseconds * 1e6 / sets << " ns per set), by name "
+				<< nameMilliseconds << " ms (" << nameMilliseconds * 1e6 / sets << " ns), by handle " << handleMilliseconds << " ms (" << handleMilliseconds * 1e6 / sets << " ns)" << std::endl;
+		}
+
+		//commands in random order over 4 layers, 4 shader variants and 16 textures, replayed sorted by key and in recording order
+		if (options.commandCount > 0)
+		{
+			shaderDefines variantDefines[] = { {}, { "USE_VERTEX_COLOR" }, { "USE_SECOND_TEXTURE" }, { "USE_SECOND_TEXTURE", "USE_VERTEX_COLOR" } };
+			shader* variants[4];
+			for (int i = 0; i < 4; i++)
+			{
+				variants[i] = &baseVariants.get(variantDefines[i]);
+				variants[i]->use();
+				variants[i]->setInt("texSampler1", 0);
+				variants[i]->setInt("texSampler2", 1);
+				variants[i]->bindUniformBlock("drawData", drawDataBinding);
+			}
+
+			unsigned int colorTextures[16];
+			glGenTextures(16, colorTextures);
+			for (int i = 0; i < 16; i++)
+			{
+				unsigned int color = 0xFF000000 | ((i * 2654435761u) & 0x00FFFFFF);
+				glState().bindTexture(0, GL_TEXTURE_2D, colorTextures[i]);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &color);
+			}
+
+			struct commandSetup
+			{
+				unsigned int layer;
+				unsigned int variant;
+				unsigned int textureIndex;
+				float depth;
+			};
+			std::vector<commandSetup> setups(options.commandCount);
+			std::mt19937 random(777);
+			for (commandSetup& setup : setups)
+			{
+				setup.layer = random() % 4;
+				setup.variant = random() % 4;
+				setup.textureIndex = random() % 16;
+				setup.depth = (random() % 10000) / 10000.0f;
+			}
+
+			commandBuffer benchCommands(options.commandCount, 64);
+			uniformRing benchUniforms;
+
+			//the draws are squeezed into a few pixels, so the measurement is about recording, sorting and state changes and not about filling the quads
+			target.bind();
+			glViewport(0, 0, 16, 16);
+
+			for (int sorted = 1; sorted >= 0; sorted--)
+			{
+				double recordMilliseconds = 0.0;
+				double sortMilliseconds = 0.0;
+				double replayMilliseconds = 0.0;
+				glFinish();
+				glState().resetCounters();
+				for (int frame = 0; frame < options.frameCount; frame++)
+				{
+					benchUniforms.beginFrame();
+					uniformAllocation block = benchUniforms.allocate(drawDataLayout.size());
+					writeUniform(block.data, mixFactorOffset, 0.5f);
+					benchUniforms.flush();
+
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					for (const commandSetup& setup : setups)
+					{
+						drawCommand* command = benchCommands.record(makeSortKey(setup.layer, setup.variant, setup.textureIndex, setup.depth));
+						command->drawShader = variants[setup.variant];
+						command->vertexArray = VAO;
+						command->textures[0] = colorTextures[setup.textureIndex];
+						command->textures[1] = texture2;
+						command->count = 6;
+						command->blockBinding = setup.variant >= 2 ? drawDataBinding : -1;
+						command->block = block;
+					}
+					recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+					if (sorted)
+					{
+						benchCommands.sort();
+						sortMilliseconds += benchCommands.stats().sortMilliseconds;
+					}
+					benchCommands.replay();
+					replayMilliseconds += benchCommands.stats().replayMilliseconds;
+					benchCommands.reset();
+					benchUniforms.endFrame();
+				}
+				glFinish();
+
+				const stateCounters& commandCounters = glState().counters();
+				std::cout << "commands " << options.commandCount << (sorted ? " sorted: " : " in recording order: ") << "record " << recordMilliseconds / frames << " ms, sort " << sortMilliseconds / frames
+					<< " ms, replay " << replayMilliseconds / frames << " ms per frame, " << commandCounters.issued / frames << " state changes issued, " << commandCounters.elided / frames << " elided per frame" << std::endl;
+			}
+
+			glViewport(0, 0, target.width, target.height);
+			glDeleteTextures(16, colorTextures);
+			for (unsigned int texture : colorTextures)
+			{
+				glState().textureDeleted(texture);
+			}
+		}
+
+		//small sprites alternating between both scene textures, grouped by texture and in submission order
+		if (options.spriteCount > 0)
+		{
+			spriteBatch sprites;
+			spriteSortMode modes[] = { spriteSortMode::state, spriteSortMode::submission };
+			for (spriteSortMode mode : modes)
+			{
+				spriteBatchStats total;
+				double frameMilliseconds = 0.0;
+				for (int frame = 0; frame < options.frameCount; frame++)
+				{
+					target.bind();
+					glClear(GL_COLOR_BUFFER_BIT);
+
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					sprites.begin((float)target.width, (float)target.height, mode);
+					for (int i = 0; i < options.spriteCount; i++)
+					{
+						sprite quad;
+						quad.texture = i % 2 ? texture2 : texture1;
+						quad.x = (float)(i * 37 % target.width);
+						quad.y = (float)(i * 53 % target.height);
+						quad.width = 8.0f;
+						quad.height = 8.0f;
+						quad.rotation = frame / 60.0f + i * 0.01f;
+						sprites.draw(quad);
+					}
+					sprites.end();
+					frameMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+					total.sprites += sprites.stats().sprites;
+					total.drawCalls += sprites.stats().drawCalls;
+					total.flushes += sprites.stats().flushes;
+					total.flushMilliseconds += sprites.stats().flushMilliseconds;
+					total.writeMilliseconds += sprites.stats().writeMilliseconds;
+				}
+				glFinish();
+
+				std::cout << (mode == spriteSortMode::state ? "sprites grouped by texture: " : "sprites in submission order: ") << total.sprites / frames << " sprites, " << total.drawCalls / frames << " draw calls, "
+					<< total.flushes / frames << " flushes per frame, " << total.flushMilliseconds / std::max(total.flushes, 1) << " ms per flush (" << total.writeMilliseconds / std::max(total.flushes, 1)
+					<< " ms sorting and writing vertices), " << frameMilliseconds / frames << " ms CPU per frame" << std::endl;
+			}
+		}
+
+		//grid of small quads in one buffer, drawn with 32 byte float vertices and with the same vertices converted into the 16 byte packed format
+		//uploads and draws are timed apart, the uploads stand for streamed sprite or mesh data and the draws for the vertex fetch from a filled buffer
+		if (options.vertexBenchQuads > 0)
+		{
+			shader& vertexShader = baseVariants.get({ "USE_VERTEX_COLOR" });
+			vertexShader.use();
+			vertexShader.setInt("texSampler1", 0);
+
+			int gridSize = (int)ceil(sqrt((double)options.vertexBenchQuads));
+			float cellSize = 2.0f / gridSize;
+
+			std::vector<float> floatVertices(options.vertexBenchQuads * 4 * 8);
+			std::vector<unsigned int> quadIndices(options.vertexBenchQuads * 6);
+			for (int i = 0; i < options.vertexBenchQuads; i++)
+			{
+				float x = -1.0f + (i % gridSize) * cellSize;
+				float y = -1.0f + (i / gridSize) * cellSize;
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const float* source = vertices + corner * 8;
+					float* vertex = floatVertices.data() + (i * 4 + corner) * 8;
+					vertex[0] = x + (source[0] + 0.5f) * cellSize;
+					vertex[1] = y + (source[1] + 0.5f) * cellSize;
+					std::copy(source + 2, source + 8, vertex + 2);
+				}
+				for (int index = 0; index < 6; index++)
+				{
+					quadIndices[i * 6 + index] = i * 4 + indices[index];
+				}
+			}
+			std::vector<unsigned char> packedBenchVertices = convertVertices(floatVertices.data(), options.vertexBenchQuads * 4, sourceFormat, quadFormat);
+
+			unsigned int benchArrays[2];
+			unsigned int benchBuffers[3];
+			glGenVertexArrays(2, benchArrays);
+			glGenBuffers(3, benchBuffers);
+			glState().bindBuffer(GL_COPY_WRITE_BUFFER, benchBuffers[2]);
+			glBufferData(GL_COPY_WRITE_BUFFER, quadIndices.size() * sizeof(unsigned int), quadIndices.data(), GL_STATIC_DRAW);
+
+			const vertexFormat* formats[] = { &sourceFormat, &quadFormat };
+			const void* vertexData[] = { floatVertices.data(), packedBenchVertices.data() };
+			for (int f = 0; f < 2; f++)
+			{
+				glState().bindVertexArray(benchArrays[f]);
+				glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, benchBuffers[2]);	//the element buffer binding is part of the vertex array, both share the indices
+				glState().bindBuffer(GL_ARRAY_BUFFER, benchBuffers[f]);
+				glBufferData(GL_ARRAY_BUFFER, options.vertexBenchQuads * 4 * formats[f]->stride(), NULL, GL_STREAM_DRAW);
+				formats[f]->apply();
+			}
+
+			glState().bindTexture(0, GL_TEXTURE_2D, texture1);
+			for (int f = 0; f < 2; f++)
+			{
+				size_t frameBytes = options.vertexBenchQuads * 4 * formats[f]->stride();
+				glState().bindVertexArray(benchArrays[f]);
+				glState().bindBuffer(GL_ARRAY_BUFFER, benchBuffers[f]);
+
+				double milliseconds[2];	//upload alone and draw alone
+				for (int pass = 0; pass < 2; pass++)
+				{
+					target.bind();
+					glFinish();
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					for (int frame = 0; frame < options.frameCount; frame++)
+					{
+						if (pass == 0)
+						{
+							glBufferData(GL_ARRAY_BUFFER, frameBytes, NULL, GL_STREAM_DRAW);	//orphan the storage the previous frame may still read
+							glBufferSubData(GL_ARRAY_BUFFER, 0, frameBytes, vertexData[f]);
+						}
+						else
+						{
+							glClear(GL_COLOR_BUFFER_BIT);
+							glDrawElements(GL_TRIANGLES, options.vertexBenchQuads * 6, GL_UNSIGNED_INT, 0);
+						}
+					}
+					glFinish();
+					milliseconds[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+				}
+
+				std::cout << "vertices " << formats[f]->stride() << " bytes: " << options.vertexBenchQuads << " quads, " << frameBytes / (1024.0 * 1024.0) << " MiB per frame, upload "
+					<< milliseconds[0] << " ms (" << frameBytes / (1024.0 * 1024.0) / milliseconds[0] * 1000.0 << " MiB/s), draw " << milliseconds[1] << " ms per frame" << std::endl;
+			}
+
+			glDeleteBuffers(3, benchBuffers);
+			for (unsigned int buffer : benchBuffers)
+			{
+				glState().bufferDeleted(buffer);
+			}
+			glDeleteVertexArrays(2, benchArrays);
+			for (unsigned int vertexArray : benchArrays)
+			{
+				glState().vertexArrayDeleted(vertexArray);
+			}
+		}
+
+		//grid of small quads drawn instanced and with one draw per quad
+		if (options.instanceCount > 0)
+		{
+			shader instanceShader("Resources/Shaders/baseVertShader.vert", "Resources/Shaders/baseFragShader.frag", { "USE_INSTANCING", "USE_VERTEX_COLOR" });
+			instanceShader.use();
+			instanceShader.setInt("texSampler1", 0);
+
+			instanceBatch instances(VAO, 6, options.instanceCount);
+
+			int gridSize = (int)ceil(sqrt((double)options.instanceCount));
+			float cellSize = 2.0f / gridSize;
+			float quadSize = std::min(8.0f / target.width, cellSize);	//about 4 pixels, so the draw calls are measured and not the fill rate
+
+			auto drawInstances = [&](instanceDrawMode mode, int frame)
+			{
+				target.bind();
+				glClear(GL_COLOR_BUFFER_BIT);
+				glState().bindTexture(0, GL_TEXTURE_2D, texture1);
+
+				instances.begin(instanceShader, mode);
+				for (int i = 0; i < options.instanceCount; i++)
+				{
+					quadInstance quad;
+					quad.x = -1.0f + (i % gridSize + 0.5f) * cellSize;
+					quad.y = -1.0f + (i / gridSize + 0.5f) * cellSize;
+					quad.scaleX = quadSize;
+					quad.scaleY = quadSize;
+					quad.rotation = frame / 60.0f + i * 0.01f;
+					quad.color = 0xFF000000 | ((i * 2654435761u) & 0x00FFFFFF);
+					instances.draw(quad);
+				}
+				instances.end();
+			};
+
+			//the modes run in the order instanced, per draw, per draw, instanced so neither one always goes first, each run starts with an untimed frame
+			instanceDrawMode modes[] = { instanceDrawMode::instanced, instanceDrawMode::perDraw };
+			double modeSeconds[2] = {};
+			int modeDrawCalls[2] = {};
+			for (int run = 0; run < 4; run++)
+			{
+				int m = run == 1 || run == 2 ? 1 : 0;
+				drawInstances(modes[m], 0);
+				glFinish();
+
+				auto runStart = std::chrono::steady_clock::now();
+				for (int frame = 0; frame < options.frameCount; frame++)
+				{
+					drawInstances(modes[m], frame);
+				}
+				glFinish();	//include the GPU work in the measurement
+				modeSeconds[m] += std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+				modeDrawCalls[m] = instances.stats().drawCalls;
+			}
+
+			for (int m = 0; m < 2; m++)
+			{
+				double seconds = modeSeconds[m] / 2.0;	//two runs per mode
+				std::cout << (m == 0 ? "instanced: " : "per draw: ") << options.instanceCount << " quads, " << modeDrawCalls[m] << " draw calls per frame, "
+					<< seconds * 1000.0 / frames << " ms per frame (" << (double)options.instanceCount * options.frameCount / seconds << " quads/s)" << std::endl;
+			}
+
+			//different meshes in one batch, every draw is a record of one multi draw indirect call
+			float triangleVertices[] = {
+				 0.0f, 0.5f, 0.0f, 1.0f, 1.0f, 1.0f, 0.5f, 1.0f,
+				-0.5f, -0.5f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+				 0.5f, -0.5f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f
+			};
+			unsigned int triangleIndices[] = { 0, 1, 2 };
+
+			float hexagonVertices[7 * 8];
+			unsigned int hexagonIndices[6 * 3];
+			for (int corner = 0; corner < 7; corner++)	//center followed by the corners
+			{
+				float angle = corner * 3.14159265f / 3.0f;
+				float radius = corner == 6 ? 0.0f : 0.5f;
+				float* vertex = hexagonVertices + corner * 8;
+				vertex[0] = radius * cos(angle);
+				vertex[1] = radius * sin(angle);
+				vertex[2] = 0.0f;
+				vertex[3] = vertex[4] = vertex[5] = 1.0f;
+				vertex[6] = vertex[0] + 0.5f;
+				vertex[7] = vertex[1] + 0.5f;
+			}
+			for (int side = 0; side < 6; side++)
+			{
+				hexagonIndices[side * 3] = 6;
+				hexagonIndices[side * 3 + 1] = side;
+				hexagonIndices[side * 3 + 2] = (side + 1) % 6;
+			}
+
+			indirectBatch meshes(quadFormat, 64, 64, options.instanceCount);
+			meshRange meshList[3];
+			meshList[0] = meshes.addMesh(packedVertices.data(), 4, indices, 6);
+			meshList[1] = meshes.addMesh(convertVertices(triangleVertices, 3, sourceFormat, quadFormat).data(), 3, triangleIndices, 3);
+			meshList[2] = meshes.addMesh(convertVertices(hexagonVertices, 7, sourceFormat, quadFormat).data(), 7, hexagonIndices, 18);
+
+			auto indirectStart = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < options.frameCount; frame++)
+			{
+				target.bind();
+				glClear(GL_COLOR_BUFFER_BIT);
+				glState().bindTexture(0, GL_TEXTURE_2D, texture1);
+
+				meshes.begin(instanceShader);
+				for (int i = 0; i < options.instanceCount; i++)
+				{
+					quadInstance drawData;
+					drawData.x = -1.0f + (i % gridSize + 0.5f) * cellSize;
+					drawData.y = -1.0f + (i / gridSize + 0.5f) * cellSize;
+					drawData.scaleX = cellSize;
+					drawData.scaleY = cellSize;
+					drawData.rotation = frame / 60.0f + i * 0.01f;
+					drawData.color = 0xFF000000 | ((i * 2654435761u) & 0x00FFFFFF);
+					meshes.draw(meshList[i % 3], drawData);
+				}
+				meshes.end();
+			}
+			glFinish();
+
+			double indirectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - indirectStart).count();
+			std::cout << (meshes.multiDrawSupported() ? "multi draw indirect: " : "indirect fallback: ") << options.instanceCount << " meshes, " << meshes.stats().submits << " draw calls per frame, "
+				<< indirectSeconds * 1000.0 / frames << " ms per frame (" << (double)options.instanceCount * options.frameCount / indirectSeconds << " meshes/s)" << std::endl;
+		}
+		//pack generated images of random size into an atlas and draw all of them as sprites
+		if (options.atlasImageCount > 0)
+		{
+			textureAtlas atlas;
+			unsigned int seed = 12345;
+			std::vector<unsigned char> image;
+			for (int i = 0; i < options.atlasImageCount; i++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				int width = 8 + (seed >> 8) % 121;
+				int height = 8 + (seed >> 20) % 121;
+				image.assign((size_t)width * height * 4, 255);
+				for (size_t pixel = 0; pixel < image.size(); pixel += 4)
+				{
+					memcpy(&image[pixel], &seed, 3);	//solid color per image
+				}
+				atlas.add(image.data(), width, height);
+			}
+			atlas.build();
+
+			const atlasStats& packing = atlas.stats();
+			std::cout << "atlas: " << packing.images << " images in " << packing.layers << " layers, " << packing.efficiency * 100.0 << "% used, packed in " << packing.packMilliseconds << " ms, uploaded in " << packing.uploadMilliseconds << " ms" << std::endl;
+
+			spriteBatch sprites;
+			target.bind();
+			glClear(GL_COLOR_BUFFER_BIT);
+			sprites.begin((float)target.width, (float)target.height);
+			for (int i = 0; i < atlas.regionCount(); i++)
+			{
+				sprite quad;
+				quad.setRegion(atlas.texture(), atlas.region(i));
+				quad.x = (float)(i * 37 % target.width);
+				quad.y = (float)(i * 53 % target.height);
+				quad.width = (float)atlas.region(i).width;
+				quad.height = (float)atlas.region(i).height;
+				sprites.draw(quad);
+			}
+			sprites.end();
+			std::cout << "atlas sprites: " << sprites.stats().sprites << " sprites in " << sprites.stats().drawCalls << " draw calls" << std::endl;
+		}
+		//load every image of a directory with the texture cache emptied first, then again with all images in the cache
+		if (!options.loadBenchDirectory.empty())
+		{
+			std::vector<std::string> files;
+			std::error_code error;
+			for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(options.loadBenchDirectory, error))
+			{
+				std::string extension = entry.path().extension().string();
+				std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+				if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg"))
+				{
+					files.push_back(entry.path().string());
+				}
+			}
+			std::sort(files.begin(), files.end());
+			if (error || files.empty())
+			{
+				std::cout << "ERROR: no PNG or JPEG files found in " << options.loadBenchDirectory << std::endl;
+			}
+
+			const char* runNames[] = { "cold", "warm" };
+			for (int run = 0; run < 2 && !error && !files.empty(); run++)
+			{
+				if (run == 0)
+				{
+					clearTextureCache();
+				}
+
+				std::vector<unsigned int> loaded;
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				textureManager loader;
+				for (const std::string& file : files)
+				{
+					loaded.push_back(loader.load(file, params));
+				}
+				loader.finish();
+				glFinish();
+				double totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				const textureLoadStats& loads = loader.stats();
+				std::cout << "load " << runNames[run] << ": " << loads.textures << " of " << files.size() << " textures, " << loads.cacheHits << " from the cache, decode " << loads.decodeMilliseconds << " ms summed over "
+					<< loader.threadCount() << " threads, upload " << loads.uploadMilliseconds << " ms (" << loads.uploadedBytes / (1024.0 * 1024.0) << " MiB), total " << totalMilliseconds << " ms" << std::endl;
+
+				glDeleteTextures((GLsizei)loaded.size(), loaded.data());
+				for (unsigned int texture : loaded)
+				{
+					glState().textureDeleted(texture);
+				}
+			}
+		}
+		bool testsPassed = true;
+		if (options.textureSelfTest)
+		{
+			testsPassed = textureSelfTest() && testsPassed;
+		}
+
+		//compare mipmaps filtered on the CPU with glGenerateMipmap, the driver is timed without the upload of level 0
+		if (options.mipBenchSize > 0)
+		{
+			int size = options.mipBenchSize;
+			std::vector<unsigned char> image((size_t)size * size * 4);
+			unsigned int seed = 12345;
+			for (size_t i = 0; i < image.size(); i += 4)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				memcpy(&image[i], &seed, 4);
+			}
+
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			glState().bindTexture(0, GL_TEXTURE_2D, texture);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+			glFinish();
+			double uploadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glFinish();
+			double driverMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() - uploadMilliseconds;
+			glDeleteTextures(1, &texture);
+			glState().textureDeleted(texture);
+
+			std::cout << "mipmaps " << size << "x" << size << ": glGenerateMipmap " << driverMilliseconds << " ms (upload " << uploadMilliseconds << " ms)" << std::endl;
+
+			const char* names[] = { "box", "kaiser", "box srgb", "kaiser srgb premultiplied" };
+			for (int i = 0; i < 4; i++)
+			{
+				mipSettings settings;
+				settings.filter = i % 2 ? mipFilter::kaiser : mipFilter::box;
+				settings.srgb = i >= 2;
+				settings.premultipliedAlpha = i == 3;
+
+				std::vector<unsigned char> mipData;
+				std::vector<cachedLevel> levels;
+				start = std::chrono::steady_clock::now();
+				generateMipChain(image.data(), size, size, settings, mipData, levels);
+				double cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				std::cout << "mipmaps " << size << "x" << size << ": CPU " << names[i] << " " << cpuMilliseconds << " ms, " << levels.size() << " levels" << std::endl;
+			}
+		}
+		//encode the scene textures with every format and quality, then compare the upload of compressed and uncompressed data
+		if (options.compressionBench)
+		{
+			threadPool encoders;
+			const char* files[] = { "Resources/Textures/container.jpg", "Resources/Textures/awesomeface.png" };
+			for (const char* file : files)
+			{
+				int width;
+				int height;
+				int nrChannels;
+				unsigned char* pixels = stbi_load(file, &width, &height, &nrChannels, 4);
+				if (!pixels)
+				{
+					std::cout << "ERROR: texture loading failed: " << file << std::endl;
+					continue;
+				}
+
+				std::vector<unsigned char> decoded((size_t)width * height * 4);
+				unsigned int texture;
+				glGenTextures(1, &texture);
+				glState().bindTexture(0, GL_TEXTURE_2D, texture);
+				const int uploads = 20;
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (int i = 0; i < uploads; i++)
+				{
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+				}
+				glFinish();
+				double rawUpload = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / uploads;
+				std::cout << file << ": " << width << "x" << height << ", RGBA8 " << compressedSize(width, height, blockFormat::none) / 1024 << " KiB, upload " << rawUpload << " ms" << std::endl;
+
+				blockFormat formats[] = { blockFormat::bc1, blockFormat::bc3 };
+				compressionQuality qualities[] = { compressionQuality::fast, compressionQuality::high };
+				for (blockFormat format : formats)
+				{
+					std::vector<unsigned char> blocks(compressedSize(width, height, format));
+					for (compressionQuality quality : qualities)
+					{
+						start = std::chrono::steady_clock::now();
+						compressImage(pixels, width, height, format, quality, blocks.data());
+						double singleMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+						start = std::chrono::steady_clock::now();
+						compressImage(pixels, width, height, format, quality, blocks.data(), &encoders);
+						double poolMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+						decompressImage(blocks.data(), width, height, format, decoded.data());
+						double psnr = imagePSNR(pixels, decoded.data(), width, height, format == blockFormat::bc3);
+
+						std::cout << "  " << (format == blockFormat::bc1 ? "BC1 " : "BC3 ") << (quality == compressionQuality::fast ? "fast" : "high") << ": " << singleMilliseconds << " ms on 1 thread ("
+							<< width * height / singleMilliseconds / 1000.0 << " MPixel/s), " << poolMilliseconds << " ms on " << encoders.threadCount() << " threads, PSNR " << psnr << " dB" << std::endl;
+					}
+
+					if (compressionSupported())
+					{
+						start = std::chrono::steady_clock::now();
+						for (int i = 0; i < uploads; i++)
+						{
+							glCompressedTexImage2D(GL_TEXTURE_2D, 0, compressedInternalFormat(format), width, height, 0, (GLsizei)blocks.size(), blocks.data());
+						}
+						glFinish();
+						double compressedUpload = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / uploads;
+						std::cout << "  " << (format == blockFormat::bc1 ? "BC1 " : "BC3 ") << blocks.size() / 1024 << " KiB, upload " << compressedUpload << " ms" << std::endl;
+					}
+				}
+
+				glDeleteTextures(1, &texture);
+				glState().textureDeleted(texture);
+				stbi_image_free(pixels);
+			}
+		}
+		//decode an image file straight into a mapped pixel buffer and compare it with decoding into a temporary image that is copied
+		//the direct decode runs first, so the growth of the peak memory during it is not hidden by the temporary image
+		if (!options.decodeBenchFile.empty())
+		{
+			std::ifstream file(options.decodeBenchFile, std::ios::binary | std::ios::ate);
+			std::vector<unsigned char> fileData(file ? (size_t)file.tellg() : 0);
+			file.seekg(0);
+			file.read((char*)fileData.data(), fileData.size());
+
+			imageInfo info;
+			if (!file || !readImageInfo(fileData.data(), fileData.size(), 4, false, info))
+			{
+				std::cout << "ERROR: image could not be read: " << options.decodeBenchFile << std::endl;
+			}
+			else
+			{
+				unsigned int texture;
+				glGenTextures(1, &texture);
+				glState().bindTexture(0, GL_TEXTURE_2D, texture);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, info.width, info.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+				unsigned int pixelBuff;
+				glGenBuffers(1, &pixelBuff);
+				glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuff);
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, decodeBufferSize(info), NULL, GL_STREAM_DRAW);
+
+				//touch buffer and texture once, so their first use does not count towards either decode
+				void* buffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, decodeBufferSize(info), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+				memset(buffer, 0, decodeBufferSize(info));
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, info.width, info.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+				glFinish();
+				double baseMemory = peakMemoryUsage() / (1024.0 * 1024.0);
+
+				//decode straight into the buffer, readable as PNG unfiltering reads the previous row
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, decodeBufferSize(info), GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+				bool inPlace = false;
+				decodeImageInto(fileData.data(), fileData.size(), info, false, mapped, &inPlace);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, info.width, info.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+				glFinish();
+				double directMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				double directMemory = peakMemoryUsage() / (1024.0 * 1024.0);
+
+				//decode into a temporary image and copy it into the buffer
+				start = std::chrono::steady_clock::now();
+				unsigned char* pixels = decodeImage(fileData.data(), fileData.size(), info, false);
+				mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, info.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+				memcpy(mapped, pixels, info.size());
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				freeImage(pixels);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, info.width, info.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+				glFinish();
+				double copyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				double copyMemory = peakMemoryUsage() / (1024.0 * 1024.0);
+
+				glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glDeleteBuffers(1, &pixelBuff);
+				glState().bufferDeleted(pixelBuff);
+				glDeleteTextures(1, &texture);
+				glState().textureDeleted(texture);
+
+				std::cout << "decode " << info.width << "x" << info.height << ": into pixel buffer " << directMilliseconds << " ms (" << (inPlace ? "in place" : "copied") << ", peak +" << directMemory - baseMemory << " MiB), "
+					<< "temporary image " << copyMilliseconds << " ms (peak +" << copyMemory - directMemory << " MiB)" << std::endl;
+			}
+		}
+		//closest hit and any hit throughput on random scenes of segments with a few circles, on one thread, followed by single rays against packets
+		for (int primitiveCount = 1000; primitiveCount <= options.rayBenchPrimitives; primitiveCount *= 10)
+		{
+			std::mt19937 random(12345);
+			std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+			std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+			float size = 2000.0f / sqrtf((float)primitiveCount);	//keeps the density of the scene about the same
+
+			rayScene scene;
+			for (int i = 0; i < primitiveCount; i++)
+			{
+				glm::vec2 start(position(random), position(random));
+				if (i % 10 == 0)
+				{
+					scene.addCircle(start, size * 0.25f);
+				}
+				else
+				{
+					float direction = angle(random);
+					scene.addSegment(start, start + glm::vec2(cosf(direction), sinf(direction)) * size);
+				}
+			}
+			scene.build();
+
+			const int rayCount = 1000000;
+			std::vector<ray2D> rays(rayCount);
+			for (ray2D& ray : rays)
+			{
+				float direction = angle(random);
+				ray.origin = glm::vec2(position(random), position(random));
+				ray.direction = glm::vec2(cosf(direction), sinf(direction));
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			int hits = 0;
+			for (const ray2D& ray : rays)
+			{
+				rayHit hit;
+				hits += scene.closestHit(ray, hit) ? 1 : 0;
+			}
+			double closestSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			//occlusion rays towards a point a short distance away, like shadow rays to a nearby light
+			for (ray2D& ray : rays)
+			{
+				ray.tMax = size * 4.0f;
+			}
+			start = std::chrono::steady_clock::now();
+			int occluded = 0;
+			for (const ray2D& ray : rays)
+			{
+				occluded += scene.anyHit(ray) ? 1 : 0;
+			}
+			double anySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			const rayBvhStats& bvh = scene.stats();
+			std::cout << "rays " << primitiveCount << " primitives: bvh " << bvh.nodes << " nodes, depth " << bvh.depth << ", built in " << bvh.buildMilliseconds << " ms, closest hit "
+				<< rayCount / closestSeconds / 1e6 << " Mrays/s (" << hits * 100.0 / rayCount << "% hit), any hit " << rayCount / anySeconds / 1e6 << " Mrays/s (" << occluded * 100.0 / rayCount << "% occluded)" << std::endl;
+
+			//coherent rays, scalar against packets: a fan of visibility rays around a light and shadow rays from a grid of pixels to it
+			glm::vec2 light(500.0f, 500.0f);
+			for (int i = 0; i < rayCount; i++)
+			{
+				float direction = 6.2831853f * i / rayCount;
+				rays[i] = ray2D();
+				rays[i].origin = light;
+				rays[i].direction = glm::vec2(cosf(direction), sinf(direction));
+			}
+			std::vector<ray2D> shadowRays(rayCount);
+			for (int i = 0; i < rayCount; i++)
+			{
+				//runs of RAY_PACKET_WIDTH neighbouring pixels of a 1000x1000 grid
+				glm::vec2 pixel((float)(i % 1000), (float)(i / 1000));
+				shadowRays[i].origin = pixel;
+				shadowRays[i].direction = light - pixel;
+				shadowRays[i].tMax = 0.999f;
+			}
+
+			double scalarSeconds[2];
+			double packetSeconds[2];
+			int scalarCount[2] = {};
+			int packetCount[2] = {};
+			for (int workload = 0; workload < 2; workload++)
+			{
+				const std::vector<ray2D>& batch = workload == 0 ? rays : shadowRays;
+				start = std::chrono::steady_clock::now();
+				for (const ray2D& ray : batch)
+				{
+					rayHit hit;
+					scalarCount[workload] += (workload == 0 ? scene.closestHit(ray, hit) : scene.anyHit(ray)) ? 1 : 0;
+				}
+				scalarSeconds[workload] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				start = std::chrono::steady_clock::now();
+				for (int first = 0; first < rayCount; first += RAY_PACKET_WIDTH)
+				{
+					rayPacket packet;
+					for (int lane = 0; lane < RAY_PACKET_WIDTH && first + lane < rayCount; lane++)
+					{
+						packet.set(lane, batch[first + lane]);
+					}
+					rayHit packetHits[RAY_PACKET_WIDTH];
+					int laneBits = workload == 0 ? scene.closestHit(packet, packetHits) : scene.anyHit(packet);
+					for (; laneBits != 0; laneBits &= laneBits - 1)
+					{
+						packetCount[workload]++;
+					}
+				}
+				packetSeconds[workload] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				if (scalarCount[workload] != packetCount[workload])
+				{
+					std::cout << "ERROR: packet traversal found " << packetCount[workload] << " hits instead of " << scalarCount[workload] << std::endl;
+				}
+			}
+			std::cout << "rays " << primitiveCount << " primitives, " << RAY_PACKET_WIDTH << " wide packets: light fan closest hit " << rayCount / scalarSeconds[0] / 1e6 << " -> " << rayCount / packetSeconds[0] / 1e6
+				<< " Mrays/s (" << scalarSeconds[0] / packetSeconds[0] << "x), pixel shadows any hit " << rayCount / scalarSeconds[1] / 1e6 << " -> " << rayCount / packetSeconds[1] / 1e6
+				<< " Mrays/s (" << scalarSeconds[1] / packetSeconds[1] << "x)" << std::endl;
+		}
+		//jump flood distance fields of a random occluder scene on the CPU and the GPU, full and after moving one circle
+		for (int fieldSize = 512; fieldSize <= options.sdfBenchSize; fieldSize *= 2)
+		{
+			std::mt19937 random(4321);
+			std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+			std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+			rayScene occluders;
+			for (int i = 0; i < 300; i++)
+			{
+				glm::vec2 start(position(random), position(random));
+				if (i % 5 == 0)
+				{
+					occluders.addCircle(start, 10.0f);
+				}
+				else
+				{
+					float direction = angle(random);
+					occluders.addSegment(start, start + glm::vec2(cosf(direction), sinf(direction)) * 40.0f);
+				}
+			}
+			occluders.build();
+
+			glm::vec2 viewMin(0.0f);
+			glm::vec2 viewMax(1000.0f);
+			distanceField cpuField(fieldSize, fieldSize);
+			gpuDistanceField gpuField(fieldSize, fieldSize);
+			threadPool pool;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			rasterizeOccluders(occluders, viewMin, viewMax, fieldSize, fieldSize, cpuField.mask());
+			double rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			cpuField.generate();
+			double serialMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			cpuField.generate(&pool);
+			double pooledMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			gpuField.generate(cpuField.mask());	//the first run pays for shader and texture setup in the driver
+			glFinish();
+			start = std::chrono::steady_clock::now();
+			gpuField.generate(cpuField.mask());
+			glFinish();
+			double gpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::vector<float> gpuDistances((size_t)fieldSize * fieldSize);
+			auto largestDifference = [&](const float* a, const float* b)
+			{
+				float difference = 0.0f;
+				for (size_t i = 0; i < gpuDistances.size(); i++)
+				{
+					difference = std::max(difference, fabsf(a[i] - b[i]));
+				}
+				return difference;
+			};
+			gpuField.readBack(gpuDistances.data());
+			float gpuDifference = largestDifference(cpuField.distances(), gpuDistances.data());
+
+			//move one circle by a few pixels and only refresh around its old and new place
+			const rayScene::primitive* moved = NULL;
+			for (const rayScene::primitive& shape : occluders.orderedPrimitives())
+			{
+				moved = shape.circle ? &shape : moved;
+			}
+			glm::vec2 oldCenter = moved->a;
+			glm::vec2 newCenter = oldCenter + glm::vec2(8.0f, 5.0f);
+			rayScene movedScene;
+			for (const rayScene::primitive& shape : occluders.orderedPrimitives())
+			{
+				if (&shape == moved)
+				{
+					movedScene.addCircle(newCenter, shape.b.x);
+				}
+				else if (shape.circle)
+				{
+					movedScene.addCircle(shape.a, shape.b.x);
+				}
+				else
+				{
+					movedScene.addSegment(shape.a, shape.b);
+				}
+			}
+			movedScene.build();
+			rasterizeOccluders(movedScene, viewMin, viewMax, fieldSize, fieldSize, cpuField.mask());
+
+			float pixelScale = fieldSize / 1000.0f;
+			glm::vec2 dirtyMin = (glm::min(oldCenter, newCenter) - moved->b.x) * pixelScale;
+			glm::vec2 dirtyMax = (glm::max(oldCenter, newCenter) + moved->b.x) * pixelScale;
+			int dirtyX0 = (int)floorf(dirtyMin.x) - 1;
+			int dirtyY0 = (int)floorf(dirtyMin.y) - 1;
+			int dirtyX1 = (int)ceilf(dirtyMax.x) + 1;
+			int dirtyY1 = (int)ceilf(dirtyMax.y) + 1;
+
+			start = std::chrono::steady_clock::now();
+			cpuField.update(dirtyX0, dirtyY0, dirtyX1, dirtyY1, &pool);
+			double cpuUpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			gpuField.update(cpuField.mask(), dirtyX0, dirtyY0, dirtyX1, dirtyY1);
+			glFinish();
+			double gpuUpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::vector<float> updated(cpuField.distances(), cpuField.distances() + gpuDistances.size());
+			cpuField.generate(&pool);
+			float updateDifference = largestDifference(updated.data(), cpuField.distances());
+			gpuField.readBack(gpuDistances.data());
+			float gpuUpdateDifference = largestDifference(cpuField.distances(), gpuDistances.data());
+
+			std::cout << "sdf " << fieldSize << "x" << fieldSize << ": raster " << rasterMilliseconds << " ms, cpu " << serialMilliseconds << " ms on 1 thread, " << pooledMilliseconds << " ms on " << pool.threadCount()
+				<< " threads, gpu " << gpuMilliseconds << " ms (max difference " << gpuDifference << " px), moved circle update cpu " << cpuUpdateMilliseconds << " ms, gpu " << gpuUpdateMilliseconds
+				<< " ms (max difference to a full flood " << std::max(updateDifference, gpuUpdateDifference) << " px)" << std::endl;
+		}
+
+		//cost of the lighting pass per light on the CPU and the GPU, then all lights together compared between both
+		if (shadows)
+		{
+			threadPool pool;
+			std::vector<float> cpuImage((size_t)shadowField->width() * shadowField->height() * 3);
+			target.bind();
+			shadows->draw(shadowFieldTexture, shadowField->width(), shadowField->height(), shadowLights, lighting);	//the first draw pays for the driver setup
+			glFinish();
+
+			auto measure = [&](const std::vector<light2D>& lights, double& cpuMilliseconds, double& gpuMilliseconds)
+			{
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				lightDistanceField(*shadowField, lights, lighting, cpuImage.data(), &pool);
+				cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				start = std::chrono::steady_clock::now();
+				shadows->draw(shadowFieldTexture, shadowField->width(), shadowField->height(), lights, lighting);
+				glFinish();
+				gpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			};
+
+			for (const light2D& light : shadowLights)
+			{
+				double cpuMilliseconds;
+				double gpuMilliseconds;
+				measure(std::vector<light2D>(1, light), cpuMilliseconds, gpuMilliseconds);
+				std::cout << "shadows light at " << light.position.x << "," << light.position.y << " radius " << light.radius << " range " << light.range << ": cpu " << cpuMilliseconds << " ms, gpu " << gpuMilliseconds << " ms" << std::endl;
+			}
+
+			double cpuMilliseconds;
+			double gpuMilliseconds;
+			measure(shadowLights, cpuMilliseconds, gpuMilliseconds);
+
+			std::vector<unsigned char> pixels((size_t)target.width * target.height * 4);
+			glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glReadPixels(0, 0, target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			//rays grazing a corner can hit on one side and miss on the other, so single pixels may differ a lot
+			int largestDifference = 0;
+			int differentPixels = 0;
+			for (size_t i = 0; i < cpuImage.size(); i += 3)
+			{
+				int pixelDifference = 0;
+				for (int channel = 0; channel < 3; channel++)
+				{
+					int cpuValue = (int)(std::min(std::max(cpuImage[i + channel], 0.0f), 1.0f) * 255.0f + 0.5f);
+					pixelDifference = std::max(pixelDifference, abs(cpuValue - pixels[i / 3 * 4 + channel]));
+				}
+				largestDifference = std::max(largestDifference, pixelDifference);
+				differentPixels += pixelDifference > 2 ? 1 : 0;
+			}
+			std::cout << "shadows " << shadowLights.size() << " lights: cpu " << cpuMilliseconds << " ms on " << pool.threadCount() << " threads, gpu " << gpuMilliseconds << " ms, largest difference " << largestDifference << "/255, " << differentPixels << " pixels differ by more than 2/255" << std::endl;
+
+			if (!options.outputDir.empty())
+			{
+				std::string path = options.outputDir + (options.writePng ? "/shadows.png" : "/shadows.rgba");
+				bool written = options.writePng ? writePngImage(path.c_str(), target.width, target.height, pixels.data()) : writeRawImage(path.c_str(), target.width, target.height, pixels.data());
+				if (!written)
+				{
+					std::cout << "ERROR: shadow image could not be written to " << path << std::endl;
+				}
+			}
+		}
+
+		//path tracing samples per second from one thread up to one per hardware thread, the last image is written next to the frames
+		if (tracer)
+		{
+			int hardwareThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+			double oneThreadRate = 0.0;
+			for (int threads = 1; threads <= hardwareThreads; threads = threads < hardwareThreads ? std::min(threads * 2, hardwareThreads) : threads + 1)
+			{
+				threadPool pool(threads);
+				tracer->reset();
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (int sample = 0; sample < options.pathTraceSamples; sample++)
+				{
+					tracer->addSample(pool);
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				double rate = (double)tracer->width() * tracer->height() * options.pathTraceSamples / seconds;
+				oneThreadRate = threads == 1 ? rate : oneThreadRate;
+				std::cout << "pathtrace " << threads << " threads: " << options.pathTraceSamples << " samples per pixel in " << seconds << " s, " << rate / 1e6 << " Msamples/s, "
+					<< tracer->tracedRays() / seconds / 1e6 << " Mrays/s, " << rate / oneThreadRate << "x of one thread" << std::endl;
+			}
+
+			target.bind();
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawPathTrace();
+
+			if (!options.outputDir.empty())
+			{
+				std::vector<unsigned char> pixels((size_t)target.width * target.height * 4);
+				glState().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+				glReadPixels(0, 0, target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+				std::string path = options.outputDir + (options.writePng ? "/pathtrace.png" : "/pathtrace.rgba");
+				bool written = options.writePng ? writePngImage(path.c_str(), target.width, target.height, pixels.data()) : writeRawImage(path.c_str(), target.width, target.height, pixels.data());
+				if (!written)
+				{
+					std::cout << "ERROR: path traced image could not be written to " << path << std::endl;
+				}
+			}
+		}
+		//==================================================================
+
+		destroyHeadlessContext();
+		return testsPassed ? 0 : 1;
+	}
+
+#ifndef SUSHRAY_HEADLESS_ONLY
+	//shaders are rebuilt while the program is running when their files are saved
+	shaderWatcher watcher;
+	watcher.watch(baseShader);
+	baseVariants.watchWith(watcher);
+
+	threadPool tracePool(tracer ? 0 : 1);	//one thread per hardware thread when path tracing
 
 	while (!glfwWindowShouldClose(window))	//renderloop which exits when the window is told to close
 	{
 		checkButtonClose(window);
+		watcher.poll();
 
 		//rendering
 		//==================================================================
@@ -183,15 +1560,30 @@ int main()
 		timeValue = glfwGetTime();
 		offsetValue = (sin(timeValue) / 2.0f) + 0.5f;
 
-		baseShader.use();
-
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		if (shadows)
+		{
+			//the lights circle slowly around their starting place
+			std::vector<light2D> movedLights = shadowLights;
+			for (size_t i = 0; i < movedLights.size(); i++)
+			{
+				float phase = timeValue * 0.5f + i * 1.7f;
+				movedLights[i].position += glm::vec2(cosf(phase), sinf(phase)) * 60.0f;
+			}
+			shadows->draw(shadowFieldTexture, shadowField->width(), shadowField->height(), movedLights, lighting);
+		}
+		else if (tracer)
+		{
+			//one more sample per pixel every frame until the requested count is reached
+			if (tracer->sampleCount() < options.pathTraceSamples)
+			{
+				tracer->addSample(tracePool);
+			}
+			drawPathTrace();
+		}
+		else
+		{
+			drawScene();
+		}
 
 		glfwSwapBuffers(window);	//swap back buffer (buffer thats being drawn on) and front buffer(buffer with image to be displayed)
 		//==================================================================
@@ -200,9 +1592,155 @@ int main()
 	}
 
 	glfwTerminate();	//clear allocated resources
+#endif
 	return 0;
 }
 
+launchOptions parseOptions(int argc, char* argv[])
+{
+	launchOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--headless")
+		{
+			options.headless = true;
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			options.frameCount = atoi(argv[++i]);
+		}
+		else if (argument == "--output" && i + 1 < argc)
+		{
+			options.outputDir = argv[++i];
+		}
+		else if (argument == "--format" && i + 1 < argc)
+		{
+			options.writePng = std::string(argv[++i]) != "raw";
+		}
+		else if (argument == "--draws" && i + 1 < argc)
+		{
+			options.drawCount = std::max(atoi(argv[++i]), 1);
+		}
+		else if (argument == "--shader-cache-bench")
+		{
+			options.shaderCacheBench = true;
+		}
+		else if (argument == "--shader-batch-bench" && i + 1 < argc)
+		{
+			options.shaderBatchPrograms = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--uniform-bench" && i + 1 < argc)
+		{
+			options.uniformUpdates = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--commands" && i + 1 < argc)
+		{
+			options.commandCount = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--sprites" && i + 1 < argc)
+		{
+			options.spriteCount = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--vertex-bench" && i + 1 < argc)
+		{
+			options.vertexBenchQuads = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--convert-vertices" && i + 2 < argc)
+		{
+			options.convertInput = argv[++i];
+			options.convertOutput = argv[++i];
+		}
+		else if (argument == "--instances" && i + 1 < argc)
+		{
+			options.instanceCount = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--atlas" && i + 1 < argc)
+		{
+			options.atlasImageCount = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--load-bench" && i + 1 < argc)
+		{
+			options.loadBenchDirectory = argv[++i];
+		}
+		else if (argument == "--texture-selftest")
+		{
+			options.textureSelfTest = true;
+		}
+		else if (argument == "--mip-bench" && i + 1 < argc)
+		{
+			options.mipBenchSize = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--compress" && i + 1 < argc)
+		{
+			std::string format = argv[++i];
+			options.textureCompression = format == "bc1" ? blockFormat::bc1 : format == "bc3" ? blockFormat::bc3 : blockFormat::none;
+		}
+		else if (argument == "--compress-bench")
+		{
+			options.compressionBench = true;
+		}
+		else if (argument == "--decode-bench" && i + 1 < argc)
+		{
+			options.decodeBenchFile = argv[++i];
+		}
+		else if (argument == "--ray-bench" && i + 1 < argc)
+		{
+			options.rayBenchPrimitives = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--sdf-bench" && i + 1 < argc)
+		{
+			options.sdfBenchSize = std::max(atoi(argv[++i]), 0);
+		}
+		else if (argument == "--shadows" && i + 1 < argc)
+		{
+			options.shadowLights = std::min(std::max(atoi(argv[++i]), 0), maxShadowLights);
+		}
+		else if (argument == "--pathtrace" && i + 1 < argc)
+		{
+			options.pathTraceSamples = std::max(atoi(argv[++i]), 0);
+		}
+		else
+		{
+			std::cout << "usage: SushRay2D [--headless] [--frames count] [--output directory] [--format png|raw] [--draws count] [--shader-cache-bench] [--shader-batch-bench programs] [--uniform-bench updates] [--commands count] [--sprites count] [--vertex-bench quads] [--convert-vertices input output] [--instances count] [--atlas count] [--load-bench directory] [--texture-selftest] [--mip-bench size] [--compress none|bc1|bc3] [--compress-bench] [--decode-bench image] [--ray-bench primitives] [--sdf-bench size] [--shadows lights] [--pathtrace samples]" << std::endl;
+		}
+	}
+	return options;
+}
+
+bool convertVertexFile(const std::string& inputPath, const std::string& outputPath, const vertexFormat& sourceFormat, const vertexFormat& targetFormat)
+{
+	std::ifstream input(inputPath, std::ios::binary);
+	if (!input)
+	{
+		std::cout << "ERROR: vertex file could not be opened " << inputPath << std::endl;
+		return false;
+	}
+	std::vector<char> vertexData((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	if (vertexData.size() % sourceFormat.stride() != 0)
+	{
+		std::cout << "ERROR: size of " << inputPath << " is not a multiple of " << sourceFormat.stride() << " byte vertices" << std::endl;
+		return false;
+	}
+	size_t vertexCount = vertexData.size() / sourceFormat.stride();
+	std::vector<unsigned char> converted = convertVertices(vertexData.data(), vertexCount, sourceFormat, targetFormat);
+
+	std::ofstream output(outputPath, std::ios::binary);
+	output.write((const char*)converted.data(), converted.size());
+	if (!output)
+	{
+		std::cout << "ERROR: converted vertices could not be written to " << outputPath << std::endl;
+		return false;
+	}
+
+	std::cout << "converted " << vertexCount << " vertices from " << vertexData.size() << " to " << converted.size() << " bytes" << std::endl;
+	return true;
+}
+
+#ifndef SUSHRAY_HEADLESS_ONLY
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	glViewport(0, 0, width, height);	//set viewport to new dimensions
@@ -215,3 +1753,259 @@ void checkButtonClose(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 	}
 }
+#endif
+
+bool textureSelfTest()
+{
+	const int width = 37;	//odd sizes so rows of most formats are not 4 byte aligned
+	const int height = 23;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "SushRay2DTextureSelfTest";
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	//8 and 16 bit PNGs with their own channel count, the HDR file holds RGB and is decoded to 1 to 4 channels
+	struct testImage
+	{
+		std::string path;
+		int channels;	//channels requested from the decoder, 0 keeps the channels of the file
+		const char* name;
+	};
+	std::vector<testImage> images;
+
+	std::vector<unsigned char> pixels8(width * height * 4);
+	std::vector<unsigned short> pixels16(width * height * 4);
+	std::vector<float> pixelsHdr(width * height * 3);
+	for (int i = 0; i < width * height * 4; i++)
+	{
+		pixels8[i] = (unsigned char)(i * 37 + i / width * 91);
+		pixels16[i] = (unsigned short)(i * 7919 + i / width * 104729);
+	}
+	for (int i = 0; i < width * height * 3; i++)
+	{
+		pixelsHdr[i] = (i % 97) * 0.0625f + (i % 3) * 0.001f;
+	}
+
+	const char* channelNames[] = { "grey", "grey alpha", "RGB", "RGBA" };
+	for (int channels = 1; channels <= 4; channels++)
+	{
+		std::string path8 = (directory / ("image8_" + std::to_string(channels) + ".png")).string();
+		std::string path16 = (directory / ("image16_" + std::to_string(channels) + ".png")).string();
+		if (!writePngImage(path8.c_str(), width, height, channels, 8, pixels8.data()) || !writePngImage(path16.c_str(), width, height, channels, 16, pixels16.data()))
+		{
+			std::cout << "ERROR: test images could not be written to " << directory.string() << std::endl;
+			return false;
+		}
+		images.push_back({ path8, 0, channelNames[channels - 1] });
+		images.push_back({ path16, 0, channelNames[channels - 1] });
+	}
+	std::string pathHdr = (directory / "imageHdr.hdr").string();
+	if (!writeHdrImage(pathHdr.c_str(), width, height, pixelsHdr.data()))
+	{
+		std::cout << "ERROR: test images could not be written to " << directory.string() << std::endl;
+		return false;
+	}
+	for (int channels = 1; channels <= 4; channels++)
+	{
+		images.push_back({ pathHdr, channels, channelNames[channels - 1] });
+	}
+
+	//a staging buffer smaller than most levels streams them in strips, the default one takes every level at once
+	size_t stagingSizes[] = { 64 * 1024 * 1024, 4096 };
+	bool storageAvailable = GLAD_GL_VERSION_4_2 != 0;
+	int tests = 0;
+	int failures = 0;
+	for (size_t stagingSize : stagingSizes)
+	{
+		for (int storage = 0; storage < 2; storage++)
+		{
+			bool immutable = storage == 0;
+			if (immutable && !storageAvailable)
+			{
+				continue;
+			}
+
+			textureParams params;
+			params.useCache = false;
+			params.immutableStorage = immutable;
+
+			std::vector<unsigned int> textures;
+			textureManager manager(0, stagingSize);
+			for (const testImage& image : images)
+			{
+				params.channels = image.channels;
+				textures.push_back(manager.load(image.path, params));
+			}
+			manager.finish();
+
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				//expected pixels are decoded the way the texture manager decodes them
+				std::ifstream file(images[i].path, std::ios::binary);
+				std::vector<unsigned char> fileData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+				imageInfo info;
+				unsigned char* expected = NULL;
+				if (readImageInfo(fileData.data(), fileData.size(), images[i].channels, params.highPrecision, info))
+				{
+					expected = decodeImage(fileData.data(), fileData.size(), info, params.flipVertically);
+				}
+
+				//without the decoded image there is nothing to size the readback by, the texture is not read
+				tests++;
+				if (!expected)
+				{
+					failures++;
+					std::cout << "ERROR: texture self test: " << images[i].name << " image " << images[i].path << " could not be decoded" << std::endl;
+					continue;
+				}
+				textureFormat format = uncompressedFormat(info.channels, info.type);
+
+				std::vector<unsigned char> readback(info.size());
+				GLint internalFormat = 0;
+				GLint immutableFormat = 0;
+				glState().bindTexture(0, GL_TEXTURE_2D, textures[i]);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+				glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutableFormat);
+				glPixelStorei(GL_PACK_ALIGNMENT, 1);
+				glGetTexImage(GL_TEXTURE_2D, 0, format.format, format.type, readback.data());
+				glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+				const char* problem = NULL;
+				if (internalFormat != (GLint)format.internalFormat)
+				{
+					problem = "has the wrong internal format";
+				}
+				else if ((immutableFormat != 0) != immutable)
+				{
+					problem = "has the wrong storage";
+				}
+				else if (memcmp(readback.data(), expected, readback.size()) != 0)
+				{
+					problem = "reads back different pixels";
+				}
+
+				if (problem)
+				{
+					failures++;
+					std::cout << "ERROR: texture self test: " << images[i].name << " " << (info.type == pixelType::float32 ? "float" : info.type == pixelType::unorm16 ? "16 bit" : "8 bit") << " image "
+						<< (immutable ? "in glTexStorage2D storage" : "in glTexImage2D storage") << " with " << stagingSize << " byte staging " << problem << std::endl;
+				}
+				freeImage(expected);
+			}
+
+			glDeleteTextures((GLsizei)textures.size(), textures.data());
+			for (unsigned int texture : textures)
+			{
+				glState().textureDeleted(texture);
+			}
+		}
+	}
+
+	std::filesystem::remove_all(directory, error);
+
+	std::cout << "texture self test: " << tests - failures << " of " << tests << " textures match" << (storageAvailable ? "" : " (glTexStorage2D needs GL 4.2, only glTexImage2D was tested)") << std::endl;
+	return failures == 0;
+}
+
+void buildPathTraceScene(rayScene& scene, std::vector<surfaceMaterial>& materials)
+{
+	auto addMaterial = [&](int id, const surfaceMaterial& material)
+	{
+		materials.resize(std::max((int)materials.size(), id + 1));
+		materials[id] = material;
+	};
+
+	surfaceMaterial wall;
+	wall.albedo = glm::vec3(0.5f);
+
+	surfaceMaterial warmLamp;
+	warmLamp.emission = glm::vec3(2.4f, 2.0f, 1.4f);
+	warmLamp.albedo = glm::vec3(0.0f);
+
+	surfaceMaterial blueLamp;
+	blueLamp.emission = glm::vec3(0.5f, 1.2f, 4.0f);
+	blueLamp.albedo = glm::vec3(0.0f);
+
+	surfaceMaterial mirror;
+	mirror.type = surfaceType::mirror;
+	mirror.albedo = glm::vec3(0.95f);
+
+	surfaceMaterial glass;
+	glass.type = surfaceType::glass;
+	glass.albedo = glm::vec3(0.98f);
+	glass.refractiveIndex = 1.5f;
+
+	surfaceMaterial red;
+	red.albedo = glm::vec3(0.8f, 0.15f, 0.1f);
+
+	//room with the image as its floor plan
+	glm::vec2 corners[] = { glm::vec2(10.0f, 10.0f), glm::vec2(990.0f, 10.0f), glm::vec2(990.0f, 790.0f), glm::vec2(10.0f, 790.0f) };
+	for (int i = 0; i < 4; i++)
+	{
+		addMaterial(scene.addSegment(corners[i], corners[(i + 1) % 4]), wall);
+	}
+
+	addMaterial(scene.addSegment(glm::vec2(600.0f, 700.0f), glm::vec2(800.0f, 700.0f)), warmLamp);
+	addMaterial(scene.addCircle(glm::vec2(150.0f, 150.0f), 20.0f), blueLamp);
+	addMaterial(scene.addSegment(glm::vec2(100.0f, 550.0f), glm::vec2(300.0f, 700.0f)), mirror);
+	addMaterial(scene.addCircle(glm::vec2(500.0f, 380.0f), 80.0f), glass);
+	addMaterial(scene.addSegment(glm::vec2(750.0f, 150.0f), glm::vec2(750.0f, 450.0f)), glass);
+
+	//solid red box
+	glm::vec2 box[] = { glm::vec2(250.0f, 250.0f), glm::vec2(350.0f, 250.0f), glm::vec2(350.0f, 320.0f), glm::vec2(250.0f, 320.0f) };
+	for (int i = 0; i < 4; i++)
+	{
+		addMaterial(scene.addSegment(box[i], box[(i + 1) % 4]), red);
+	}
+
+	scene.build();
+}
+
+void buildShadowScene(rayScene& occluders, std::vector<light2D>& lights, int lightCount)
+{
+	std::mt19937 random(2024);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<glm::vec3> bounds;	//circle around every occluder, the lights are kept out of them
+
+	for (int i = 0; i < 24; i++)
+	{
+		glm::vec2 center(60.0f + unit(random) * 880.0f, 60.0f + unit(random) * 680.0f);
+		if (i % 2 == 0)
+		{
+			float radius = 12.0f + unit(random) * 25.0f;
+			occluders.addCircle(center, radius);
+			bounds.push_back(glm::vec3(center, radius));
+		}
+		else
+		{
+			glm::vec2 halfSize(10.0f + unit(random) * 40.0f, 10.0f + unit(random) * 40.0f);
+			bounds.push_back(glm::vec3(center, glm::length(halfSize)));
+			glm::vec2 corners[] = { center - halfSize, glm::vec2(center.x + halfSize.x, center.y - halfSize.y), center + halfSize, glm::vec2(center.x - halfSize.x, center.y + halfSize.y) };
+			for (int corner = 0; corner < 4; corner++)
+			{
+				occluders.addSegment(corners[corner], corners[(corner + 1) % 4]);
+			}
+		}
+	}
+	occluders.build();
+
+	//from point lights to large area lights
+	for (int i = 0; i < lightCount; i++)
+	{
+		light2D light;
+		light.radius = i * 25.0f / std::max(lightCount - 1, 1);
+		bool clear = false;
+		while (!clear)
+		{
+			light.position = glm::vec2(100.0f + unit(random) * 800.0f, 100.0f + unit(random) * 600.0f);
+			clear = true;
+			for (const glm::vec3& bound : bounds)
+			{
+				clear = clear && glm::length(light.position - glm::vec2(bound)) > bound.z + light.radius + 10.0f;
+			}
+		}
+		light.color = glm::vec3(0.3f + unit(random) * 0.7f, 0.3f + unit(random) * 0.7f, 0.3f + unit(random) * 0.7f) * 0.8f;
+		light.range = 350.0f + unit(random) * 300.0f;
+		lights.push_back(light);
+	}
+}
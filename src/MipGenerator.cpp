@@ -0,0 +1,306 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static const int kaiserTaps = 8;
+static const int rowCacheSize = 8;	//enough source rows for every tap of one output row
+static const int linearTableSize = 4096;
+
+//conversion tables and filter weights shared by all levels
+struct mipTables
+{
+	float byteToFloat[256];	//byte to linear value of a color channel
+	unsigned char linearToByte[linearTableSize];	//linear value to encoded byte
+	float kaiserWeights[kaiserTaps];
+};
+
+//modified bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 20; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+static void buildTables(const mipSettings& settings, mipTables& tables)
+{
+	for (int i = 0; i < 256; i++)
+	{
+		double value = i / 255.0;
+		if (settings.srgb)
+		{
+			value = value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+		}
+		tables.byteToFloat[i] = (float)value;
+	}
+
+	for (int i = 0; i < linearTableSize; i++)
+	{
+		double value = (double)i / (linearTableSize - 1);
+		if (settings.srgb)
+		{
+			value = value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+		}
+		tables.linearToByte[i] = (unsigned char)std::min(255.0, value * 255.0 + 0.5);
+	}
+
+	//taps sit at source texels 2x-3 to 2x+4, their distance to the center of the output texel is (k - 3.5) / 2 output texels
+	const double pi = 3.14159265358979;
+	const double beta = 4.0;
+	const double radius = 2.0;
+	double sum = 0.0;
+	double weights[kaiserTaps];
+	for (int k = 0; k < kaiserTaps; k++)
+	{
+		double distance = (k - 3.5) / 2.0;
+		double sinc = sin(pi * distance) / (pi * distance);
+		double window = besselI0(beta * sqrt(1.0 - (distance / radius) * (distance / radius))) / besselI0(beta);
+		weights[k] = sinc * window;
+		sum += weights[k];
+	}
+	for (int k = 0; k < kaiserTaps; k++)
+	{
+		tables.kaiserWeights[k] = (float)(weights[k] / sum);
+	}
+}
+
+//convert a row of RGBA8 texels to linear float, premultiplied if requested
+static void decodeRow(const unsigned char* source, int width, const mipSettings& settings, const mipTables& tables, float* row)
+{
+	for (int x = 0; x < width; x++)
+	{
+		const unsigned char* texel = source + x * 4;
+		float alpha = texel[3] / 255.0f;
+		float scale = settings.premultipliedAlpha ? alpha : 1.0f;
+		row[x * 4] = tables.byteToFloat[texel[0]] * scale;
+		row[x * 4 + 1] = tables.byteToFloat[texel[1]] * scale;
+		row[x * 4 + 2] = tables.byteToFloat[texel[2]] * scale;
+		row[x * 4 + 3] = alpha;
+	}
+}
+
+//convert a row of linear float texels back to RGBA8
+static void encodeRow(const float* row, int width, const mipSettings& settings, const mipTables& tables, unsigned char* target)
+{
+#ifdef MIP_USE_SSE2
+	if (!settings.srgb && !settings.premultipliedAlpha)	//plain rescale, four channels at once
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_set1_ps(255.0f);
+		for (int x = 0; x < width; x++)
+		{
+			__m128 value = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + x * 4), zero), one), scale);
+			__m128i integer = _mm_cvtps_epi32(value);
+			integer = _mm_packs_epi32(integer, integer);
+			integer = _mm_packus_epi16(integer, integer);
+			int packed = _mm_cvtsi128_si32(integer);
+			memcpy(target + x * 4, &packed, 4);
+		}
+		return;
+	}
+#endif
+
+	for (int x = 0; x < width; x++)
+	{
+		const float* texel = row + x * 4;
+		float alpha = std::min(std::max(texel[3], 0.0f), 1.0f);
+		float scale = 1.0f;
+		if (settings.premultipliedAlpha)
+		{
+			scale = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+		}
+		for (int channel = 0; channel < 3; channel++)
+		{
+			float value = std::min(std::max(texel[channel] * scale, 0.0f), 1.0f);
+			target[x * 4 + channel] = tables.linearToByte[(int)(value * (linearTableSize - 1) + 0.5f)];
+		}
+		target[x * 4 + 3] = (unsigned char)(alpha * 255.0f + 0.5f);
+	}
+}
+
+//weighted sum of source rows into one row of width texels
+static void filterRows(const float* const* rows, const float* weights, int tapCount, int width, float* target)
+{
+	int x = 0;
+#ifdef __AVX2__
+	//two texels per iteration
+	for (; x + 2 <= width; x += 2)
+	{
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < tapCount; k++)
+		{
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + x * 4)));
+		}
+		_mm256_storeu_ps(target + x * 4, sum);
+	}
+#endif
+#ifdef MIP_USE_SSE2
+	for (; x < width; x++)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < tapCount; k++)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + x * 4)));
+		}
+		_mm_storeu_ps(target + x * 4, sum);
+	}
+#else
+	for (; x < width * 4; x++)
+	{
+		float sum = 0.0f;
+		for (int k = 0; k < tapCount; k++)
+		{
+			sum += weights[k] * rows[k][x];
+		}
+		target[x] = sum;
+	}
+#endif
+}
+
+//reduce a padded row to half its width, the row has padding texels on the left and right that repeat the edge
+static void filterColumns(const float* row, const float* weights, int tapCount, int firstTap, int width, float* target)
+{
+	for (int x = 0; x < width; x++)
+	{
+		const float* taps = row + (2 * x + firstTap) * 4;
+#ifdef MIP_USE_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < tapCount; k++)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(taps + k * 4)));
+		}
+		_mm_storeu_ps(target + x * 4, sum);
+#else
+		for (int channel = 0; channel < 4; channel++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < tapCount; k++)
+			{
+				sum += weights[k] * taps[k * 4 + channel];
+			}
+			target[x * 4 + channel] = sum;
+		}
+#endif
+	}
+}
+
+//filter one level into the next smaller one
+static void downsampleLevel(const unsigned char* source, int width, int height, unsigned char* target, int targetWidth, int targetHeight, const mipSettings& settings, const mipTables& tables)
+{
+	static const float boxWeights[] = { 0.5f, 0.5f };
+	const float* weights = settings.filter == mipFilter::kaiser ? tables.kaiserWeights : boxWeights;
+	int tapCount = settings.filter == mipFilter::kaiser ? kaiserTaps : 2;
+	int firstTap = settings.filter == mipFilter::kaiser ? -3 : 0;	//offset of the first tap from 2x
+	const int pad = 4;	//texels repeated left and right of a filtered row
+
+	//decoded source rows, a row stays cached until its slot is needed by a row further down
+	std::vector<float> rowCache((size_t)rowCacheSize * width * 4);
+	int cachedRows[rowCacheSize];
+	std::fill(cachedRows, cachedRows + rowCacheSize, -1);
+
+	std::vector<float> verticalRow((size_t)(width + 2 * pad) * 4);
+	std::vector<float> outputRow((size_t)targetWidth * 4);
+	const float* rows[kaiserTaps];
+
+	for (int y = 0; y < targetHeight; y++)
+	{
+		//vertical pass over the source rows of all taps
+		for (int k = 0; k < tapCount; k++)
+		{
+			int sourceRow = std::min(std::max(2 * y + firstTap + k, 0), height - 1);
+			int slot = sourceRow % rowCacheSize;
+			float* cached = rowCache.data() + (size_t)slot * width * 4;
+			if (cachedRows[slot] != sourceRow)
+			{
+				decodeRow(source + (size_t)sourceRow * width * 4, width, settings, tables, cached);
+				cachedRows[slot] = sourceRow;
+			}
+			rows[k] = cached;
+		}
+		float* filtered = verticalRow.data() + pad * 4;
+		filterRows(rows, weights, tapCount, width, filtered);
+
+		//repeat the edge texels so the horizontal pass needs no clamping
+		for (int p = 1; p <= pad; p++)
+		{
+			memcpy(filtered - p * 4, filtered, 4 * sizeof(float));
+			memcpy(filtered + (width - 1 + p) * 4, filtered + (width - 1) * 4, 4 * sizeof(float));
+		}
+
+		//horizontal pass
+		filterColumns(filtered, weights, tapCount, firstTap, targetWidth, outputRow.data());
+		encodeRow(outputRow.data(), targetWidth, settings, tables, target + (size_t)y * targetWidth * 4);
+	}
+}
+
+int mipLevelCount(int width, int height)
+{
+	int count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		count++;
+	}
+	return count;
+}
+
+void generateMipChain(const unsigned char* pixels, int width, int height, const mipSettings& settings, std::vector<unsigned char>& mipData, std::vector<cachedLevel>& levels)
+{
+	mipTables tables;
+	buildTables(settings, tables);
+
+	//size of all generated levels
+	size_t totalSize = 0;
+	for (int levelWidth = width, levelHeight = height; levelWidth > 1 || levelHeight > 1;)
+	{
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+		totalSize += (size_t)levelWidth * levelHeight * 4;
+	}
+	mipData.resize(totalSize);
+
+	levels.clear();
+	cachedLevel level;
+	level.width = width;
+	level.height = height;
+	level.pixels = pixels;
+	levels.push_back(level);
+
+	size_t offset = 0;
+	while (level.width > 1 || level.height > 1)
+	{
+		cachedLevel next;
+		next.width = std::max(level.width / 2, 1);
+		next.height = std::max(level.height / 2, 1);
+		next.pixels = mipData.data() + offset;
+
+		downsampleLevel(level.pixels, level.width, level.height, (unsigned char*)next.pixels, next.width, next.height, settings, tables);
+
+		offset += (size_t)next.width * next.height * 4;
+		levels.push_back(next);
+		level = next;
+	}
+}
+
+unsigned int mipSettingsHash(const mipSettings& settings)
+{
+	return 1u | ((unsigned int)settings.filter << 1) | (settings.srgb ? 8u : 0u) | (settings.premultipliedAlpha ? 16u : 0u);
+}
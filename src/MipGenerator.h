@@ -0,0 +1,34 @@
+#pragma once
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include "TextureCache.h"
+
+#include <vector>
+
+//filter used to reduce a level to the next smaller one
+enum class mipFilter
+{
+	box,	//average of 2x2 texels, fast but blurry and aliasing on fine detail
+	kaiser	//8 tap Kaiser windowed sinc, keeps the levels sharp
+};
+
+//settings of the CPU mip generation
+struct mipSettings
+{
+	mipFilter filter = mipFilter::box;
+	bool srgb = false;	//color channels are sRGB encoded and filtered in linear space
+	bool premultipliedAlpha = false;	//weight colors by alpha while filtering so transparent texels do not bleed into visible ones
+};
+
+//number of levels of a full mip chain including level 0
+int mipLevelCount(int width, int height);
+
+//generate levels 1 to n of an RGBA8 image on the CPU, the pixels of all levels are stored back to back in mipData
+//levels receives level 0 (pointing at pixels) followed by the generated levels (pointing into mipData)
+//every level is filtered from the previous one, the inner loops use SSE2 and AVX2 if the compiler targets them
+void generateMipChain(const unsigned char* pixels, int width, int height, const mipSettings& settings, std::vector<unsigned char>& mipData, std::vector<cachedLevel>& levels);
+
+unsigned int mipSettingsHash(const mipSettings& settings);	//distinct value per setting combination, used in cache keys
+
+#endif // !MIP_GENERATOR_H
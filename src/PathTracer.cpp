@@ -0,0 +1,200 @@
+#include "PathTracer.h"
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+static const float pi = 3.14159265f;
+static const int minBounces = 3;	//paths are only cut short by russian roulette after these bounces
+
+//small fast generator, every pixel and sample gets its own stream so the image does not depend on how the tiles were scheduled
+struct randomStream
+{
+	unsigned int state;
+
+	randomStream(unsigned int pixel, unsigned int sample)
+	{
+		state = hashInt(pixel * 0x9E3779B9u ^ hashInt(sample + 0x632BE5ABu));
+	}
+
+	static unsigned int hashInt(unsigned int value)
+	{
+		value ^= value >> 16;
+		value *= 0x7FEB352Du;
+		value ^= value >> 15;
+		value *= 0x846CA68Bu;
+		value ^= value >> 16;
+		return value;
+	}
+
+	float next()	//uniform in [0, 1)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	}
+};
+
+static glm::vec2 reflect(glm::vec2 direction, glm::vec2 normal)
+{
+	return direction - 2.0f * glm::dot(direction, normal) * normal;
+}
+
+//chance of a reflection on a glass surface, Schlick's approximation of the Fresnel term
+static float fresnel(float cosine, float refractiveRatio)
+{
+	float r0 = (1.0f - refractiveRatio) / (1.0f + refractiveRatio);
+	r0 *= r0;
+	float m = 1.0f - cosine;
+	return r0 + (1.0f - r0) * m * m * m * m * m;
+}
+
+pathTracer::pathTracer(int width, int height)
+	: imageWidth(width), imageHeight(height), rayCounter(0)
+{
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	viewMin = glm::vec2(0.0f);
+	viewMax = glm::vec2((float)width, (float)height);
+	accumulation.assign((size_t)width * height * 3, 0.0f);
+}
+
+void pathTracer::setScene(const rayScene* scene, const std::vector<surfaceMaterial>& materials)
+{
+	this->scene = scene;
+	this->materials = materials;
+	this->materials.resize(scene->primitiveCount());
+
+	circles.assign(scene->primitiveCount(), false);
+	for (const rayScene::primitive& shape : scene->orderedPrimitives())
+	{
+		circles[shape.id] = shape.circle;
+	}
+	reset();
+}
+
+void pathTracer::setView(glm::vec2 viewMin, glm::vec2 viewMax)
+{
+	this->viewMin = viewMin;
+	this->viewMax = viewMax;
+	reset();
+}
+
+void pathTracer::reset()
+{
+	std::fill(accumulation.begin(), accumulation.end(), 0.0f);
+	samples = 0;
+	rayCounter = 0;
+}
+
+void pathTracer::addSample(threadPool& pool)
+{
+	if (scene == NULL)
+	{
+		std::cout << "ERROR: path tracer has no scene" << std::endl;
+		return;
+	}
+
+	//tiles are numbered row by row, so the share every worker starts with is one coherent band of the image
+	pool.parallelFor(tilesX * tilesY, [this](int tile) { traceTile(tile); });
+	samples++;
+}
+
+void pathTracer::resolve(float* rgb) const
+{
+	float scale = samples > 0 ? 1.0f / samples : 0.0f;
+	for (size_t i = 0; i < accumulation.size(); i++)
+	{
+		rgb[i] = accumulation[i] * scale;
+	}
+}
+
+void pathTracer::traceTile(int tile)
+{
+	int startX = (tile % tilesX) * tileSize;
+	int startY = (tile / tilesX) * tileSize;
+	int endX = std::min(startX + tileSize, imageWidth);
+	int endY = std::min(startY + tileSize, imageHeight);
+	glm::vec2 pixelSize = (viewMax - viewMin) / glm::vec2((float)imageWidth, (float)imageHeight);
+	long long rays = 0;
+
+	for (int y = startY; y < endY; y++)
+	{
+		for (int x = startX; x < endX; x++)
+		{
+			int pixel = y * imageWidth + x;
+			randomStream random((unsigned int)pixel, (unsigned int)samples);
+
+			//the directions are stratified, every 64 samples of a pixel cover each slice of the circle once in a shuffled order
+			unsigned int stratum = ((unsigned int)samples * 7919u + randomStream::hashInt((unsigned int)pixel)) % 64u;
+			float angle = 2.0f * pi * (random.next() + (float)stratum) / 64.0f;
+			ray2D ray;
+			ray.origin = viewMin + (glm::vec2((float)x, (float)y) + glm::vec2(random.next(), random.next())) * pixelSize;
+			ray.direction = glm::vec2(cosf(angle), sinf(angle));
+
+			glm::vec3 radiance(0.0f);
+			glm::vec3 throughput(1.0f);
+			for (int bounce = 0; bounce < maxBounces; bounce++)
+			{
+				rayHit hit;
+				rays++;
+				if (!scene->closestHit(ray, hit))
+				{
+					break;
+				}
+
+				const surfaceMaterial& material = materials[hit.primitive];
+				radiance += throughput * material.emission;
+				ray.origin += ray.direction * hit.t;
+
+				if (material.type == surfaceType::mirror)
+				{
+					ray.direction = reflect(ray.direction, hit.normal);
+				}
+				else if (material.type == surfaceType::glass)
+				{
+					//rays leaving a circle go from glass to air
+					float refractiveRatio = hit.inside ? material.refractiveIndex : 1.0f / material.refractiveIndex;
+					float cosine = -glm::dot(ray.direction, hit.normal);
+					float sine2 = refractiveRatio * refractiveRatio * (1.0f - cosine * cosine);
+					if (sine2 > 1.0f || random.next() < fresnel(cosine, refractiveRatio))
+					{
+						ray.direction = reflect(ray.direction, hit.normal);
+					}
+					else if (circles[hit.primitive])	//a thin pane shifts the ray by too little to matter, only circles bend it
+					{
+						ray.direction = refractiveRatio * ray.direction + (refractiveRatio * cosine - sqrtf(1.0f - sine2)) * hit.normal;
+					}
+				}
+				else
+				{
+					//scatter with a cosine distribution around the normal, which cancels the cosine of the lambert term
+					float sine = 2.0f * random.next() - 1.0f;
+					glm::vec2 tangent(-hit.normal.y, hit.normal.x);
+					ray.direction = hit.normal * sqrtf(1.0f - sine * sine) + tangent * sine;
+				}
+				throughput *= material.albedo;
+
+				if (bounce >= minBounces)
+				{
+					float survival = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+					if (random.next() >= survival)
+					{
+						break;
+					}
+					throughput /= survival;
+				}
+			}
+
+			float* sum = &accumulation[(size_t)pixel * 3];
+			sum[0] += radiance.x;
+			sum[1] += radiance.y;
+			sum[2] += radiance.z;
+		}
+	}
+
+	rayCounter += rays;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef PATH_TRACER_H
+#define PATH_TRACER_H
+
+#include "RayScene.h"
+#include "ThreadPool.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <atomic>
+
+//how light leaves a surface after hitting it
+enum class surfaceType
+{
+	diffuse,	//scattered into a random direction of the lit side
+	mirror,	//reflected
+	glass	//refracted or reflected by the Fresnel term, segments act as thin panes and circles as solid lenses
+};
+
+//material of one primitive of the traced scene
+struct surfaceMaterial
+{
+	glm::vec3 emission = glm::vec3(0.0f);	//light given off by the surface
+	glm::vec3 albedo = glm::vec3(0.5f);	//fraction of the arriving light that is scattered on
+	surfaceType type = surfaceType::diffuse;
+	float refractiveIndex = 1.5f;	//used by glass
+};
+
+//progressive 2D path tracer, every pixel is a point of the scene that gathers the light arriving from all directions
+//each call of addSample traces one more path per pixel into a float accumulation buffer, tiles of the image are spread over a thread pool
+class pathTracer
+{
+public:
+	static const int tileSize = 32;	//edge length of the square tiles in pixels
+	int maxBounces = 8;
+
+	pathTracer(int width, int height);
+
+	void setScene(const rayScene* scene, const std::vector<surfaceMaterial>& materials);	//materials are indexed by primitive id, the scene has to be built
+	void setView(glm::vec2 viewMin, glm::vec2 viewMax);	//area of the scene covered by the image, one unit per pixel by default
+	void reset();	//drop the accumulated samples, needed after the scene or view changed
+
+	void addSample(threadPool& pool);	//blocks until every pixel got its sample
+	void resolve(float* rgb) const;	//average of all samples as 3 floats per pixel, bottom row first like a texture upload
+
+	int width() const { return imageWidth; }
+	int height() const { return imageHeight; }
+	int sampleCount() const { return samples; }
+	long long tracedRays() const { return rayCounter; }	//rays traced since the last reset
+
+private:
+	int imageWidth;
+	int imageHeight;
+	int tilesX;
+	int tilesY;
+	const rayScene* scene = NULL;
+	std::vector<surfaceMaterial> materials;
+	std::vector<bool> circles;	//indexed by primitive id, glass circles refract and glass segments do not
+	glm::vec2 viewMin;
+	glm::vec2 viewMax;
+
+	std::vector<float> accumulation;	//sum of all samples, 3 floats per pixel
+	int samples = 0;
+	std::atomic<long long> rayCounter;
+
+	void traceTile(int tile);
+};
+
+#endif // !PATH_TRACER_H
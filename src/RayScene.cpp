@@ -0,0 +1,1033 @@
+#include "RayScene.h"
+
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef __AVX2__
+#define RAY_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAY_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static const int binCount = 16;
+static const int maxLeafSize = 8;	//leaves are only made smaller if the SAH says splitting pays off
+static const int blockLeafSize = 4;	//smaller groups always become a leaf, one block test costs the same for up to four primitives
+static const int maxSahDepth = 64;	//deeper nodes are split in the middle, which bounds the depth and with it the traversal stack
+static const int stackSize = 3 * 96;	//a node leaves at most three children on the stack and the collapsed tree is not deeper than the binary one
+
+//axis aligned box of a primitive
+static void primitiveBounds(const rayScene::primitive& shape, glm::vec2& boundsMin, glm::vec2& boundsMax)
+{
+	if (shape.circle)
+	{
+		glm::vec2 radius(shape.b.x);
+		boundsMin = shape.a - radius;
+		boundsMax = shape.a + radius;
+	}
+	else
+	{
+		boundsMin = glm::min(shape.a, shape.b);
+		boundsMax = glm::max(shape.a, shape.b);
+	}
+}
+
+//the 2D counterpart of the surface area in the SAH, proportional to the chance of a random line crossing the box
+static float halfPerimeter(glm::vec2 boundsMin, glm::vec2 boundsMax)
+{
+	glm::vec2 extent = glm::max(boundsMax - boundsMin, glm::vec2(0.0f));
+	return extent.x + extent.y;
+}
+
+//index of the lowest set bit, bits must not be 0
+static inline int lowestBit(int bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, (unsigned long)bits);
+	return (int)index;
+#else
+	return __builtin_ctz((unsigned int)bits);
+#endif
+}
+
+//single ray prepared for the child tests, the side of a box the ray enters through is picked by the sign of its direction
+//this needs no min and max per slab, and inverted boxes are never entered
+struct traversalRay
+{
+	glm::vec2 origin;
+	glm::vec2 inverseDirection;
+	bool negativeX;	//boxes are entered through their max x side
+	bool negativeY;
+	float tMin;
+};
+
+//entry distances into the four children of a node, returns a bit for every child entered within [tMin, tMax]
+static int intersectChildren(const rayScene::bvhNode& node, const traversalRay& ray, float tMax, float* tEntry)
+{
+	const float* nearX = ray.negativeX ? node.maxX : node.minX;
+	const float* farX = ray.negativeX ? node.minX : node.maxX;
+	const float* nearY = ray.negativeY ? node.maxY : node.minY;
+	const float* farY = ray.negativeY ? node.minY : node.maxY;
+
+#if defined(RAY_USE_AVX2) || defined(RAY_USE_SSE2)
+	__m128 originX = _mm_set1_ps(ray.origin.x);
+	__m128 originY = _mm_set1_ps(ray.origin.y);
+	__m128 inverseX = _mm_set1_ps(ray.inverseDirection.x);
+	__m128 inverseY = _mm_set1_ps(ray.inverseDirection.y);
+	__m128 tNear = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX), originX), inverseX), _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY), originY), inverseY));
+	__m128 tFar = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX), originX), inverseX), _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY), originY), inverseY));
+	tNear = _mm_max_ps(tNear, _mm_set1_ps(ray.tMin));
+	tFar = _mm_min_ps(tFar, _mm_set1_ps(tMax));
+	_mm_storeu_ps(tEntry, tNear);
+	return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+#else
+	int entered = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float tNear = std::max(std::max((nearX[i] - ray.origin.x) * ray.inverseDirection.x, (nearY[i] - ray.origin.y) * ray.inverseDirection.y), ray.tMin);
+		float tFar = std::min(std::min((farX[i] - ray.origin.x) * ray.inverseDirection.x, (farY[i] - ray.origin.y) * ray.inverseDirection.y), tMax);
+		tEntry[i] = tNear;
+		entered |= (tNear <= tFar ? 1 : 0) << i;
+	}
+	return entered;
+#endif
+}
+
+//distances to the four primitives of a block, returns a bit for every primitive hit within (tMin, tMax)
+//segments and circles share the work up to a division by the cross product of direction and edge or the squared length of the direction
+//the interval tests are done on the numerators, so only blocks with a hit pay for the division
+static int intersectBlock(const rayScene::primitiveBlock& block, const ray2D& ray, float tMax, float* t)
+{
+	float a = glm::dot(ray.direction, ray.direction);
+
+#if defined(RAY_USE_AVX2) || defined(RAY_USE_SSE2)
+	__m128 directionX = _mm_set1_ps(ray.direction.x);
+	__m128 directionY = _mm_set1_ps(ray.direction.y);
+	__m128 toStartX = _mm_sub_ps(_mm_load_ps(block.aX), _mm_set1_ps(ray.origin.x));
+	__m128 toStartY = _mm_sub_ps(_mm_load_ps(block.aY), _mm_set1_ps(ray.origin.y));
+	__m128 edgeX = _mm_load_ps(block.edgeX);
+	__m128 edgeY = _mm_load_ps(block.edgeY);
+	__m128 circle = _mm_castsi128_ps(_mm_load_si128((const __m128i*)block.circle));
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 denominator = _mm_sub_ps(_mm_mul_ps(directionX, edgeY), _mm_mul_ps(directionY, edgeX));
+	__m128 segmentT = _mm_sub_ps(_mm_mul_ps(toStartX, edgeY), _mm_mul_ps(toStartY, edgeX));
+	__m128 segmentS = _mm_sub_ps(_mm_mul_ps(toStartX, directionY), _mm_mul_ps(toStartY, directionX));
+
+	__m128 b = _mm_add_ps(_mm_mul_ps(toStartX, directionX), _mm_mul_ps(toStartY, directionY));	//minus the dot product of the offset from the center and the direction
+	__m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(toStartX, toStartX), _mm_mul_ps(toStartY, toStartY)), _mm_load_ps(block.radiusSquared));
+	__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(a), c));
+	__m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+
+	//numerators of t of a segment or entry of a circle, and of the position on the segment or exit of a circle, with the signs flipped to make the divisor positive
+	__m128 divisor = _mm_or_ps(_mm_and_ps(circle, _mm_set1_ps(a)), _mm_andnot_ps(circle, denominator));
+	__m128 sign = _mm_and_ps(divisor, _mm_set1_ps(-0.0f));
+	__m128 first = _mm_xor_ps(_mm_or_ps(_mm_and_ps(circle, _mm_sub_ps(b, root)), _mm_andnot_ps(circle, segmentT)), sign);
+	__m128 second = _mm_xor_ps(_mm_or_ps(_mm_and_ps(circle, _mm_add_ps(b, root)), _mm_andnot_ps(circle, segmentS)), sign);
+	divisor = _mm_xor_ps(divisor, sign);
+
+	//parallel segments have a divisor of 0 and unused slots are NaN, both fail the comparisons
+	__m128 tMinScaled = _mm_mul_ps(_mm_set1_ps(ray.tMin), divisor);
+	__m128 inside = _mm_and_ps(circle, _mm_cmple_ps(first, tMinScaled));	//origin inside of the circle, the exit point is hit
+	__m128 numerator = _mm_or_ps(_mm_and_ps(inside, second), _mm_andnot_ps(inside, first));
+	__m128 onSegment = _mm_and_ps(_mm_cmple_ps(zero, second), _mm_cmple_ps(second, divisor));
+	__m128 valid = _mm_or_ps(_mm_and_ps(circle, _mm_cmple_ps(zero, discriminant)), _mm_andnot_ps(circle, onSegment));
+	__m128 hit = _mm_and_ps(valid, _mm_and_ps(_mm_cmplt_ps(tMinScaled, numerator), _mm_cmplt_ps(numerator, _mm_mul_ps(_mm_set1_ps(tMax), divisor))));
+	int hitBits = _mm_movemask_ps(hit);
+	if (hitBits != 0)
+	{
+		_mm_storeu_ps(t, _mm_div_ps(numerator, divisor));
+	}
+	return hitBits;
+#else
+	int hitBits = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float toStartX = block.aX[i] - ray.origin.x;
+		float toStartY = block.aY[i] - ray.origin.y;
+		bool valid;
+		if (block.circle[i])
+		{
+			float b = toStartX * ray.direction.x + toStartY * ray.direction.y;
+			float discriminant = b * b - a * (toStartX * toStartX + toStartY * toStartY - block.radiusSquared[i]);
+			float root = sqrtf(std::max(discriminant, 0.0f));
+			t[i] = (b - root) / a;
+			if (t[i] <= ray.tMin)
+			{
+				t[i] = (b + root) / a;
+			}
+			valid = discriminant >= 0.0f;
+		}
+		else
+		{
+			float denominator = ray.direction.x * block.edgeY[i] - ray.direction.y * block.edgeX[i];
+			float s = (toStartX * ray.direction.y - toStartY * ray.direction.x) / denominator;
+			t[i] = (toStartX * block.edgeY[i] - toStartY * block.edgeX[i]) / denominator;
+			valid = s >= 0.0f && s <= 1.0f;
+		}
+		hitBits |= (valid && t[i] > ray.tMin && t[i] < tMax ? 1 : 0) << i;
+	}
+	return hitBits;
+#endif
+}
+
+static void fillHit(const rayScene::primitive& shape, const ray2D& ray, float t, rayHit& hit)
+{
+	hit.t = t;
+	hit.primitive = shape.id;
+	if (shape.circle)
+	{
+		hit.normal = (ray.origin + ray.direction * t - shape.a) / shape.b.x;
+	}
+	else
+	{
+		glm::vec2 edge = shape.b - shape.a;
+		hit.normal = glm::normalize(glm::vec2(-edge.y, edge.x));
+	}
+	hit.inside = false;
+	if (glm::dot(hit.normal, ray.direction) > 0.0f)	//face the origin of the ray
+	{
+		hit.normal = -hit.normal;
+		hit.inside = shape.circle;
+	}
+}
+
+static glm::vec2 inverse(glm::vec2 direction)
+{
+	//tiny components instead of zero keep the slab test free of 0 * inf
+	glm::vec2 safe;
+	safe.x = fabsf(direction.x) > 1e-20f ? direction.x : copysignf(1e-20f, direction.x);
+	safe.y = fabsf(direction.y) > 1e-20f ? direction.y : copysignf(1e-20f, direction.y);
+	return 1.0f / safe;
+}
+
+static traversalRay prepareRay(const ray2D& ray)
+{
+	traversalRay prepared;
+	prepared.origin = ray.origin;
+	prepared.inverseDirection = inverse(ray.direction);
+	prepared.negativeX = prepared.inverseDirection.x < 0.0f;
+	prepared.negativeY = prepared.inverseDirection.y < 0.0f;
+	prepared.tMin = ray.tMin;
+	return prepared;
+}
+
+int rayScene::addSegment(glm::vec2 a, glm::vec2 b)
+{
+	primitive shape;
+	shape.a = a;
+	shape.b = b;
+	shape.id = nextId++;
+	shape.circle = false;
+	primitives.push_back(shape);
+	return shape.id;
+}
+
+int rayScene::addCircle(glm::vec2 center, float radius)
+{
+	primitive shape;
+	shape.a = center;
+	shape.b = glm::vec2(fabsf(radius), 0.0f);
+	shape.id = nextId++;
+	shape.circle = true;
+	primitives.push_back(shape);
+	return shape.id;
+}
+
+void rayScene::clear()
+{
+	primitives.clear();
+	bvhNodes.clear();
+	blocks.clear();
+	buildStats = rayBvhStats();
+	nextId = 0;
+}
+
+void rayScene::build()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<glm::vec2> centroids(primitives.size());
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		glm::vec2 boundsMin;
+		glm::vec2 boundsMax;
+		primitiveBounds(primitives[i], boundsMin, boundsMax);
+		centroids[i] = (boundsMin + boundsMax) * 0.5f;
+	}
+
+	std::vector<binaryNode> tree;
+	tree.reserve(primitives.size() * 2 / 3 + 1);
+	bvhNodes.clear();
+	blocks.clear();
+	buildStats = rayBvhStats();
+	buildStats.primitives = (int)primitives.size();
+	if (!primitives.empty())
+	{
+		buildNode(tree, 0, (int)primitives.size(), 1, centroids);
+		bvhNodes.reserve(tree.size() / 3 + 1);
+		blocks.reserve(primitives.size() / 2 + 1);
+		collapseNode(tree, 0, 1);
+	}
+	buildStats.nodes = (int)bvhNodes.size();
+	buildStats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int rayScene::buildNode(std::vector<binaryNode>& tree, int first, int count, int depth, std::vector<glm::vec2>& centroids)
+{
+	int index = (int)tree.size();
+	tree.push_back(binaryNode());
+
+	glm::vec2 boundsMin(1e30f);
+	glm::vec2 boundsMax(-1e30f);
+	glm::vec2 centroidMin(1e30f);
+	glm::vec2 centroidMax(-1e30f);
+	for (int i = first; i < first + count; i++)
+	{
+		glm::vec2 shapeMin;
+		glm::vec2 shapeMax;
+		primitiveBounds(primitives[i], shapeMin, shapeMax);
+		boundsMin = glm::min(boundsMin, shapeMin);
+		boundsMax = glm::max(boundsMax, shapeMax);
+		centroidMin = glm::min(centroidMin, centroids[i]);
+		centroidMax = glm::max(centroidMax, centroids[i]);
+	}
+	tree[index].boundsMin = boundsMin;
+	tree[index].boundsMax = boundsMax;
+
+	//find the cheapest split of the centroids into bins along either axis
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = 1e30f;
+	if (count > 2 && depth < maxSahDepth)
+	{
+		for (int axis = 0; axis < 2; axis++)
+		{
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+			float scale = binCount / extent;
+
+			int binPrimitives[binCount] = {};
+			glm::vec2 binMin[binCount];
+			glm::vec2 binMax[binCount];
+			std::fill(binMin, binMin + binCount, glm::vec2(1e30f));
+			std::fill(binMax, binMax + binCount, glm::vec2(-1e30f));
+			for (int i = first; i < first + count; i++)
+			{
+				int bin = std::min((int)((centroids[i][axis] - centroidMin[axis]) * scale), binCount - 1);
+				glm::vec2 shapeMin;
+				glm::vec2 shapeMax;
+				primitiveBounds(primitives[i], shapeMin, shapeMax);
+				binPrimitives[bin]++;
+				binMin[bin] = glm::min(binMin[bin], shapeMin);
+				binMax[bin] = glm::max(binMax[bin], shapeMax);
+			}
+
+			//sweep from the right to get the cost of every right side, then from the left
+			float rightCost[binCount];
+			glm::vec2 sweepMin(1e30f);
+			glm::vec2 sweepMax(-1e30f);
+			int sweepCount = 0;
+			for (int bin = binCount - 1; bin > 0; bin--)
+			{
+				sweepMin = glm::min(sweepMin, binMin[bin]);
+				sweepMax = glm::max(sweepMax, binMax[bin]);
+				sweepCount += binPrimitives[bin];
+				rightCost[bin] = sweepCount * halfPerimeter(sweepMin, sweepMax);
+			}
+
+			sweepMin = glm::vec2(1e30f);
+			sweepMax = glm::vec2(-1e30f);
+			sweepCount = 0;
+			for (int bin = 0; bin < binCount - 1; bin++)
+			{
+				sweepMin = glm::min(sweepMin, binMin[bin]);
+				sweepMax = glm::max(sweepMax, binMax[bin]);
+				sweepCount += binPrimitives[bin];
+				float cost = sweepCount * halfPerimeter(sweepMin, sweepMax) + rightCost[bin + 1];
+				if (sweepCount > 0 && sweepCount < count && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = bin + 1;
+				}
+			}
+		}
+	}
+
+	//keep a leaf if splitting does not lower the expected cost of testing every primitive
+	float leafCost = count * halfPerimeter(boundsMin, boundsMax);
+	bool makeLeaf = count <= blockLeafSize || (count <= maxLeafSize && bestCost >= leafCost);
+	int middle = first + count / 2;
+	if (!makeLeaf && bestAxis >= 0)
+	{
+		//move primitives left of the split to the front
+		float scale = binCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		int left = first;
+		int right = first + count - 1;
+		while (left <= right)
+		{
+			int bin = std::min((int)((centroids[left][bestAxis] - centroidMin[bestAxis]) * scale), binCount - 1);
+			if (bin < bestSplit)
+			{
+				left++;
+			}
+			else
+			{
+				std::swap(primitives[left], primitives[right]);
+				std::swap(centroids[left], centroids[right]);
+				right--;
+			}
+		}
+		middle = left;
+	}
+	else if (!makeLeaf && count <= maxLeafSize)
+	{
+		makeLeaf = true;	//all centroids in one spot or too deep, no split is worth it
+	}
+
+	if (makeLeaf)
+	{
+		tree[index].first = first;
+		tree[index].count = count;
+		buildStats.leaves++;
+		return index;
+	}
+
+	//large groups with identical centroids and too deep nodes are split in the middle of their range
+	buildNode(tree, first, middle - first, depth + 1, centroids);
+	int rightChild = buildNode(tree, middle, first + count - middle, depth + 1, centroids);
+	tree[index].first = rightChild;
+	tree[index].count = 0;
+	return index;
+}
+
+int rayScene::collapseNode(const std::vector<binaryNode>& tree, int index, int depth)
+{
+	int nodeIndex = (int)bvhNodes.size();
+	bvhNodes.push_back(bvhNode());
+	buildStats.depth = std::max(buildStats.depth, depth);
+
+	//start with both children and keep replacing the largest interior one by its own children until there are four
+	int children[4];
+	int childCount = 0;
+	if (tree[index].count > 0)	//the whole scene is one leaf
+	{
+		children[childCount++] = index;
+	}
+	else
+	{
+		children[childCount++] = index + 1;
+		children[childCount++] = tree[index].first;
+	}
+	while (childCount < 4)
+	{
+		int largest = -1;
+		float largestSize = -1.0f;
+		for (int i = 0; i < childCount; i++)
+		{
+			const binaryNode& child = tree[children[i]];
+			float size = halfPerimeter(child.boundsMin, child.boundsMax);
+			if (child.count == 0 && size > largestSize)
+			{
+				largest = i;
+				largestSize = size;
+			}
+		}
+		if (largest < 0)
+		{
+			break;
+		}
+
+		int opened = children[largest];
+		children[largest] = opened + 1;
+		children[childCount++] = tree[opened].first;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		bvhNode& node = bvhNodes[nodeIndex];
+		if (i >= childCount)	//no ray enters an inverted box
+		{
+			node.minX[i] = node.minY[i] = 1e30f;
+			node.maxX[i] = node.maxY[i] = -1e30f;
+			node.child[i] = 0;
+			node.count[i] = -1;
+			continue;
+		}
+
+		const binaryNode& child = tree[children[i]];
+		node.minX[i] = child.boundsMin.x;
+		node.minY[i] = child.boundsMin.y;
+		node.maxX[i] = child.boundsMax.x;
+		node.maxY[i] = child.boundsMax.y;
+		node.child[i] = child.first;
+		node.count[i] = child.count;
+		if (child.count > 0)
+		{
+			node.child[i] = addBlocks(child.first, child.count);
+		}
+		else
+		{
+			int childNode = collapseNode(tree, children[i], depth + 1);	//reallocates bvhNodes
+			bvhNodes[nodeIndex].child[i] = childNode;
+		}
+	}
+	return nodeIndex;
+}
+
+int rayScene::addBlocks(int first, int count)
+{
+	int firstBlock = (int)blocks.size();
+	for (int start = first; start < first + count; start += 4)
+	{
+		primitiveBlock block;
+		for (int i = 0; i < 4; i++)
+		{
+			if (start + i >= first + count)
+			{
+				block.aX[i] = block.aY[i] = block.edgeX[i] = block.edgeY[i] = NAN;
+				block.radiusSquared[i] = NAN;
+				block.circle[i] = 0;
+				block.index[i] = -1;
+				continue;
+			}
+
+			const primitive& shape = primitives[start + i];
+			block.aX[i] = shape.a.x;
+			block.aY[i] = shape.a.y;
+			block.edgeX[i] = shape.circle ? 0.0f : shape.b.x - shape.a.x;
+			block.edgeY[i] = shape.circle ? 0.0f : shape.b.y - shape.a.y;
+			block.radiusSquared[i] = shape.circle ? shape.b.x * shape.b.x : 0.0f;
+			block.circle[i] = shape.circle ? -1 : 0;
+			block.index[i] = start + i;
+		}
+		blocks.push_back(block);
+	}
+	return firstBlock;
+}
+
+bool rayScene::closestHit(const ray2D& ray, rayHit& hit) const
+{
+	if (bvhNodes.empty())
+	{
+		return false;
+	}
+
+	traversalRay prepared = prepareRay(ray);
+	float tMax = ray.tMax;
+	int closest = -1;
+
+	//nodes wait on the stack with their entry distance and are dropped once something closer was hit
+	struct stackEntry
+	{
+		int node;
+		float tEntry;
+	};
+	stackEntry stack[stackSize];
+	int stackCount = 0;
+	int nodeIndex = 0;
+	while (true)
+	{
+		const bvhNode& node = bvhNodes[nodeIndex];
+		float tEntry[4];
+		int entered = intersectChildren(node, prepared, tMax, tEntry);
+		int leafBits = (node.count[0] > 0) | (node.count[1] > 0) << 1 | (node.count[2] > 0) << 2 | (node.count[3] > 0) << 3;
+
+		//leaves are tested right away, all hits of a block were found against the same tMax and the first of the nearest ones is kept like in a test one by one
+		for (int leaves = entered & leafBits; leaves != 0; leaves &= leaves - 1)
+		{
+			int child = lowestBit(leaves);
+			int blockEnd = node.child[child] + (node.count[child] + 3) / 4;
+			for (int b = node.child[child]; b < blockEnd; b++)
+			{
+				float t[4];
+				for (int hitBits = intersectBlock(blocks[b], ray, tMax, t); hitBits != 0; hitBits &= hitBits - 1)
+				{
+					int i = lowestBit(hitBits);
+					if (t[i] < tMax)
+					{
+						tMax = t[i];
+						closest = blocks[b].index[i];
+					}
+				}
+			}
+		}
+
+		//the nearest interior child is visited next and the others are pushed
+		int nextNode = -1;
+		float nextEntry = 0.0f;
+		for (int interior = entered & ~leafBits; interior != 0; interior &= interior - 1)
+		{
+			int child = lowestBit(interior);
+			if (nextNode < 0 || tEntry[child] < nextEntry)
+			{
+				if (nextNode >= 0)
+				{
+					stack[stackCount++] = { nextNode, nextEntry };
+				}
+				nextNode = node.child[child];
+				nextEntry = tEntry[child];
+			}
+			else
+			{
+				stack[stackCount++] = { node.child[child], tEntry[child] };
+			}
+		}
+
+		if (nextNode >= 0 && nextEntry <= tMax)
+		{
+			nodeIndex = nextNode;
+			continue;
+		}
+
+		while (stackCount > 0 && stack[stackCount - 1].tEntry > tMax)
+		{
+			stackCount--;
+		}
+		if (stackCount == 0)
+		{
+			break;
+		}
+		nodeIndex = stack[--stackCount].node;
+	}
+
+	if (closest < 0)
+	{
+		return false;
+	}
+
+	fillHit(primitives[closest], ray, tMax, hit);
+	return true;
+}
+
+bool rayScene::anyHit(const ray2D& ray) const
+{
+	if (bvhNodes.empty())
+	{
+		return false;
+	}
+
+	traversalRay prepared = prepareRay(ray);
+
+	int stack[stackSize];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+	while (stackCount > 0)
+	{
+		const bvhNode& node = bvhNodes[stack[--stackCount]];
+		float tEntry[4];
+		int entered = intersectChildren(node, prepared, ray.tMax, tEntry);
+
+		for (int child = 0; entered != 0; child++, entered >>= 1)
+		{
+			if (!(entered & 1))
+			{
+				continue;
+			}
+
+			if (node.count[child] > 0)
+			{
+				int blockEnd = node.child[child] + (node.count[child] + 3) / 4;
+				for (int b = node.child[child]; b < blockEnd; b++)
+				{
+					float t[4];
+					if (intersectBlock(blocks[b], ray, ray.tMax, t) != 0)
+					{
+						return true;
+					}
+				}
+			}
+			else
+			{
+				stack[stackCount++] = node.child[child];
+			}
+		}
+	}
+	return false;
+}
+
+void rayPacket::set(int lane, const ray2D& ray)
+{
+	originX[lane] = ray.origin.x;
+	originY[lane] = ray.origin.y;
+	directionX[lane] = ray.direction.x;
+	directionY[lane] = ray.direction.y;
+	tMin[lane] = ray.tMin;
+	tMax[lane] = ray.tMax;
+	count = std::max(count, lane + 1);
+}
+
+ray2D rayPacket::ray(int lane) const
+{
+	ray2D ray;
+	ray.origin = glm::vec2(originX[lane], originY[lane]);
+	ray.direction = glm::vec2(directionX[lane], directionY[lane]);
+	ray.tMin = tMin[lane];
+	ray.tMax = tMax[lane];
+	return ray;
+}
+
+#if defined(RAY_USE_AVX2) || defined(RAY_USE_SSE2)
+//one float per ray of the packet, comparisons return masks with all bits of the passing lanes set
+#ifdef RAY_USE_AVX2
+typedef __m256 lanes;
+static inline lanes load(const float* values) { return _mm256_load_ps(values); }
+static inline void store(float* values, lanes v) { _mm256_store_ps(values, v); }
+static inline lanes splat(float value) { return _mm256_set1_ps(value); }
+static inline lanes splatBits(int value) { return _mm256_castsi256_ps(_mm256_set1_epi32(value)); }
+static inline lanes add(lanes a, lanes b) { return _mm256_add_ps(a, b); }
+static inline lanes sub(lanes a, lanes b) { return _mm256_sub_ps(a, b); }
+static inline lanes mul(lanes a, lanes b) { return _mm256_mul_ps(a, b); }
+static inline lanes divide(lanes a, lanes b) { return _mm256_div_ps(a, b); }
+static inline lanes minimum(lanes a, lanes b) { return _mm256_min_ps(a, b); }
+static inline lanes maximum(lanes a, lanes b) { return _mm256_max_ps(a, b); }
+static inline lanes squareRoot(lanes a) { return _mm256_sqrt_ps(a); }
+static inline lanes less(lanes a, lanes b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline lanes lessEqual(lanes a, lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline lanes both(lanes a, lanes b) { return _mm256_and_ps(a, b); }
+static inline lanes either(lanes a, lanes b) { return _mm256_or_ps(a, b); }
+static inline lanes select(lanes a, lanes b, lanes mask) { return _mm256_blendv_ps(a, b, mask); }	//b where mask is set
+static inline int bits(lanes mask) { return _mm256_movemask_ps(mask); }
+static inline float smallest(lanes v) { __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)); m = _mm_min_ps(m, _mm_movehl_ps(m, m)); return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1))); }
+
+//the child tests use the layout of intersectChildren, the four children of rays pass and pass + 4 side by side
+static inline lanes loadChildren(const float* values) { return _mm256_broadcast_ps((const __m128*)values); }
+static inline lanes spreadRay(lanes v, int pass) { return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(pass, pass, pass, pass, pass + 4, pass + 4, pass + 4, pass + 4)); }
+static inline __m128 smallestChild(lanes v) { return _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)); }
+static inline void transpose(lanes& a, lanes& b, lanes& c, lanes& d)	//four children of rays p and p + 4 in row p to eight rays in row c
+{
+	lanes ab = _mm256_unpacklo_ps(a, b);
+	lanes cd = _mm256_unpacklo_ps(c, d);
+	lanes abHigh = _mm256_unpackhi_ps(a, b);
+	lanes cdHigh = _mm256_unpackhi_ps(c, d);
+	a = _mm256_shuffle_ps(ab, cd, _MM_SHUFFLE(1, 0, 1, 0));
+	b = _mm256_shuffle_ps(ab, cd, _MM_SHUFFLE(3, 2, 3, 2));
+	c = _mm256_shuffle_ps(abHigh, cdHigh, _MM_SHUFFLE(1, 0, 1, 0));
+	d = _mm256_shuffle_ps(abHigh, cdHigh, _MM_SHUFFLE(3, 2, 3, 2));
+}
+#else
+typedef __m128 lanes;
+static inline lanes load(const float* values) { return _mm_load_ps(values); }
+static inline void store(float* values, lanes v) { _mm_store_ps(values, v); }
+static inline lanes splat(float value) { return _mm_set1_ps(value); }
+static inline lanes splatBits(int value) { return _mm_castsi128_ps(_mm_set1_epi32(value)); }
+static inline lanes add(lanes a, lanes b) { return _mm_add_ps(a, b); }
+static inline lanes sub(lanes a, lanes b) { return _mm_sub_ps(a, b); }
+static inline lanes mul(lanes a, lanes b) { return _mm_mul_ps(a, b); }
+static inline lanes divide(lanes a, lanes b) { return _mm_div_ps(a, b); }
+static inline lanes minimum(lanes a, lanes b) { return _mm_min_ps(a, b); }
+static inline lanes maximum(lanes a, lanes b) { return _mm_max_ps(a, b); }
+static inline lanes squareRoot(lanes a) { return _mm_sqrt_ps(a); }
+static inline lanes less(lanes a, lanes b) { return _mm_cmplt_ps(a, b); }
+static inline lanes lessEqual(lanes a, lanes b) { return _mm_cmple_ps(a, b); }
+static inline lanes both(lanes a, lanes b) { return _mm_and_ps(a, b); }
+static inline lanes either(lanes a, lanes b) { return _mm_or_ps(a, b); }
+static inline lanes select(lanes a, lanes b, lanes mask) { return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a)); }	//b where mask is set
+static inline int bits(lanes mask) { return _mm_movemask_ps(mask); }
+static inline float smallest(lanes v) { lanes m = _mm_min_ps(v, _mm_movehl_ps(v, v)); return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1))); }
+
+//the child tests use the layout of intersectChildren, the four children of ray pass
+static inline lanes loadChildren(const float* values) { return _mm_load_ps(values); }
+static inline lanes spreadRay(lanes v, int pass) { return pass == 0 ? _mm_shuffle_ps(v, v, 0x00) : pass == 1 ? _mm_shuffle_ps(v, v, 0x55) : pass == 2 ? _mm_shuffle_ps(v, v, 0xAA) : _mm_shuffle_ps(v, v, 0xFF); }
+static inline __m128 smallestChild(lanes v) { return v; }
+static inline void transpose(lanes& a, lanes& b, lanes& c, lanes& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }	//four children of ray p in row p to four rays in row c
+#endif
+
+//packet with the per node constants precomputed, inactive lanes get a negative tMax so every test fails for them
+struct packetLanes
+{
+	lanes originX;
+	lanes originY;
+	lanes directionX;
+	lanes directionY;
+	lanes inverseX;
+	lanes inverseY;
+	lanes tMin;
+	lanes tMax;
+	int activeBits;
+};
+
+static packetLanes loadPacket(const rayPacket& packet)
+{
+	alignas(32) float values[8][RAY_PACKET_WIDTH];
+	for (int lane = 0; lane < RAY_PACKET_WIDTH; lane++)
+	{
+		ray2D ray;	//unused lanes may hold garbage, they get a harmless ray instead
+		ray.origin = glm::vec2(0.0f);
+		ray.direction = glm::vec2(1.0f);
+		ray.tMax = -1.0f;
+		if (lane < packet.count)
+		{
+			ray = packet.ray(lane);
+		}
+		glm::vec2 inverseDirection = inverse(ray.direction);
+		values[0][lane] = ray.origin.x;
+		values[1][lane] = ray.origin.y;
+		values[2][lane] = ray.direction.x;
+		values[3][lane] = ray.direction.y;
+		values[4][lane] = inverseDirection.x;
+		values[5][lane] = inverseDirection.y;
+		values[6][lane] = ray.tMin;
+		values[7][lane] = ray.tMax;
+	}
+
+	packetLanes rays;
+	rays.originX = load(values[0]);
+	rays.originY = load(values[1]);
+	rays.directionX = load(values[2]);
+	rays.directionY = load(values[3]);
+	rays.inverseX = load(values[4]);
+	rays.inverseY = load(values[5]);
+	rays.tMin = load(values[6]);
+	rays.tMax = load(values[7]);
+	rays.activeBits = (1 << packet.count) - 1;
+	return rays;
+}
+
+//tests the four children of the node against every lane in four passes, each of them is the SIMD test of intersectChildren for one ray, or two with AVX2
+//returns a bit for every child entered by any lane, row p of tNear gets the entry distances of ray p, and p + 4, into the four children, infinite where it misses a box
+static inline int intersectChildren(const rayScene::bvhNode& node, const packetLanes& rays, lanes tMax, lanes* tNear)
+{
+	lanes minX = loadChildren(node.minX);
+	lanes minY = loadChildren(node.minY);
+	lanes maxX = loadChildren(node.maxX);
+	lanes maxY = loadChildren(node.maxY);
+	lanes inside = splat(0.0f);
+	for (int pass = 0; pass < 4; pass++)
+	{
+		lanes originX = spreadRay(rays.originX, pass);
+		lanes originY = spreadRay(rays.originY, pass);
+		lanes inverseX = spreadRay(rays.inverseX, pass);
+		lanes inverseY = spreadRay(rays.inverseY, pass);
+		lanes tx1 = mul(sub(minX, originX), inverseX);
+		lanes tx2 = mul(sub(maxX, originX), inverseX);
+		lanes ty1 = mul(sub(minY, originY), inverseY);
+		lanes ty2 = mul(sub(maxY, originY), inverseY);
+		lanes entry = maximum(maximum(minimum(tx1, tx2), minimum(ty1, ty2)), spreadRay(rays.tMin, pass));
+		lanes exit = minimum(minimum(maximum(tx1, tx2), maximum(ty1, ty2)), spreadRay(tMax, pass));
+		lanes entered = lessEqual(entry, exit);
+		tNear[pass] = select(splat(INFINITY), entry, entered);
+		inside = either(inside, entered);
+	}
+
+	//the min and max slabs would enter the inverted boxes of unused slots, their negative counts mask them out
+	int entered = bits(inside);
+	entered = (entered | entered >> 4) & 15;
+	return entered & ~_mm_movemask_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i*)node.count)));
+}
+
+//lanes hitting a primitive of a block within (tMin, tMax) with their distance in t
+static lanes intersectPrimitive(const rayScene::primitiveBlock& block, int slot, const packetLanes& rays, lanes tMax, lanes& t)
+{
+	if (block.circle[slot])
+	{
+		lanes offsetX = sub(rays.originX, splat(block.aX[slot]));
+		lanes offsetY = sub(rays.originY, splat(block.aY[slot]));
+		lanes a = add(mul(rays.directionX, rays.directionX), mul(rays.directionY, rays.directionY));
+		lanes b = add(mul(offsetX, rays.directionX), mul(offsetY, rays.directionY));
+		lanes c = sub(add(mul(offsetX, offsetX), mul(offsetY, offsetY)), splat(block.radiusSquared[slot]));
+		lanes discriminant = sub(mul(b, b), mul(a, c));
+
+		lanes root = squareRoot(maximum(discriminant, splat(0.0f)));
+		lanes entry = divide(sub(splat(0.0f), add(b, root)), a);
+		lanes exit = divide(sub(root, b), a);
+		t = select(entry, exit, lessEqual(entry, rays.tMin));	//origin inside of the circle, the exit point is hit
+		return both(both(lessEqual(splat(0.0f), discriminant), less(rays.tMin, t)), less(t, tMax));
+	}
+
+	lanes edgeX = splat(block.edgeX[slot]);
+	lanes edgeY = splat(block.edgeY[slot]);
+	lanes toStartX = sub(splat(block.aX[slot]), rays.originX);
+	lanes toStartY = sub(splat(block.aY[slot]), rays.originY);
+	lanes denominator = sub(mul(rays.directionX, edgeY), mul(rays.directionY, edgeX));
+
+	//parallel lanes divide by zero, the infinite or NaN results fail the comparisons below
+	lanes inverseDenominator = divide(splat(1.0f), denominator);
+	t = mul(sub(mul(toStartX, edgeY), mul(toStartY, edgeX)), inverseDenominator);
+	lanes s = mul(sub(mul(toStartX, rays.directionY), mul(toStartY, rays.directionX)), inverseDenominator);	//position on the segment
+	lanes onSegment = both(lessEqual(splat(0.0f), s), lessEqual(s, splat(1.0f)));
+	return both(onSegment, both(less(rays.tMin, t), less(t, tMax)));
+}
+#endif
+
+int rayScene::closestHit(const rayPacket& packet, rayHit* hits) const
+{
+	int hitBits = 0;
+#if defined(RAY_USE_AVX2) || defined(RAY_USE_SSE2)
+	if (bvhNodes.empty() || packet.count <= 0)
+	{
+		return 0;
+	}
+
+	packetLanes rays = loadPacket(packet);
+	lanes tMax = rays.tMax;
+	lanes closest = splatBits(-1);
+
+	//children are tested at their parent and wait on the stack with the entry distance of every lane, they are dropped once each lane found something closer
+	struct stackEntry
+	{
+		lanes tNear;	//infinite for lanes missing the child
+		float tEntry;	//smallest of tNear, orders the children
+		int first;	//child node, or first primitive of a leaf
+		int count;
+	};
+	stackEntry stack[stackSize];
+	int stackCount = 0;
+	int nodeIndex = 0;
+	while (nodeIndex >= 0)
+	{
+		//entered children are pushed farthest first so the nearest one is taken next
+		const bvhNode& node = bvhNodes[nodeIndex];
+		lanes tNear[4];
+		int entered = intersectChildren(node, rays, tMax, tNear);
+
+		//rows of rays become rows of children, every child's smallest entry distance orders the pushes
+		alignas(16) float tEntry[4];
+		_mm_store_ps(tEntry, smallestChild(minimum(minimum(tNear[0], tNear[1]), minimum(tNear[2], tNear[3]))));
+		transpose(tNear[0], tNear[1], tNear[2], tNear[3]);
+		int firstEntered = stackCount;
+		for (int child = 0; child < 4; child++)
+		{
+			if ((entered & 1 << child) == 0)
+			{
+				continue;
+			}
+
+			int position = stackCount++;
+			for (; position > firstEntered && stack[position - 1].tEntry < tEntry[child]; position--)
+			{
+				stack[position] = stack[position - 1];
+			}
+			stack[position] = {tNear[child], tEntry[child], node.child[child], node.count[child]};
+		}
+
+		nodeIndex = -1;
+		while (stackCount > 0)
+		{
+			const stackEntry& entry = stack[--stackCount];
+			if (bits(lessEqual(entry.tNear, tMax)) == 0)
+			{
+				continue;
+			}
+			if (entry.count == 0)
+			{
+				nodeIndex = entry.first;
+				break;
+			}
+
+			for (int i = 0; i < entry.count; i++)
+			{
+				const primitiveBlock& block = blocks[entry.first + i / 4];
+				lanes t;
+				lanes hit = intersectPrimitive(block, i % 4, rays, tMax, t);
+				if (bits(hit) != 0)
+				{
+					tMax = select(tMax, t, hit);
+					closest = select(closest, splatBits(block.index[i % 4]), hit);
+				}
+			}
+		}
+	}
+
+	alignas(32) float distances[RAY_PACKET_WIDTH];
+	alignas(32) float closestBits[RAY_PACKET_WIDTH];
+	store(distances, tMax);
+	store(closestBits, closest);
+	for (int lane = 0; lane < packet.count; lane++)
+	{
+		int index;
+		memcpy(&index, &closestBits[lane], sizeof(int));
+		if (index >= 0)
+		{
+			fillHit(primitives[index], packet.ray(lane), distances[lane], hits[lane]);
+			hitBits |= 1 << lane;
+		}
+	}
+#else
+	for (int lane = 0; lane < packet.count; lane++)
+	{
+		if (closestHit(packet.ray(lane), hits[lane]))
+		{
+			hitBits |= 1 << lane;
+		}
+	}
+#endif
+	return hitBits;
+}
+
+int rayScene::anyHit(const rayPacket& packet) const
+{
+	int occludedBits = 0;
+#if defined(RAY_USE_AVX2) || defined(RAY_USE_SSE2)
+	if (bvhNodes.empty() || packet.count <= 0)
+	{
+		return 0;
+	}
+
+	packetLanes rays = loadPacket(packet);
+	lanes tMax = rays.tMax;
+
+	int stack[stackSize];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+	while (stackCount > 0)
+	{
+		const bvhNode& node = bvhNodes[stack[--stackCount]];
+		lanes tNear[4];
+		int entered = intersectChildren(node, rays, tMax, tNear);
+		for (int child = 0; child < 4; child++)
+		{
+			if ((entered & 1 << child) == 0)
+			{
+				continue;
+			}
+
+			if (node.count[child] == 0)
+			{
+				stack[stackCount++] = node.child[child];
+				continue;
+			}
+
+			for (int i = 0; i < node.count[child]; i++)
+			{
+				lanes t;
+				lanes hit = intersectPrimitive(blocks[node.child[child] + i / 4], i % 4, rays, tMax, t);
+				int hitBits = bits(hit);
+				if (hitBits != 0)
+				{
+					//occluded lanes are done, a negative tMax takes them out of all further tests
+					occludedBits |= hitBits;
+					if (occludedBits == rays.activeBits)
+					{
+						return occludedBits;
+					}
+					tMax = select(tMax, splat(-1.0f), hit);
+				}
+			}
+		}
+	}
+#else
+	for (int lane = 0; lane < packet.count; lane++)
+	{
+		if (anyHit(packet.ray(lane)))
+		{
+			occludedBits |= 1 << lane;
+		}
+	}
+#endif
+	return occludedBits;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#ifndef RAY_SCENE_H
+#define RAY_SCENE_H
+
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+//ray with the hit interval (tMin, tMax), the direction does not have to be normalized
+struct ray2D
+{
+	glm::vec2 origin;
+	glm::vec2 direction;
+	float tMin = 1e-4f;
+	float tMax = 1e30f;
+};
+
+//closest intersection found by a ray query
+struct rayHit
+{
+	float t = 1e30f;	//distance along the ray in units of its direction
+	int primitive = -1;	//id returned by addSegment or addCircle, -1 if nothing was hit
+	glm::vec2 normal = glm::vec2(0.0f);	//unit normal facing the ray origin
+	bool inside = false;	//the ray started inside of the hit circle and leaves it
+};
+
+//rays traced together in one packet, 8 with AVX2 and 4 otherwise
+#ifdef __AVX2__
+#define RAY_PACKET_WIDTH 8
+#else
+#define RAY_PACKET_WIDTH 4
+#endif
+
+//coherent rays stored one array per component, every lane is one ray
+//packets pay off for rays that start close together and point the same way, like a fan from a light or shadow rays of neighbouring pixels
+struct rayPacket
+{
+	alignas(32) float originX[RAY_PACKET_WIDTH];
+	alignas(32) float originY[RAY_PACKET_WIDTH];
+	alignas(32) float directionX[RAY_PACKET_WIDTH];
+	alignas(32) float directionY[RAY_PACKET_WIDTH];
+	alignas(32) float tMin[RAY_PACKET_WIDTH];
+	alignas(32) float tMax[RAY_PACKET_WIDTH];
+	int count = 0;	//lanes in use, the others are ignored
+
+	void set(int lane, const ray2D& ray);	//count is raised to include the lane
+	ray2D ray(int lane) const;
+};
+
+//statistics of the last build
+struct rayBvhStats
+{
+	int primitives = 0;
+	int nodes = 0;
+	int leaves = 0;
+	int depth = 0;
+	double buildMilliseconds = 0.0;
+};
+
+//2D scene of line segment and circle occluders with a bounding volume hierarchy for ray queries
+//the hierarchy is built as a binary tree with binned SAH and collapsed into a flat array of nodes with four children, which halves the steps of a ray
+//leaves keep their primitives in blocks of four, a ray tests a node's children and a block's primitives with one SIMD test each
+class rayScene
+{
+public:
+	int addSegment(glm::vec2 a, glm::vec2 b);	//returns the id of the primitive
+	int addCircle(glm::vec2 center, float radius);
+	void clear();
+	void build();	//build the hierarchy, needed after primitives were added
+
+	bool closestHit(const ray2D& ray, rayHit& hit) const;	//returns true and fills hit if the ray hits anything within its interval
+	bool anyHit(const ray2D& ray) const;	//occlusion query, stops at the first hit found
+
+	//packet queries test all lanes against a node at once with SSE2 or AVX2, without them every lane is traced on its own
+	int closestHit(const rayPacket& packet, rayHit* hits) const;	//hits holds RAY_PACKET_WIDTH entries, returns a bit mask of the lanes that hit something
+	int anyHit(const rayPacket& packet) const;	//returns a bit mask of the occluded lanes
+
+	int primitiveCount() const { return (int)primitives.size(); }
+	const rayBvhStats& stats() const { return buildStats; }
+
+	//node of the hierarchy with the boxes of up to four children, so one SIMD test decides which children a ray enters
+	//unused child slots come last, they have count -1 and an inverted box
+	struct bvhNode
+	{
+		alignas(16) float minX[4];
+		float minY[4];
+		float maxX[4];
+		float maxY[4];
+		int child[4];	//first primitive block of a leaf child or node index of an interior child
+		int count[4];	//primitive count of a leaf child, 0 for an interior child
+	};
+
+	//four primitives of a leaf with one array per component, so one SIMD test covers all of them without a branch per primitive
+	//every leaf starts a new block, unused slots have NaN coordinates and are never hit
+	struct primitiveBlock
+	{
+		alignas(16) float aX[4];	//first end point or center
+		float aY[4];
+		float edgeX[4];	//second end point minus the first end point of a segment
+		float edgeY[4];
+		float radiusSquared[4];	//of a circle
+		int circle[4];	//all bits set for a circle
+		int index[4];	//position in the ordered primitives, -1 for an unused slot
+	};
+
+	//occluder stored in hierarchy order
+	struct primitive
+	{
+		glm::vec2 a;	//first end point or center
+		glm::vec2 b;	//second end point, b.x is the radius of a circle
+		int id;
+		bool circle;
+	};
+
+	const std::vector<bvhNode>& nodes() const { return bvhNodes; }
+	const std::vector<primitive>& orderedPrimitives() const { return primitives; }
+
+private:
+	std::vector<primitive> primitives;
+	std::vector<bvhNode> bvhNodes;
+	std::vector<primitiveBlock> blocks;
+	rayBvhStats buildStats;
+	int nextId = 0;
+
+	//node of the binary tree built before collapsing, interior nodes have count 0 and the left child directly follows its parent
+	struct binaryNode
+	{
+		glm::vec2 boundsMin;
+		glm::vec2 boundsMax;
+		int first;	//first primitive of a leaf or right child of an interior node
+		int count;	//primitive count of a leaf
+	};
+
+	int buildNode(std::vector<binaryNode>& tree, int first, int count, int depth, std::vector<glm::vec2>& centroids);	//returns the index of the new binary node
+	int collapseNode(const std::vector<binaryNode>& tree, int index, int depth);	//returns the index of the new node holding the children of tree[index]
+	int addBlocks(int first, int count);	//returns the index of the first block holding the primitives of a leaf
+};
+
+#endif // !RAY_SCENE_H
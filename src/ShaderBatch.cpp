@@ -0,0 +1,110 @@
+#include "ShaderBatch.h"
+#include "ShaderCache.h"
+
+shaderBatch::shaderBatch()
+{
+	parallelCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+}
+
+shaderBatchHandle shaderBatch::add(const char* vertexPath, const char* fragmentPath, const shaderDefines& defines)
+{
+	pendingProgram program;
+	program.vertexPath = vertexPath;
+	program.fragmentPath = fragmentPath;
+	program.defines = defines;
+	programs.push_back(program);
+
+	shaderBatchHandle handle;
+	handle.index = (int)programs.size() - 1;
+	return handle;
+}
+
+void shaderBatch::submit()
+{
+	//compile every stage of every program first
+	for (pendingProgram& program : programs)
+	{
+		if (program.submitted)
+		{
+			continue;
+		}
+
+		std::string vertexCode = preprocessShader(program.vertexPath.c_str(), program.defines);
+		std::string fragmentCode = preprocessShader(program.fragmentPath.c_str(), program.defines);
+
+		program.ID = glCreateProgram();
+		program.cacheKey = shaderCacheKey(vertexCode, fragmentCode);
+
+		if (!loadProgramBinary(program.ID, program.cacheKey))	//cached programs are ready right away
+		{
+			program.vertShader = compileShaderStage(GL_VERTEX_SHADER, vertexCode);
+			program.fragShader = compileShaderStage(GL_FRAGMENT_SHADER, fragmentCode);
+		}
+	}
+
+	//link afterwards so the compilation of the remaining stages is not blocked by a link
+	for (pendingProgram& program : programs)
+	{
+		if (!program.submitted && program.vertShader != 0)
+		{
+			linkProgram(program.ID, program.vertShader, program.fragShader);
+		}
+		program.submitted = true;
+	}
+}
+
+bool shaderBatch::isReady(shaderBatchHandle program) const
+{
+	const pendingProgram& pending = programs[program.index];
+	if (!pending.submitted)
+	{
+		return false;
+	}
+	if (pending.finished || pending.vertShader == 0 || !parallelCompile)
+	{
+		return true;
+	}
+
+	return programLinkFinished(pending.ID);
+}
+
+bool shaderBatch::allReady() const
+{
+	for (int i = 0; i < (int)programs.size(); i++)
+	{
+		shaderBatchHandle program;
+		program.index = i;
+		if (!isReady(program))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+shader shaderBatch::finish(shaderBatchHandle program)
+{
+	if (!programs[program.index].submitted)
+	{
+		submit();
+	}
+
+	pendingProgram& pending = programs[program.index];
+	if (!pending.finished && pending.vertShader != 0)
+	{
+		//the deferred status queries, these block until the driver is done
+		if (checkProgram(pending.ID))
+		{
+			storeProgramBinary(pending.ID, pending.cacheKey);	//store program for the next start
+		}
+		else
+		{
+			//report which stage caused the failed link
+			checkShaderStage(pending.vertShader);
+			checkShaderStage(pending.fragShader);
+		}
+	}
+	pending.finished = true;
+
+	return shader(pending.ID, pending.vertexPath.c_str(), pending.fragmentPath.c_str(), pending.defines);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include "ShaderLoader.h"
+
+#include <string>
+#include <vector>
+
+//handle to a program added to a shaderBatch
+struct shaderBatchHandle
+{
+	int index = -1;
+};
+
+//compiles many programs at once, all stages are submitted before any status is queried so the driver can work on them in parallel
+class shaderBatch
+{
+public:
+	shaderBatch();
+
+	shaderBatchHandle add(const char* vertexPath, const char* fragmentPath, const shaderDefines& defines = shaderDefines());	//queue program for compilation
+	void submit();	//start compilation and linking of all queued programs without waiting for the driver
+
+	bool isReady(shaderBatchHandle program) const;	//check without blocking if the program has finished (always true without GL_KHR_parallel_shader_compile)
+	bool allReady() const;	//check without blocking if every program has finished
+	shader finish(shaderBatchHandle program);	//wait for program, print errors and return the shader
+
+	bool parallelCompileSupported() const { return parallelCompile; }
+
+private:
+	//program waiting for the driver
+	struct pendingProgram
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		shaderDefines defines;
+		unsigned int ID = 0;
+		unsigned int vertShader = 0;	//0 if the program was loaded from the shader cache
+		unsigned int fragShader = 0;
+		programCacheKey cacheKey;
+		bool submitted = false;
+		bool finished = false;
+	};
+
+	std::vector<pendingProgram> programs;
+	bool parallelCompile;	//true if GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile is available
+};
+
+#endif // !SHADER_BATCH_H
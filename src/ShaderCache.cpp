@@ -0,0 +1,209 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "ShaderLoader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sstream>
+#include <filesystem>
+
+static const char* cacheDirectory = "Resources/ShaderCache";
+static const unsigned int cacheMagic = 0x42505253;	//"SRPB"
+static const unsigned int cacheVersion = 2;
+static shaderCacheCounters cacheCounters;
+
+//header at the start of every cache file
+struct cacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long key;
+	unsigned long long sourceHash;	//rejects files whose key collides with the one of other sources
+	unsigned int format;	//binary format reported by glGetProgramBinary
+	unsigned int length;	//length of the binary following the header
+};
+
+static std::string cachePath(unsigned long long key)
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", key);
+	return std::string(cacheDirectory) + "/" + fileName;
+}
+
+programCacheKey shaderCacheKey(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	//the length of the vertex source goes first, otherwise "ab" + "c" and "a" + "bc" would give the same key
+	unsigned long long vertexLength = vertexCode.size();
+	programCacheKey cacheKey;
+	unsigned long long key = hashBytes(&vertexLength, sizeof(vertexLength));
+	key = hashBytes(vertexCode.data(), vertexCode.size(), key);
+	key = hashBytes(fragmentCode.data(), fragmentCode.size(), key);
+
+	cacheKey.sourceHash = mixBytes(&vertexLength, sizeof(vertexLength));
+	cacheKey.sourceHash = mixBytes(vertexCode.data(), vertexCode.size(), cacheKey.sourceHash);
+	cacheKey.sourceHash = mixBytes(fragmentCode.data(), fragmentCode.size(), cacheKey.sourceHash);
+
+	//binaries are only valid for the exact driver they were created with
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings)
+	{
+		const char* value = (const char*)glGetString(name);
+		if (value)
+		{
+			key = hashBytes(value, strlen(value), key);
+		}
+	}
+	cacheKey.key = key;
+	return cacheKey;
+}
+
+void loadShaderCacheFunctions(GLADloadproc load)
+{
+	//glad only loads these with a 4.1 context, the extension exposes the same functions without a suffix on the 3.3 context the program asks for
+	if (!GLAD_GL_VERSION_4_1 && hasExtension("GL_ARB_get_program_binary"))
+	{
+		glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+		glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+		glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+	}
+}
+
+bool shaderCacheSupported()
+{
+	static int binarySupport = -1;
+	if (binarySupport < 0)	//glGetProgramBinary and glProgramBinary are core since 4.1 and available through GL_ARB_get_program_binary before
+	{
+		binarySupport = (GLAD_GL_VERSION_4_1 || hasExtension("GL_ARB_get_program_binary")) && glad_glGetProgramBinary && glad_glProgramBinary && glad_glProgramParameteri ? 1 : 0;
+	}
+	if (!binarySupport)
+	{
+		return false;
+	}
+
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+bool loadProgramBinary(unsigned int program, const programCacheKey& key)
+{
+	cacheCounters.misses++;	//turned into a hit once the binary has been accepted
+	if (!shaderCacheSupported())
+	{
+		return false;
+	}
+
+	std::string path = cachePath(key.key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)	//check if binary is cached
+	{
+		return false;
+	}
+
+	cacheHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != cacheMagic || header.version != cacheVersion || header.key != key.key || header.sourceHash != key.sourceHash)
+	{
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	file.read(binary.data(), header.length);
+	if (!file)	//cut off file, remove it instead of failing on it at every start
+	{
+		file.close();
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		return false;
+	}
+
+	glProgramBinary(program, header.format, binary.data(), header.length);
+
+	//the driver rejects binaries that do not match, in that case the program has to be built from source
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (success)
+	{
+		cacheCounters.misses--;
+		cacheCounters.hits++;
+	}
+	return success != 0;
+}
+
+void storeProgramBinary(unsigned int program, const programCacheKey& key)
+{
+	if (!shaderCacheSupported())
+	{
+		return;
+	}
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	cacheHeader header;
+	std::vector<char> binary(length);
+	glGetProgramBinary(program, length, NULL, &header.format, binary.data());	//get binary of linked program
+
+	header.magic = cacheMagic;
+	header.version = cacheVersion;
+	header.key = key.key;
+	header.sourceHash = key.sourceHash;
+	header.length = (unsigned int)length;
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+
+	//write into a temporary file first, so a crash or another instance never leaves a half written binary under the real name
+	std::string path = cachePath(key.key);
+	std::stringstream tempPath;
+	tempPath << path << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "ERROR: shader cache could not be written" << std::endl;
+			return;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), length);
+		if (!file)
+		{
+			std::cout << "ERROR: shader cache could not be written" << std::endl;
+			file.close();
+			std::filesystem::remove(tempPath.str(), error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(tempPath.str(), path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath.str(), error);
+	}
+}
+
+void clearShaderCache()
+{
+	std::error_code error;
+	std::filesystem::remove_all(cacheDirectory, error);
+}
+
+const shaderCacheCounters& shaderCacheStats()
+{
+	return cacheCounters;
+}
+
+void resetShaderCacheStats()
+{
+	cacheCounters = shaderCacheCounters();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+//on-disk cache of linked program binaries, used to skip compilation and linking on warm starts
+
+//identifies a cached program, key names the file and sourceHash is checked against the file before its binary is used
+struct programCacheKey
+{
+	unsigned long long key = 0;	//hash of the sources and the driver
+	unsigned long long sourceHash = 0;	//second, independent hash of the sources
+};
+
+//build the cache key out of the shader sources and the vendor, renderer and version strings of the driver
+programCacheKey shaderCacheKey(const std::string& vertexCode, const std::string& fragmentCode);
+
+void loadShaderCacheFunctions(GLADloadproc load);	//load the GL_ARB_get_program_binary entry points on contexts older than 4.1, call after gladLoadGLLoader
+bool shaderCacheSupported();	//check if the driver is able to retrieve and load program binaries
+bool loadProgramBinary(unsigned int program, const programCacheKey& key);	//load cached binary into program, returns false if there is no usable binary
+void storeProgramBinary(unsigned int program, const programCacheKey& key);	//store binary of a linked program in the cache
+void clearShaderCache();	//delete every cached binary, the next start is a cold start
+
+//loads from the cache since the start of the program or the last reset
+struct shaderCacheCounters
+{
+	int hits = 0;	//programs loaded from a cached binary
+	int misses = 0;	//programs that had to be built from source
+};
+
+const shaderCacheCounters& shaderCacheStats();
+void resetShaderCacheStats();
+
+#endif // !SHADER_CACHE_H
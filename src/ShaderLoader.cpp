@@ -1,115 +1,568 @@
 #include "ShaderLoader.h"
+#include "ShaderCache.h"
+#include "GLState.h"
 
-shader::shader(const char* vertexPath, const char* fragmentPath)
-{
-	//define strings, stringstreams and ifstreams
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vertShaderFile;
-	std::ifstream fragShaderFile;
-	std::stringstream vertShaderStream;
-	std::stringstream fragShaderStream;
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
 
-	//check if ifstreams are capable of throwing exceptions
-	vertShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fragShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1	//from GL_KHR_parallel_shader_compile, not part of the glad loader
+#endif
 
-	//load data
-	//=========================================================================
-	try
+//FNV-1a hash used for the uniform lookup
+static unsigned int hashName(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool hasExtension(const char* name)
+{
+	int extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (int i = 0; i < extensionCount; i++)
 	{
-		//open files
-		vertShaderFile.open(vertexPath);
-		fragShaderFile.open(fragmentPath);
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string loadShaderSource(const char* path)
+{
+	std::string code;
+	std::ifstream shaderFile;
+	std::stringstream shaderStream;
 
-		//read content in buffer into streams
-		vertShaderStream << vertShaderFile.rdbuf();
-		fragShaderStream << fragShaderFile.rdbuf();
+	//check if ifstream is capable of throwing exceptions
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-		//close files
-		vertShaderFile.close();
-		fragShaderFile.close();
+	try
+	{
+		shaderFile.open(path);	//open file
+		shaderStream << shaderFile.rdbuf();	//read content in buffer into stream
+		shaderFile.close();	//close file
 
-		//convert streams into strings
-		vertexCode = vertShaderStream.str();
-		fragmentCode = fragShaderStream.str();
+		code = shaderStream.str();	//convert stream into string
 	}
 	catch (std::ifstream::failure e)
 	{
 		std::cout << "ERROR: failure loading shader file" << std::endl;
 	}
-	const char* vertShaderCode = vertexCode.c_str();
-	const char* fragShaderCode = fragmentCode.c_str();
-	//=========================================================================
+	return code;
+}
+
+//append the lines of a file to code and replace #include lines with the included file
+//every file is included once, #line directives use the index of the file in sourceFiles as source string number so errors can be traced back
+static bool appendShaderFile(const std::string& path, const shaderDefines* defines, std::string& code, std::vector<std::string>& sourceFiles, std::vector<std::string>& includeStack)
+{
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+	if (std::find(includeStack.begin(), includeStack.end(), normalized) != includeStack.end())
+	{
+		std::cout << "ERROR: recursive include of shader file " << normalized << std::endl;
+		return false;
+	}
+
+	std::string source = loadShaderSource(normalized.c_str());
+	if (source.empty())
+	{
+		std::cout << "ERROR: shader file " << normalized << " is missing or empty" << std::endl;
+		return false;
+	}
+
+	int fileIndex = (int)(std::find(sourceFiles.begin(), sourceFiles.end(), normalized) - sourceFiles.begin());
+	if (fileIndex == (int)sourceFiles.size())
+	{
+		sourceFiles.push_back(normalized);
+	}
+
+	includeStack.push_back(normalized);
+	std::filesystem::path directory = std::filesystem::path(normalized).parent_path();
+
+	bool success = true;
+	bool definesInserted = defines == NULL;	//defines are only inserted into the main file
+	int lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < source.size())
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+		{
+			lineEnd = source.size();
+		}
+		std::string line = source.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		lineNumber++;
+
+		size_t first = line.find_first_not_of(" \t");
+		std::string directive = first == std::string::npos ? "" : line.substr(first);
+
+		if (directive.compare(0, 8, "#include") == 0)
+		{
+			//accept #include "file" and #include <file>, both relative to the including file
+			size_t open = directive.find_first_of("\"<", 8);
+			size_t close = open == std::string::npos ? std::string::npos : directive.find_first_of("\">", open + 1);
+			if (close == std::string::npos)
+			{
+				std::cout << "ERROR: malformed include in " << normalized << " line " << lineNumber << std::endl;
+				success = false;
+				continue;
+			}
+
+			std::string includePath = (directory / directive.substr(open + 1, close - open - 1)).lexically_normal().generic_string();
+			bool alreadyIncluded = std::find(sourceFiles.begin(), sourceFiles.end(), includePath) != sourceFiles.end();
+			if (!alreadyIncluded)
+			{
+				code += "#line 1 " + std::to_string(sourceFiles.size()) + "\n";
+				success = appendShaderFile(includePath, NULL, code, sourceFiles, includeStack) && success;
+			}
+			code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+			continue;
+		}
+
+		code += line;
+		code += '\n';
+
+		//defines have to follow the #version line which has to come first
+		if (!definesInserted && directive.compare(0, 8, "#version") == 0)
+		{
+			for (const std::string& define : *defines)
+			{
+				code += "#define " + define + "\n";
+			}
+			code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+			definesInserted = true;
+		}
+	}
+
+	if (!definesInserted && !defines->empty())
+	{
+		std::cout << "ERROR: shader file " << normalized << " has no #version line, defines were not inserted" << std::endl;
+	}
+
+	includeStack.pop_back();
+	return success;
+}
+
+std::string preprocessShader(const char* path, const shaderDefines& defines, std::vector<std::string>* sourceFiles)
+{
+	std::string code;
+	std::vector<std::string> files;
+	std::vector<std::string> includeStack;
+	appendShaderFile(path, &defines, code, files, includeStack);
+
+	if (sourceFiles)
+	{
+		for (const std::string& file : files)
+		{
+			if (std::find(sourceFiles->begin(), sourceFiles->end(), file) == sourceFiles->end())
+			{
+				sourceFiles->push_back(file);
+			}
+		}
+	}
+	return code;
+}
+
+unsigned int compileShaderStage(GLenum type, const std::string& code)
+{
+	const char* shaderCode = code.c_str();
 
-	//compilation
-	//=========================================================================
-	unsigned int vertShader;
-	unsigned int fragShader;
+	unsigned int stage = glCreateShader(type);
+	glShaderSource(stage, 1, &shaderCode, NULL);	//attach code
+	glCompileShader(stage);	//compile shader
+	return stage;
+}
+
+bool checkShaderStage(unsigned int stage)
+{
 	int success;
 	char infoLog[512];
 
-	//vertex shader
-	vertShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertShader, 1, &vertShaderCode, NULL);	//attach code
-	glCompileShader(vertShader);	//compile shader
-
-	glGetShaderiv(vertShader, GL_COMPILE_STATUS, &success);	//get compilation status
+	glGetShaderiv(stage, GL_COMPILE_STATUS, &success);	//get compilation status
 	if (!success)	//check if compilation failed
 	{
-		glGetShaderInfoLog(vertShader, 512, NULL, infoLog);	//get error
+		glGetShaderInfoLog(stage, 512, NULL, infoLog);	//get error
 		std::cout << "ERROR: compilation of shader failed: \n" << infoLog << std::endl;
 	}
+	return success != 0;
+}
+
+void linkProgram(unsigned int program, unsigned int vertShader, unsigned int fragShader)
+{
+	if (shaderCacheSupported())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);	//tell driver that the binary will be retrieved
+	}
 
-	//fragment shader
-	fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragShader, 1, &fragShaderCode, NULL);	//attach code
-	glCompileShader(fragShader);	//compile shader
+	glAttachShader(program, vertShader);	//attach vertex shader
+	glAttachShader(program, fragShader);	//attach fragment shader
+	glLinkProgram(program);	//link shaders
 
-	glGetShaderiv(fragShader, GL_COMPILE_STATUS, &success);	//get compilation status
-	if (!success)	//check if compilation failed
+	//flag shaders for deletion, they stay alive and queryable until the program is deleted
+	glDeleteShader(vertShader);
+	glDeleteShader(fragShader);
+}
+
+bool programLinkFinished(unsigned int program)
+{
+	static int parallelCompile = -1;
+	if (parallelCompile < 0)	//check once if GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile is available
 	{
-		glGetShaderInfoLog(fragShader, 512, NULL, infoLog);	//get error
-		std::cout << "ERROR: compilation of shader failed: \n" << infoLog << std::endl;
+		parallelCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile") ? 1 : 0;
 	}
-	//=========================================================================
 
-	//Linking
-	//=========================================================================
-	ID = glCreateProgram();
-	glAttachShader(ID, vertShader);	//attach vertex shader
-	glAttachShader(ID, fragShader);	//attach fragment shader
-	glLinkProgram(ID);	//link shaders
+	if (!parallelCompile)	//without the extension the status can only be queried blocking
+	{
+		return true;
+	}
+
+	int completed = 0;
+	glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);	//does not block unlike GL_LINK_STATUS
+	return completed != 0;
+}
 
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);	//get link status
+bool checkProgram(unsigned int program)
+{
+	int success;
+	char infoLog[512];
+
+	glGetProgramiv(program, GL_LINK_STATUS, &success);	//get link status
 	if (!success)	//check if linking failed
 	{
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);	//get error
+		glGetProgramInfoLog(program, 512, NULL, infoLog);	//get error
 		std::cout << "ERROR: linking of shaders failed: \n" << infoLog << std::endl;
 	}
-	
-	//delete shaders
-	glDeleteShader(vertShader);
-	glDeleteShader(fragShader);
-	//=========================================================================
+	return success != 0;
+}
+
+shader::shader(const char* vertexPath, const char* fragmentPath, const shaderDefines& defines) : vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines)
+{
+	//load data
+	std::string vertexCode = preprocessShader(vertexPath, defines, &files);
+	std::string fragmentCode = preprocessShader(fragmentPath, defines, &files);
+
+	ID = glCreateProgram();
+
+	//try to load the linked program from the shader cache before compiling
+	programCacheKey cacheKey = shaderCacheKey(vertexCode, fragmentCode);
+	if (!loadProgramBinary(ID, cacheKey))
+	{
+		//compilation
+		unsigned int vertShader = compileShaderStage(GL_VERTEX_SHADER, vertexCode);
+		checkShaderStage(vertShader);
+		unsigned int fragShader = compileShaderStage(GL_FRAGMENT_SHADER, fragmentCode);
+		checkShaderStage(fragShader);
+
+		//linking
+		linkProgram(ID, vertShader, fragShader);
+		if (checkProgram(ID))
+		{
+			storeProgramBinary(ID, cacheKey);	//store program for the next start
+		}
+	}
+
+	buildUniformCache();
+}
+
+shader::shader(unsigned int programID, const char* vertexPath, const char* fragmentPath, const shaderDefines& defines) : vertexPath(vertexPath ? vertexPath : ""), fragmentPath(fragmentPath ? fragmentPath : ""), defines(defines)
+{
+	ID = programID;
+
+	//the program was built elsewhere, scan the sources for included files so they can be watched
+	if (vertexPath && fragmentPath)
+	{
+		preprocessShader(vertexPath, defines, &files);
+		preprocessShader(fragmentPath, defines, &files);
+	}
+
+	buildUniformCache();
 }
 
 void shader::use()
 {
-	glUseProgram(ID);
+	glState().useProgram(ID);
+}
+
+void shader::beginReload()
+{
+	if (vertexPath.empty() || fragmentPath.empty())	//program was not built from files
+	{
+		return;
+	}
+
+	cancelReload();	//a newer change replaces a reload that is still compiling
+
+	reload.files.clear();
+	std::string vertexCode = preprocessShader(vertexPath.c_str(), defines, &reload.files);
+	std::string fragmentCode = preprocessShader(fragmentPath.c_str(), defines, &reload.files);
+
+	//build the new program next to the old one, the old one stays in use until the new one linked
+	reload.ID = glCreateProgram();
+	reload.cacheKey = shaderCacheKey(vertexCode, fragmentCode);
+	reload.startTime = std::chrono::steady_clock::now();	//the build time includes compiling and linking
+	reload.vertShader = compileShaderStage(GL_VERTEX_SHADER, vertexCode);
+	reload.fragShader = compileShaderStage(GL_FRAGMENT_SHADER, fragmentCode);
+	linkProgram(reload.ID, reload.vertShader, reload.fragShader);
+}
+
+bool shader::updateReload()
+{
+	if (reload.ID == 0 || !programLinkFinished(reload.ID))
+	{
+		return false;
+	}
+
+	if (!checkProgram(reload.ID))	//keep the old program if the new one does not link
+	{
+		checkShaderStage(reload.vertShader);
+		checkShaderStage(reload.fragShader);
+		cancelReload();
+		return false;
+	}
+
+	storeProgramBinary(reload.ID, reload.cacheKey);
+
+	//swap programs
+	glDeleteProgram(ID);
+	glState().programDeleted(ID);
+	ID = reload.ID;
+	reload.ID = 0;
+	files.swap(reload.files);	//includes may have changed
+
+	rebuildUniformCache();
+
+	reloadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reload.startTime).count();
+	return true;
+}
+
+void shader::cancelReload()
+{
+	if (reload.ID != 0)
+	{
+		glDeleteProgram(reload.ID);
+		reload.ID = 0;
+	}
+}
+
+bool shader::bindUniformBlock(const std::string& blockName, unsigned int binding)
+{
+	bool known = false;
+	for (std::pair<std::string, unsigned int>& block : blockBindings)
+	{
+		if (block.first == blockName)
+		{
+			block.second = binding;
+			known = true;
+		}
+	}
+	if (!known)
+	{
+		blockBindings.push_back(std::make_pair(blockName, binding));
+	}
+
+	unsigned int blockIndex = glGetUniformBlockIndex(ID, blockName.c_str());
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+	glUniformBlockBinding(ID, blockIndex, binding);
+	return true;
+}
+
+uniformHandle shader::getUniform(const std::string& name) const
+{
+	uniformHandle uniform;
+	unsigned int hash = hashName(name.c_str());
+
+	//search all slots with a matching hash
+	auto it = std::lower_bound(uniformHashes.begin(), uniformHashes.end(), hash);
+	for (; it != uniformHashes.end() && *it == hash; it++)
+	{
+		int slot = uniformHashSlots[it - uniformHashes.begin()];
+		if (uniformSlots[slot].name == name)	//check for hash collision
+		{
+			uniform.slot = slot;
+			break;
+		}
+	}
+	return uniform;
 }
 
 void shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+	setBool(getUniform(name), value);
 }
 
 void shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	setInt(getUniform(name), value);
 }
 
 void shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-}
\ No newline at end of file
+	setFloat(getUniform(name), value);
+}
+
+void shader::setVec2(const std::string& name, float x, float y) const
+{
+	setVec2(getUniform(name), x, y);
+}
+
+void shader::setBool(uniformHandle uniform, bool value) const
+{
+	setInt(uniform, (int)value);
+}
+
+void shader::setInt(uniformHandle uniform, int value) const
+{
+	if (uniform.slot >= 0)
+	{
+		const uniformSlot& slot = uniformSlots[uniform.slot];
+		slot.valueType = uniformSlot::intValue;
+		slot.intData = value;
+		glUniform1i(slot.location, value);
+	}
+}
+
+void shader::setFloat(uniformHandle uniform, float value) const
+{
+	if (uniform.slot >= 0)
+	{
+		const uniformSlot& slot = uniformSlots[uniform.slot];
+		slot.valueType = uniformSlot::floatValue;
+		slot.floatData[0] = value;
+		glUniform1f(slot.location, value);
+	}
+}
+
+void shader::setVec2(uniformHandle uniform, float x, float y) const
+{
+	if (uniform.slot >= 0)
+	{
+		const uniformSlot& slot = uniformSlots[uniform.slot];
+		slot.valueType = uniformSlot::vec2Value;
+		slot.floatData[0] = x;
+		slot.floatData[1] = y;
+		glUniform2f(slot.location, x, y);
+	}
+}
+
+void shader::buildUniformCache()
+{
+	uniformSlots.clear();
+	uniformHashes.clear();
+	uniformHashSlots.clear();
+	addActiveUniforms();
+}
+
+void shader::rebuildUniformCache()
+{
+	//existing slots keep their index so handles stay valid, uniforms removed from the shader get location -1
+	for (uniformSlot& slot : uniformSlots)
+	{
+		slot.location = glGetUniformLocation(ID, slot.name.c_str());
+	}
+	addActiveUniforms();
+
+	//restore block bindings and the values that were set on the old program
+	for (const std::pair<std::string, unsigned int>& block : blockBindings)
+	{
+		unsigned int blockIndex = glGetUniformBlockIndex(ID, block.first.c_str());
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(ID, blockIndex, block.second);
+		}
+	}
+
+	use();
+	for (const uniformSlot& slot : uniformSlots)
+	{
+		switch (slot.valueType)
+		{
+		case uniformSlot::intValue:
+			glUniform1i(slot.location, slot.intData);
+			break;
+		case uniformSlot::floatValue:
+			glUniform1f(slot.location, slot.floatData[0]);
+			break;
+		case uniformSlot::vec2Value:
+			glUniform2f(slot.location, slot.floatData[0], slot.floatData[1]);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void shader::addActiveUniforms()
+{
+	int uniformCount = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);	//get number of active uniforms
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);	//get length of the longest uniform name
+
+	std::vector<char> nameBuffer(maxNameLength + 1);
+
+	for (int i = 0; i < uniformCount; i++)
+	{
+		int nameLength;
+		int size;
+		GLenum type;
+		glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());	//get name, array size and type of uniform
+
+		std::string name(nameBuffer.data(), nameLength);
+		int location = glGetUniformLocation(ID, name.c_str());
+
+		if (location < 0)	//uniforms inside of uniform blocks have no location
+		{
+			continue;
+		}
+
+		addUniform(name, location);
+
+		//arrays are reported as name[0], make the array accessible by its plain name and every element by its index
+		size_t bracket = name.rfind("[0]");
+		if (bracket != std::string::npos && bracket + 3 == name.size())
+		{
+			std::string baseName = name.substr(0, bracket);
+			addUniform(baseName, location);
+
+			for (int element = 1; element < size; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				addUniform(elementName, glGetUniformLocation(ID, elementName.c_str()));
+			}
+		}
+	}
+}
+
+void shader::addUniform(const std::string& name, int location)
+{
+	if (getUniform(name).slot >= 0)	//already known from before a reload
+	{
+		return;
+	}
+
+	int slot = (int)uniformSlots.size();
+	uniformSlot entry;
+	entry.name = name;
+	entry.location = location;
+	uniformSlots.push_back(entry);
+
+	//insert hash while keeping the lookup sorted
+	unsigned int hash = hashName(name.c_str());
+	auto it = std::upper_bound(uniformHashes.begin(), uniformHashes.end(), hash);
+	uniformHashSlots.insert(uniformHashSlots.begin() + (it - uniformHashes.begin()), slot);
+	uniformHashes.insert(it, hash);
+}
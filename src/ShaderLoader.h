@@ -3,25 +3,107 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "ShaderCache.h"
 
 #include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+//defines inserted after the #version line of a shader, either "NAME" or "NAME VALUE"
+typedef std::vector<std::string> shaderDefines;
+
+//building blocks of a shader program, status queries are separate so that they can be deferred
+std::string loadShaderSource(const char* path);	//read shader file into a string
+std::string preprocessShader(const char* path, const shaderDefines& defines, std::vector<std::string>* sourceFiles = NULL);	//load shader, resolve #include and insert defines, the file and its includes are added to sourceFiles
+unsigned int compileShaderStage(GLenum type, const std::string& code);	//create shader and start its compilation
+bool checkShaderStage(unsigned int stage);	//get compilation status and print the error log on failure
+void linkProgram(unsigned int program, unsigned int vertShader, unsigned int fragShader);	//attach shaders, start linking and flag the shaders for deletion
+bool programLinkFinished(unsigned int program);	//check without blocking if linking is done (always true without GL_KHR_parallel_shader_compile)
+bool checkProgram(unsigned int program);	//get link status and print the error log on failure
+bool hasExtension(const char* name);	//check if an extension is exposed by the current context
+
+//pre-resolved uniform, used to set uniforms without any string work
+struct uniformHandle
+{
+	int slot = -1;	//index into the uniform table of the shader (-1 if the uniform does not exist)
+};
 
 class shader
 {
 public:
 	unsigned int ID;	//stores program ID
-	shader(const char* vertexPath, const char* fragmentPath);	//constructor for reading and building of the shader
+	shader(const char* vertexPath, const char* fragmentPath, const shaderDefines& defines = shaderDefines());	//constructor for reading and building of the shader
+	explicit shader(unsigned int programID, const char* vertexPath = NULL, const char* fragmentPath = NULL, const shaderDefines& defines = shaderDefines());	//constructor for an already linked program, paths are needed for reloading
 	void use();	//used to activate the shader
 
+	//reloading, the old program stays in use until the new one has linked successfully
+	const std::vector<std::string>& sourceFiles() const { return files; }	//files the program is built from, including included files
+	void beginReload();	//reread the source files and start building the new program without waiting for the driver
+	bool updateReload();	//swap in the new program once it is ready, returns true if the program has been swapped
+	void cancelReload();	//discard a reload that has not been swapped in yet
+	bool reloadPending() const { return reload.ID != 0; }
+	double lastReloadMilliseconds() const { return reloadMilliseconds; }	//time from beginReload to the swap of the last reload
+
+	//uniform blocks, the binding is kept across reloads
+	bool bindUniformBlock(const std::string& blockName, unsigned int binding);	//returns false if the program has no active block with that name
+
 	//uniform utilities
+	uniformHandle getUniform(const std::string& name) const;	//resolve uniform once, the handle can then be used in hot loops
+
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
+	void setVec2(const std::string& name, float x, float y) const;
+
+	void setBool(uniformHandle uniform, bool value) const;
+	void setInt(uniformHandle uniform, int value) const;
+	void setFloat(uniformHandle uniform, float value) const;
+	void setVec2(uniformHandle uniform, float x, float y) const;
+
+private:
+	//entry of the uniform table, the last value set is kept so it can be restored after a reload
+	struct uniformSlot
+	{
+		enum valueKind { noValue, intValue, floatValue, vec2Value };
+
+		std::string name;
+		int location;
+		mutable valueKind valueType = noValue;
+		mutable int intData = 0;
+		mutable float floatData[2] = { 0.0f, 0.0f };
+	};
+
+	//program that is being built by a reload
+	struct pendingReload
+	{
+		unsigned int ID = 0;
+		unsigned int vertShader = 0;
+		unsigned int fragShader = 0;
+		programCacheKey cacheKey;
+		std::vector<std::string> files;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	std::string vertexPath;
+	std::string fragmentPath;
+	shaderDefines defines;
+	std::vector<std::string> files;	//source files and every file they include
+	std::vector<std::pair<std::string, unsigned int>> blockBindings;	//uniform block name and binding point
+	pendingReload reload;
+	double reloadMilliseconds = 0.0;
+
+	std::vector<uniformSlot> uniformSlots;	//all active uniforms, handles index into this table
+	std::vector<unsigned int> uniformHashes;	//sorted name hashes used for lookup
+	std::vector<int> uniformHashSlots;	//slot belonging to the hash with the same index in uniformHashes
+
+	void buildUniformCache();	//enumerate all active uniforms of the linked program
+	void rebuildUniformCache();	//resolve the uniform table again after a reload and restore the uniform values
+	void addActiveUniforms();	//add all active uniforms that are not in the uniform table yet
+	void addUniform(const std::string& name, int location);	//add uniform to the uniform table
 };
 
 #endif // !SHADER_H
-
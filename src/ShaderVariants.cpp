@@ -0,0 +1,74 @@
+#include "ShaderVariants.h"
+#include "Hash.h"
+
+#include <algorithm>
+
+//hash of a sorted define set
+static unsigned long long hashDefines(const shaderDefines& sortedDefines)
+{
+	unsigned long long hash = hashBytes(NULL, 0);
+	for (const std::string& define : sortedDefines)
+	{
+		hash = hashBytes(define.c_str(), define.size() + 1, hash);	//include the terminator so "A","B" and "AB" differ
+	}
+	return hash;
+}
+
+shaderVariants::shaderVariants(const char* vertexPath, const char* fragmentPath) : vertexPath(vertexPath), fragmentPath(fragmentPath)
+{
+}
+
+int shaderVariants::find(const shaderDefines& sortedDefines, unsigned long long hash) const
+{
+	auto range = variantIndices.equal_range(hash);
+	for (auto it = range.first; it != range.second; it++)
+	{
+		if (variants[it->second].defines == sortedDefines)	//check for hash collision
+		{
+			return it->second;
+		}
+	}
+	return -1;
+}
+
+bool shaderVariants::contains(const shaderDefines& defines) const
+{
+	shaderDefines sortedDefines = defines;
+	std::sort(sortedDefines.begin(), sortedDefines.end());
+	return find(sortedDefines, hashDefines(sortedDefines)) >= 0;
+}
+
+shader& shaderVariants::get(const shaderDefines& defines)
+{
+	shaderDefines sortedDefines = defines;
+	std::sort(sortedDefines.begin(), sortedDefines.end());
+	unsigned long long hash = hashDefines(sortedDefines);
+
+	int index = find(sortedDefines, hash);
+	if (index >= 0)
+	{
+		return *variants[index].program;
+	}
+
+	//compile new variant
+	variant entry;
+	entry.defines = sortedDefines;
+	entry.program.reset(new shader(vertexPath.c_str(), fragmentPath.c_str(), sortedDefines));
+	variants.push_back(std::move(entry));
+	variantIndices.insert(std::make_pair(hash, (int)variants.size() - 1));
+
+	if (watcher)
+	{
+		watcher->watch(*variants.back().program);
+	}
+	return *variants.back().program;
+}
+
+void shaderVariants::watchWith(shaderWatcher& watcher)
+{
+	this->watcher = &watcher;
+	for (variant& entry : variants)
+	{
+		watcher.watch(*entry.program);
+	}
+}
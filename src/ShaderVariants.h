@@ -0,0 +1,42 @@
+#pragma once
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "ShaderLoader.h"
+#include "ShaderWatcher.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+//permutation cache for one shader source, every set of defines is compiled on first use and kept afterwards
+//specialized programs are used instead of runtime branches in the shaders
+class shaderVariants
+{
+public:
+	shaderVariants(const char* vertexPath, const char* fragmentPath);
+
+	shader& get(const shaderDefines& defines);	//order of the defines does not matter
+	bool contains(const shaderDefines& defines) const;
+	int count() const { return (int)variants.size(); }
+
+	void watchWith(shaderWatcher& watcher);	//reload existing and future variants when their files change
+
+private:
+	struct variant
+	{
+		shaderDefines defines;	//sorted
+		std::unique_ptr<shader> program;	//shaders are referenced from outside so they must not move
+	};
+
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::vector<variant> variants;
+	std::unordered_multimap<unsigned long long, int> variantIndices;	//define hash to index into variants
+	shaderWatcher* watcher = NULL;
+
+	int find(const shaderDefines& sortedDefines, unsigned long long hash) const;
+};
+
+#endif // !SHADER_VARIANTS_H
@@ -0,0 +1,222 @@
+#include "ShaderWatcher.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+static const int scanIntervalMilliseconds = 250;	//used when no change notification is available
+
+static std::string normalizePath(const std::string& path)
+{
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+static std::filesystem::file_time_type writeTime(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+	return error ? std::filesystem::file_time_type() : time;
+}
+
+shaderWatcher::shaderWatcher()
+{
+	lastScan = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+	notifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (notifyFD < 0)
+	{
+		std::cout << "ERROR: inotify could not be initialized, falling back to polling" << std::endl;
+	}
+#endif
+}
+
+shaderWatcher::~shaderWatcher()
+{
+	for (watchedShader& entry : shaders)
+	{
+		entry.program->cancelReload();
+	}
+
+#ifdef __linux__
+	if (notifyFD >= 0)
+	{
+		close(notifyFD);
+	}
+#endif
+}
+
+void shaderWatcher::watch(shader& program)
+{
+	watchedShader entry;
+	entry.program = &program;
+	collectFiles(entry);
+	shaders.push_back(entry);
+}
+
+void shaderWatcher::collectFiles(watchedShader& entry)
+{
+	entry.files.clear();
+	for (const std::string& file : entry.program->sourceFiles())
+	{
+		watchedFile watched;
+		watched.path = normalizePath(file);
+		watched.lastWrite = writeTime(watched.path);
+		entry.files.push_back(watched);
+
+#ifdef __linux__
+		std::string dir = std::filesystem::path(watched.path).parent_path().generic_string();
+		addDirectory(dir.empty() ? "." : dir);
+#endif
+	}
+}
+
+#ifdef __linux__
+void shaderWatcher::addDirectory(const std::string& dir)
+{
+	if (notifyFD < 0)
+	{
+		return;
+	}
+
+	for (const std::pair<int, std::string>& watched : watchedDirs)
+	{
+		if (watched.second == dir)
+		{
+			return;
+		}
+	}
+
+	//editors often save by writing a new file and renaming it, so renames count as changes too
+	//creations do not, a file that was just created can still be empty, its IN_CLOSE_WRITE follows once it is written
+	int descriptor = inotify_add_watch(notifyFD, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (descriptor < 0)
+	{
+		std::cout << "ERROR: could not watch directory " << dir << std::endl;
+		return;
+	}
+	watchedDirs.push_back(std::make_pair(descriptor, dir));
+}
+
+void shaderWatcher::readEvents()
+{
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t length = read(notifyFD, buffer, sizeof(buffer));
+		if (length <= 0)	//EAGAIN once all events have been read
+		{
+			break;
+		}
+
+		for (char* event = buffer; event < buffer + length; event += sizeof(inotify_event) + ((inotify_event*)event)->len)
+		{
+			inotify_event* notify = (inotify_event*)event;
+			if (notify->len == 0)
+			{
+				continue;
+			}
+
+			//find directory of event
+			std::string dir;
+			for (const std::pair<int, std::string>& watched : watchedDirs)
+			{
+				if (watched.first == notify->wd)
+				{
+					dir = watched.second;
+					break;
+				}
+			}
+			std::string path = normalizePath(dir + "/" + notify->name);
+
+			//mark every shader using the file
+			for (watchedShader& entry : shaders)
+			{
+				for (const watchedFile& file : entry.files)
+				{
+					if (file.path == path && !entry.changed)
+					{
+						entry.changed = true;
+						entry.changedFile = file.path;
+						entry.detectTime = std::chrono::steady_clock::now();
+					}
+				}
+			}
+		}
+	}
+}
+#endif
+
+void shaderWatcher::scanFiles()
+{
+	for (watchedShader& entry : shaders)
+	{
+		for (watchedFile& file : entry.files)
+		{
+			std::filesystem::file_time_type time = writeTime(file.path);
+			if (time != file.lastWrite)
+			{
+				file.lastWrite = time;
+				if (!entry.changed)
+				{
+					entry.changed = true;
+					entry.changedFile = file.path;
+					entry.detectTime = std::chrono::steady_clock::now();
+				}
+			}
+		}
+	}
+}
+
+void shaderWatcher::poll()
+{
+	//detect changes
+#ifdef __linux__
+	if (notifyFD >= 0)
+	{
+		readEvents();
+	}
+	else
+#endif
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - lastScan >= std::chrono::milliseconds(scanIntervalMilliseconds))
+		{
+			lastScan = now;
+			scanFiles();
+		}
+	}
+
+	for (watchedShader& entry : shaders)
+	{
+		//start building the new program, a change during a running reload restarts it
+		if (entry.changed)
+		{
+			entry.changed = false;
+			entry.program->beginReload();
+			if (entry.program->reloadPending())
+			{
+				std::cout << "reloading shader, " << entry.changedFile << " changed" << std::endl;
+			}
+		}
+
+		//swap once the driver is done
+		if (entry.program->reloadPending())
+		{
+			bool swapped = entry.program->updateReload();
+			if (swapped)
+			{
+				double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - entry.detectTime).count();
+				std::cout << "shader reloaded after change of " << entry.changedFile << " in " << latency << " ms (build " << entry.program->lastReloadMilliseconds() << " ms)" << std::endl;
+			}
+			if (swapped || !entry.program->reloadPending())	//file list can change after a reload
+			{
+				collectFiles(entry);
+			}
+		}
+	}
+}
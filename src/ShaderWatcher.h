@@ -0,0 +1,53 @@
+#pragma once
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include "ShaderLoader.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+//watches the source files of shaders and reloads a shader when one of its files changes
+//uses inotify on linux and polls the modification times everywhere else
+class shaderWatcher
+{
+public:
+	shaderWatcher();
+	~shaderWatcher();
+
+	void watch(shader& program);	//the shader has to outlive the watcher
+	void poll();	//call once per frame, starts reloads for changed files and swaps finished programs
+
+private:
+	struct watchedFile
+	{
+		std::string path;	//lexically normalized path
+		std::filesystem::file_time_type lastWrite;
+	};
+
+	struct watchedShader
+	{
+		shader* program;
+		std::vector<watchedFile> files;
+		bool changed = false;
+		std::string changedFile;	//file that triggered the reload
+		std::chrono::steady_clock::time_point detectTime;	//time the change was noticed
+	};
+
+	std::vector<watchedShader> shaders;
+	std::chrono::steady_clock::time_point lastScan;
+
+#ifdef __linux__
+	int notifyFD = -1;
+	std::vector<std::pair<int, std::string>> watchedDirs;	//inotify watch descriptor and directory
+	void addDirectory(const std::string& dir);
+	void readEvents();
+#endif
+
+	void collectFiles(watchedShader& entry);	//fetch the current file list of the shader
+	void scanFiles();	//compare modification times of all files
+};
+
+#endif // !SHADER_WATCHER_H
@@ -0,0 +1,263 @@
+#include "SoftShadows.h"
+#include "GLState.h"
+
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHADOW_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+//tracing constants, softShadows.frag uses the same values
+static const int maxSteps = 64;
+static const float startOffset = 1.0f;	//the ray starts one pixel away so it does not stop on the edge it starts next to
+static const float minimumStep = 0.5f;
+static const float hitDistance = 0.1f;
+static const float minimumRadius = 0.001f;	//radius used for point lights, gives hard shadows
+static const int rowsPerBand = 8;
+static const unsigned int lightDataBinding = 1;	//binding 0 is used by the draw data of the base shader
+
+//bilinear sample of the field at a position in pixels, texel centers sit at half integers and the edges are clamped like GL_CLAMP_TO_EDGE
+static float sampleField(const float* field, int width, int height, float x, float y)
+{
+	x = std::min(std::max(x - 0.5f, 0.0f), (float)(width - 1));
+	y = std::min(std::max(y - 0.5f, 0.0f), (float)(height - 1));
+	int x0 = std::min((int)x, width - 2 >= 0 ? width - 2 : 0);
+	int y0 = std::min((int)y, height - 2 >= 0 ? height - 2 : 0);
+	int x1 = std::min(x0 + 1, width - 1);
+	int y1 = std::min(y0 + 1, height - 1);
+	float fractionX = x - x0;
+	float fractionY = y - y0;
+
+	float bottom = field[(size_t)y0 * width + x0] + (field[(size_t)y0 * width + x1] - field[(size_t)y0 * width + x0]) * fractionX;
+	float top = field[(size_t)y1 * width + x0] + (field[(size_t)y1 * width + x1] - field[(size_t)y1 * width + x0]) * fractionX;
+	return bottom + (top - bottom) * fractionY;
+}
+
+//fraction of the light reaching a pixel, the cone test of the sphere trace turned into a smooth penumbra
+static float smoothVisibility(float visibility)
+{
+	visibility = std::min(std::max(visibility, 0.0f), 1.0f);
+	return visibility * visibility * (3.0f - 2.0f * visibility);
+}
+
+//light of one light at a pixel before its color is applied
+static float traceLight(const float* field, int width, int height, glm::vec2 position, const light2D& light)
+{
+	glm::vec2 toLight = light.position - position;
+	float lightDistance = glm::length(toLight);
+	if (lightDistance >= light.range)
+	{
+		return 0.0f;
+	}
+	float falloff = 1.0f - lightDistance / light.range;
+	glm::vec2 direction = toLight / std::max(lightDistance, 1e-6f);
+	float cone = std::max(light.radius, minimumRadius) / std::max(lightDistance, 1e-6f);	//tangent of the half angle the light covers
+
+	float visibility = 1.0f;
+	float t = startOffset;
+	float previousH = 1e20f;
+	for (int step = 0; step < maxSteps && t < lightDistance; step++)
+	{
+		glm::vec2 sample = position + direction * t;
+		float h = sampleField(field, width, height, sample.x, sample.y);
+		if (h < hitDistance)
+		{
+			visibility = 0.0f;
+			break;
+		}
+
+		//taking the cone at the steps alone leaves bands where the steps land, the closest approach between two steps
+		//is estimated from where their circles of clearance intersect
+		float back = h * h / (2.0f * previousH);
+		float closest = sqrtf(std::max(h * h - back * back, 0.0f));
+		visibility = std::min(visibility, closest / (cone * std::max(t - back, 1e-6f)));
+		previousH = h;
+		t += std::max(h, minimumStep);
+	}
+	return falloff * falloff * smoothVisibility(visibility);
+}
+
+#ifdef SHADOW_USE_SSE2
+//the same as traceLight for 4 neighbouring pixels of a row, lanes that are done are masked out until all of them are
+static __m128 traceLight4(const float* field, int width, int height, __m128 positionX, __m128 positionY, const light2D& light)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 toLightX = _mm_sub_ps(_mm_set1_ps(light.position.x), positionX);
+	__m128 toLightY = _mm_sub_ps(_mm_set1_ps(light.position.y), positionY);
+	__m128 lightDistance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(toLightX, toLightX), _mm_mul_ps(toLightY, toLightY)));
+	__m128 inverseDistance = _mm_div_ps(one, _mm_max_ps(lightDistance, _mm_set1_ps(1e-6f)));
+	__m128 directionX = _mm_mul_ps(toLightX, inverseDistance);
+	__m128 directionY = _mm_mul_ps(toLightY, inverseDistance);
+	__m128 cone = _mm_mul_ps(_mm_set1_ps(std::max(light.radius, minimumRadius)), inverseDistance);
+	__m128 inRange = _mm_cmplt_ps(lightDistance, _mm_set1_ps(light.range));
+
+	__m128 visibility = one;
+	__m128 t = _mm_set1_ps(startOffset);
+	__m128 previousH = _mm_set1_ps(1e20f);
+	__m128 active = _mm_and_ps(inRange, _mm_cmplt_ps(t, lightDistance));
+	for (int step = 0; step < maxSteps && _mm_movemask_ps(active) != 0; step++)
+	{
+		//the field is gathered one lane at a time, the rest of the step runs on all lanes
+		alignas(16) float sampleX[4];
+		alignas(16) float sampleY[4];
+		alignas(16) float samples[4];
+		_mm_store_ps(sampleX, _mm_add_ps(positionX, _mm_mul_ps(directionX, t)));
+		_mm_store_ps(sampleY, _mm_add_ps(positionY, _mm_mul_ps(directionY, t)));
+		int activeBits = _mm_movemask_ps(active);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			samples[lane] = (activeBits >> lane) & 1 ? sampleField(field, width, height, sampleX[lane], sampleY[lane]) : 1.0f;
+		}
+		__m128 h = _mm_load_ps(samples);
+
+		__m128 hit = _mm_and_ps(active, _mm_cmplt_ps(h, _mm_set1_ps(hitDistance)));
+		__m128 clear = _mm_andnot_ps(hit, active);
+		__m128 back = _mm_div_ps(_mm_mul_ps(h, h), _mm_add_ps(previousH, previousH));
+		__m128 closest = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(h, h), _mm_mul_ps(back, back)), zero));
+		__m128 coneVisibility = _mm_min_ps(visibility, _mm_div_ps(closest, _mm_mul_ps(cone, _mm_max_ps(_mm_sub_ps(t, back), _mm_set1_ps(1e-6f)))));
+		visibility = _mm_or_ps(_mm_and_ps(clear, coneVisibility), _mm_andnot_ps(clear, visibility));
+		visibility = _mm_andnot_ps(hit, visibility);
+		previousH = _mm_or_ps(_mm_and_ps(clear, h), _mm_andnot_ps(clear, previousH));
+
+		t = _mm_add_ps(t, _mm_and_ps(clear, _mm_max_ps(h, _mm_set1_ps(minimumStep))));
+		active = _mm_and_ps(clear, _mm_cmplt_ps(t, lightDistance));
+	}
+
+	visibility = _mm_min_ps(_mm_max_ps(visibility, zero), one);
+	visibility = _mm_mul_ps(_mm_mul_ps(visibility, visibility), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(visibility, visibility)));
+	__m128 falloff = _mm_sub_ps(one, _mm_mul_ps(lightDistance, _mm_set1_ps(1.0f / light.range)));
+	return _mm_and_ps(inRange, _mm_mul_ps(_mm_mul_ps(falloff, falloff), visibility));
+}
+#endif
+
+void lightDistanceField(const distanceField& field, const std::vector<light2D>& lights, const lightingSettings& settings, float* rgb, threadPool* pool)
+{
+	int width = field.width();
+	int height = field.height();
+	const float* distances = field.distances();
+
+	auto lightRows = [&](int first, int end)
+	{
+		for (int y = first; y < end; y++)
+		{
+			float* row = rgb + (size_t)y * width * 3;
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = settings.ambient.x;
+				row[x * 3 + 1] = settings.ambient.y;
+				row[x * 3 + 2] = settings.ambient.z;
+			}
+
+			for (const light2D& light : lights)
+			{
+				int x = 0;
+#ifdef SHADOW_USE_SSE2
+				alignas(16) float amounts[4];
+				for (; x + 4 <= width; x += 4)
+				{
+					__m128 positionX = _mm_add_ps(_mm_set1_ps((float)x + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+					_mm_store_ps(amounts, traceLight4(distances, width, height, positionX, _mm_set1_ps((float)y + 0.5f), light));
+					for (int lane = 0; lane < 4; lane++)
+					{
+						row[(x + lane) * 3 + 0] += light.color.x * amounts[lane];
+						row[(x + lane) * 3 + 1] += light.color.y * amounts[lane];
+						row[(x + lane) * 3 + 2] += light.color.z * amounts[lane];
+					}
+				}
+#endif
+				for (; x < width; x++)
+				{
+					float amount = traceLight(distances, width, height, glm::vec2((float)x + 0.5f, (float)y + 0.5f), light);
+					row[x * 3 + 0] += light.color.x * amount;
+					row[x * 3 + 1] += light.color.y * amount;
+					row[x * 3 + 2] += light.color.z * amount;
+				}
+			}
+
+			//occluders are drawn flat on top
+			const float* distanceRow = distances + (size_t)y * width;
+			for (int x = 0; x < width; x++)
+			{
+				if (distanceRow[x] < 0.0f)
+				{
+					row[x * 3 + 0] = settings.occluderColor.x;
+					row[x * 3 + 1] = settings.occluderColor.y;
+					row[x * 3 + 2] = settings.occluderColor.z;
+				}
+			}
+		}
+	};
+
+	if (pool == NULL)
+	{
+		lightRows(0, height);
+		return;
+	}
+	pool->parallelFor((height + rowsPerBand - 1) / rowsPerBand, [&](int band)
+	{
+		lightRows(band * rowsPerBand, std::min((band + 1) * rowsPerBand, height));
+	});
+}
+
+shadowRenderer::shadowRenderer()
+	: lightingShader("Resources/Shaders/fullscreen.vert", "Resources/Shaders/softShadows.frag"), lightUniforms(64 * 1024)
+{
+	lightingShader.bindUniformBlock("lightData", lightDataBinding);
+	if (!lightLayout.reflect(lightingShader.ID, "lightData"))
+	{
+		std::cout << "ERROR: lighting shader has no lightData block" << std::endl;
+	}
+	lightingShader.use();
+	lightingShader.setInt("distanceField", 0);
+
+	glGenVertexArrays(1, &emptyVertexArray);
+}
+
+shadowRenderer::~shadowRenderer()
+{
+	glDeleteVertexArrays(1, &emptyVertexArray);
+	glState().vertexArrayDeleted(emptyVertexArray);
+}
+
+void shadowRenderer::draw(unsigned int fieldTexture, int fieldWidth, int fieldHeight, const std::vector<light2D>& lights, const lightingSettings& settings)
+{
+	int lightCount = std::min((int)lights.size(), maxShadowLights);
+	if ((int)lights.size() > maxShadowLights)
+	{
+		std::cout << "ERROR: lighting pass supports " << maxShadowLights << " lights, " << lights.size() << " were given" << std::endl;
+	}
+
+	lightUniforms.beginFrame();
+	uniformAllocation block = lightUniforms.allocate(lightLayout.size());
+	writeUniform(block.data, lightLayout.offset("ambient"), glm::vec4(settings.ambient, 0.0f));
+	writeUniform(block.data, lightLayout.offset("occluderColor"), glm::vec4(settings.occluderColor, 0.0f));
+	writeUniform(block.data, lightLayout.offset("lightCount"), lightCount);
+	for (int i = 0; i < lightCount; i++)
+	{
+		writeUniform(block.data, lightLayout.offset("lightPositionRadius", i), glm::vec4(lights[i].position, std::max(lights[i].radius, minimumRadius), 0.0f));
+		writeUniform(block.data, lightLayout.offset("lightColorRange", i), glm::vec4(lights[i].color, lights[i].range));
+	}
+	lightUniforms.flush();
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	lightingShader.use();
+	lightingShader.setVec2("fieldSize", (float)fieldWidth, (float)fieldHeight);
+	lightingShader.setVec2("viewportOrigin", (float)viewport[0], (float)viewport[1]);
+	lightingShader.setVec2("viewportSize", (float)viewport[2], (float)viewport[3]);
+	glState().bindBufferRange(GL_UNIFORM_BUFFER, lightDataBinding, block.buffer, block.offset, block.size);
+	glState().bindTexture(0, GL_TEXTURE_2D, fieldTexture);
+	glState().bindVertexArray(emptyVertexArray);
+	glState().setBlend(false);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	lightUniforms.endFrame();
+}
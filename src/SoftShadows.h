@@ -0,0 +1,55 @@
+#pragma once
+#ifndef SOFT_SHADOWS_H
+#define SOFT_SHADOWS_H
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "DistanceField.h"
+#include "ShaderLoader.h"
+#include "UniformBuffer.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+static const int maxShadowLights = 16;	//size of the light arrays in softShadows.frag
+
+//light of the 2D lighting pass, positions and sizes are in pixels of the distance field
+struct light2D
+{
+	glm::vec2 position;
+	glm::vec3 color;
+	float radius = 0.0f;	//size of the light, the penumbra widens with it, 0 gives hard shadows
+	float range = 500.0f;	//distance at which the light has faded out
+};
+
+//colors of the lighting pass that do not come from the lights
+struct lightingSettings
+{
+	glm::vec3 ambient = glm::vec3(0.03f);	//added to every pixel outside of the occluders
+	glm::vec3 occluderColor = glm::vec3(0.15f);	//flat color of the pixels inside of the occluders
+};
+
+//CPU reference of the lighting pass, every pixel of the field sphere traces one shadow ray to each light
+//the visibility is the narrowest cone around the ray that stays clear of the occluders, relative to the cone the light covers
+//rgb receives 3 floats per pixel bottom row first, rows are split over the pool and 4 pixels are traced together with SSE2
+void lightDistanceField(const distanceField& field, const std::vector<light2D>& lights, const lightingSettings& settings, float* rgb, threadPool* pool = NULL);
+
+//fullscreen lighting pass on the GPU doing the same as lightDistanceField, the lights are passed in a uniform block
+class shadowRenderer
+{
+public:
+	shadowRenderer();
+	~shadowRenderer();
+
+	//draw into the bound framebuffer, the field is stretched over the viewport
+	void draw(unsigned int fieldTexture, int fieldWidth, int fieldHeight, const std::vector<light2D>& lights, const lightingSettings& settings);
+
+private:
+	shader lightingShader;
+	uniformBlockLayout lightLayout;
+	uniformRing lightUniforms;
+	unsigned int emptyVertexArray;	//the fullscreen triangle is generated from gl_VertexID
+};
+
+#endif // !SOFT_SHADOWS_H
@@ -0,0 +1,230 @@
+#include "SpriteBatch.h"
+#include "GLState.h"
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+
+void sprite::setRegion(unsigned int arrayTexture, const atlasRegion& region)
+{
+	texture = arrayTexture;
+	layer = region.layer;
+	u0 = region.u0;
+	v0 = region.v0;
+	u1 = region.u1;
+	v1 = region.v1;
+}
+
+spriteBatch::spriteBatch(int maxSprites) : maxSprites(maxSprites), defaultShader("Resources/Shaders/spriteShader.vert", "Resources/Shaders/spriteShader.frag"),
+	defaultArrayShader("Resources/Shaders/spriteShader.vert", "Resources/Shaders/spriteShader.frag", { "USE_TEXTURE_ARRAY" })
+{
+	size_t bufferSize = (size_t)segmentCount * maxSprites * 4 * sizeof(spriteVertex);
+
+	glGenVertexArrays(1, &VAO);
+	glState().bindVertexArray(VAO);
+
+	//create vertex buffer object
+	glGenBuffers(1, &vertexBuff);
+	glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);
+
+	if (GLAD_GL_VERSION_4_4)	//map the vertex buffer once and keep it mapped
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, bufferSize, NULL, flags);
+		mappedVertices = (spriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+	}
+
+	//every sprite uses the same two triangles, so the indices never change
+	std::vector<unsigned int> indices((size_t)maxSprites * 6);
+	for (int i = 0; i < maxSprites; i++)
+	{
+		unsigned int first = i * 4;
+		unsigned int quad[] = { first, first + 1, first + 2, first + 2, first + 3, first };
+		std::copy(quad, quad + 6, indices.begin() + (size_t)i * 6);
+	}
+
+	//create elemental buffer object
+	glGenBuffers(1, &elementBuff);
+	glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuff);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	//set vertex attribute pointers for float position, half float texture coordinates, normalized color and half float layer
+	vertexFormat spriteFormat;
+	spriteFormat.add(0, 2, attribType::float32).add(1, 2, attribType::half16).add(2, 4, attribType::unorm8).add(3, 1, attribType::half16);
+	spriteFormat.apply();
+
+}
+
+spriteBatch::~spriteBatch()
+{
+	for (GLsync fence : segmentFences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (mappedVertices)
+	{
+		glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &vertexBuff);
+	glDeleteBuffers(1, &elementBuff);
+	glState().vertexArrayDeleted(VAO);
+	glState().bufferDeleted(vertexBuff);
+	glState().bufferDeleted(elementBuff);
+}
+
+void spriteBatch::begin(float viewWidth, float viewHeight, spriteSortMode sortMode)
+{
+	this->viewWidth = viewWidth;
+	this->viewHeight = viewHeight;
+	this->sortMode = sortMode;
+	frameStats = spriteBatchStats();
+}
+
+void spriteBatch::draw(const sprite& quad)
+{
+	if ((int)queued.size() == maxSprites)	//segment is full
+	{
+		flush();
+	}
+	queued.push_back(quad);
+}
+
+void spriteBatch::end()
+{
+	flush();
+	lastStats = frameStats;
+}
+
+void spriteBatch::flush()
+{
+	if (queued.empty())
+	{
+		return;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	//sort by shader and texture, the index in the low bits keeps the submission order within a group
+	sortKeys.resize(queued.size());
+	for (size_t i = 0; i < queued.size(); i++)
+	{
+		unsigned long long program = queued[i].spriteShader ? queued[i].spriteShader->ID : (queued[i].layer >= 0 ? defaultArrayShader.ID : defaultShader.ID);
+		unsigned long long texture = queued[i].texture;
+		sortKeys[i] = sortMode == spriteSortMode::state ? ((program & 0xFFFF) << 48) | ((texture & 0xFFFFFF) << 24) | i : i;
+	}
+	if (sortMode == spriteSortMode::state)
+	{
+		std::sort(sortKeys.begin(), sortKeys.end());
+	}
+
+	//wait until the GPU has finished reading this segment
+	if (segmentFences[segment])
+	{
+		glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(segmentFences[segment]);
+		segmentFences[segment] = 0;
+	}
+
+	size_t firstVertex = (size_t)segment * maxSprites * 4;
+	size_t vertexCount = queued.size() * 4;
+
+	glState().bindBuffer(GL_ARRAY_BUFFER, vertexBuff);
+	spriteVertex* vertices = mappedVertices ? mappedVertices + firstVertex :
+		(spriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, firstVertex * sizeof(spriteVertex), vertexCount * sizeof(spriteVertex), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	//write the corners of every sprite in sorted order
+	for (size_t i = 0; i < sortKeys.size(); i++)
+	{
+		const sprite& quad = queued[sortKeys[i] & 0xFFFFFF];
+		float halfWidth = quad.width * 0.5f;
+		float halfHeight = quad.height * 0.5f;
+
+		//corner offsets relative to the center, counter clockwise starting at the bottom left
+		float cornerX[] = { -halfWidth, halfWidth, halfWidth, -halfWidth };
+		float cornerY[] = { -halfHeight, -halfHeight, halfHeight, halfHeight };
+		//texture coordinates are converted once per sprite instead of once per corner
+		unsigned short u0 = glm::packHalf1x16(quad.u0);
+		unsigned short u1 = glm::packHalf1x16(quad.u1);
+		unsigned short v0 = glm::packHalf1x16(quad.v0);
+		unsigned short v1 = glm::packHalf1x16(quad.v1);
+		unsigned short cornerU[] = { u0, u1, u1, u0 };
+		unsigned short cornerV[] = { v0, v0, v1, v1 };
+
+		unsigned short layer = glm::packHalf1x16((float)std::max(quad.layer, 0));
+
+		float cosine = 1.0f;
+		float sine = 0.0f;
+		if (quad.rotation != 0.0f)
+		{
+			cosine = cosf(quad.rotation);
+			sine = sinf(quad.rotation);
+		}
+
+		spriteVertex* corner = vertices + i * 4;
+		for (int c = 0; c < 4; c++)
+		{
+			corner[c].x = quad.x + cornerX[c] * cosine - cornerY[c] * sine;
+			corner[c].y = quad.y + cornerX[c] * sine + cornerY[c] * cosine;
+			corner[c].u = cornerU[c];
+			corner[c].v = cornerV[c];
+			corner[c].color = quad.color;
+			corner[c].layer = layer;
+		}
+	}
+
+	if (!mappedVertices)
+	{
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	frameStats.writeMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	glState().bindVertexArray(VAO);
+	glState().setBlend(true);
+	glState().setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	//draw every run of sprites sharing shader and texture with a single call
+	size_t runStart = 0;
+	for (size_t i = 1; i <= sortKeys.size(); i++)
+	{
+		const sprite& first = queued[sortKeys[runStart] & 0xFFFFFF];
+		if (i < sortKeys.size())
+		{
+			const sprite& current = queued[sortKeys[i] & 0xFFFFFF];
+			if (current.texture == first.texture && current.spriteShader == first.spriteShader && (current.layer >= 0) == (first.layer >= 0))	//layers of the same array texture stay in one run
+			{
+				continue;
+			}
+		}
+
+		bool arrayTexture = first.layer >= 0;
+		shader& runShader = first.spriteShader ? *first.spriteShader : (arrayTexture ? defaultArrayShader : defaultShader);
+		runShader.use();
+		runShader.setVec2("viewSize", viewWidth, viewHeight);
+		runShader.setInt("spriteTexture", 0);
+		glState().bindTexture(0, arrayTexture ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, first.texture);
+
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(i - runStart) * 6, GL_UNSIGNED_INT, (void*)0, (GLint)(firstVertex + runStart * 4));
+		frameStats.drawCalls++;
+		runStart = i;
+	}
+
+	segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);	//signaled once the GPU is done with this segment
+	segment = (segment + 1) % segmentCount;
+
+	frameStats.sprites += (int)queued.size();
+	frameStats.flushes++;
+	frameStats.flushMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	queued.clear();
+}
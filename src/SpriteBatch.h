@@ -0,0 +1,101 @@
+#pragma once
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <glad/glad.h>
+
+#include "ShaderLoader.h"
+#include "VertexFormat.h"
+#include "TextureAtlas.h"
+
+#include <vector>
+
+//textured quad drawn by the spriteBatch, positions are in pixels with the origin in the bottom left corner
+struct sprite
+{
+	unsigned int texture = 0;
+	shader* spriteShader = NULL;	//NULL uses the default sprite shader, custom shaders need the same inputs and uniforms (USE_TEXTURE_ARRAY variant for array textures)
+	float x = 0.0f;	//position of the center
+	float y = 0.0f;
+	float width = 1.0f;
+	float height = 1.0f;
+	float rotation = 0.0f;	//rotation around the center in radians
+	float u0 = 0.0f;	//texture coordinates of the bottom left corner
+	float v0 = 0.0f;
+	float u1 = 1.0f;	//texture coordinates of the top right corner
+	float v1 = 1.0f;
+	unsigned int color = 0xFFFFFFFF;	//tint as RGBA8, red in the lowest byte
+	int layer = -1;	//layer if texture is a GL_TEXTURE_2D_ARRAY, -1 for GL_TEXTURE_2D
+
+	void setRegion(unsigned int arrayTexture, const atlasRegion& region);	//use an image of a texture atlas
+};
+
+//order in which sprites are drawn
+enum class spriteSortMode
+{
+	state,	//group sprites by shader and texture, submission order is kept within a group
+	submission	//draw in submission order, needed if overlapping sprites are blended
+};
+
+//statistics of the last frame
+struct spriteBatchStats
+{
+	int sprites = 0;
+	int drawCalls = 0;
+	int flushes = 0;
+	double flushMilliseconds = 0.0;	//CPU time spent sorting, writing vertices and issuing draws
+	double writeMilliseconds = 0.0;	//part of flushMilliseconds spent before the draws are issued, the rest is spent in the driver
+};
+
+//collects sprites and draws them with as few draw calls as possible out of one persistently mapped vertex buffer
+//the buffer is split into three segments so the CPU writes one segment while the GPU still reads the others
+class spriteBatch
+{
+public:
+	spriteBatch(int maxSprites = 100000);
+	~spriteBatch();
+
+	void begin(float viewWidth, float viewHeight, spriteSortMode sortMode = spriteSortMode::state);	//start collecting sprites
+	void draw(const sprite& quad);	//queue sprite, flushes automatically if the current segment is full
+	void end();	//draw all queued sprites
+
+	const spriteBatchStats& stats() const { return lastStats; }
+
+private:
+	//vertex layout in the vertex buffer, 20 bytes per vertex
+	struct spriteVertex
+	{
+		float x;
+		float y;
+		unsigned short u;	//half float
+		unsigned short v;	//half float
+		unsigned int color;
+		unsigned short layer;	//half float
+		unsigned short padding;
+	};
+
+	static const int segmentCount = 3;
+
+	int maxSprites;	//capacity of one segment
+	unsigned int VAO;
+	unsigned int vertexBuff;
+	unsigned int elementBuff;
+	spriteVertex* mappedVertices = NULL;	//persistent mapping of the whole vertex buffer, NULL if buffer storage is not supported
+	GLsync segmentFences[segmentCount] = {};
+	int segment = 0;	//segment written by the next flush
+
+	shader defaultShader;
+	shader defaultArrayShader;	//default shader for sprites using array textures
+	float viewWidth = 1.0f;
+	float viewHeight = 1.0f;
+	spriteSortMode sortMode = spriteSortMode::state;
+
+	std::vector<sprite> queued;
+	std::vector<unsigned long long> sortKeys;
+	spriteBatchStats frameStats;
+	spriteBatchStats lastStats;
+
+	void flush();	//sort, write and draw all queued sprites into the next segment
+};
+
+#endif // !SPRITE_BATCH_H
@@ -0,0 +1,388 @@
+#include "TextureAtlas.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stb_image/stb_image.h>
+
+static const unsigned int atlasMagic = 0x54415253;	//"SRAT"
+static const unsigned int atlasVersion = 1;
+
+//header of a saved atlas, followed by the regions and the pixels of every layer
+struct atlasFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	int pageSize;
+	int padding;
+	int layerCount;
+	int regionCount;
+};
+
+skylinePacker::skylinePacker(int width, int height) : areaWidth(width), areaHeight(height)
+{
+	clear();
+}
+
+void skylinePacker::clear()
+{
+	skyline.clear();
+	skylineNode floor;
+	floor.x = 0;
+	floor.y = 0;
+	floor.width = areaWidth;
+	skyline.push_back(floor);
+	packedArea = 0;
+}
+
+int skylinePacker::fit(size_t index, int width, int height) const
+{
+	if (skyline[index].x + width > areaWidth)
+	{
+		return -1;
+	}
+
+	//the rectangle rests on the highest node it spans
+	int y = 0;
+	int remaining = width;
+	for (size_t i = index; remaining > 0; i++)
+	{
+		y = std::max(y, skyline[i].y);
+		if (y + height > areaHeight)
+		{
+			return -1;
+		}
+		remaining -= skyline[i].width;
+	}
+	return y;
+}
+
+bool skylinePacker::insert(int width, int height, int& x, int& y)
+{
+	//find the position with the lowest top edge, ties go to the narrower segment
+	int bestTop = areaHeight + 1;
+	int bestWidth = areaWidth + 1;
+	size_t bestIndex = skyline.size();
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		int nodeY = fit(i, width, height);
+		if (nodeY >= 0 && (nodeY + height < bestTop || (nodeY + height == bestTop && skyline[i].width < bestWidth)))
+		{
+			bestTop = nodeY + height;
+			bestWidth = skyline[i].width;
+			bestIndex = i;
+		}
+	}
+
+	if (bestIndex == skyline.size())
+	{
+		return false;
+	}
+
+	x = skyline[bestIndex].x;
+	y = bestTop - height;
+
+	//raise the skyline under the rectangle
+	skylineNode raised;
+	raised.x = x;
+	raised.y = bestTop;
+	raised.width = width;
+	skyline.insert(skyline.begin() + bestIndex, raised);
+
+	//shrink or remove the nodes now covered by the new one
+	for (size_t i = bestIndex + 1; i < skyline.size();)
+	{
+		int covered = raised.x + raised.width - skyline[i].x;
+		if (covered <= 0)
+		{
+			break;
+		}
+		if (covered >= skyline[i].width)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+		skyline[i].x += covered;
+		skyline[i].width -= covered;
+		break;
+	}
+
+	//merge neighbours of the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	packedArea += (long long)width * height;
+	return true;
+}
+
+textureAtlas::textureAtlas(int pageSize, int padding) : pageSize(pageSize), padding(padding)
+{
+}
+
+textureAtlas::~textureAtlas()
+{
+	if (arrayTexture)
+	{
+		glDeleteTextures(1, &arrayTexture);
+		glState().textureDeleted(arrayTexture);
+	}
+}
+
+int textureAtlas::add(const unsigned char* pixels, int width, int height)
+{
+	if (width + 2 * padding > pageSize || height + 2 * padding > pageSize || width <= 0 || height <= 0)
+	{
+		std::cout << "ERROR: image of " << width << "x" << height << " does not fit into an atlas page of " << pageSize << "x" << pageSize << std::endl;
+		return -1;
+	}
+
+	queuedImage image;
+	image.region = (int)regions.size();
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	queued.push_back(std::move(image));
+
+	regions.push_back(atlasRegion());
+	return (int)regions.size() - 1;
+}
+
+int textureAtlas::addFile(const char* path)
+{
+	int width, height, channels;
+	unsigned char* pixels = stbi_load(path, &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		std::cout << "ERROR: failed to load atlas image " << path << std::endl;
+		return -1;
+	}
+
+	int region = add(pixels, width, height);
+	stbi_image_free(pixels);
+	return region;
+}
+
+void textureAtlas::place(const queuedImage& image, int layer, int x, int y)
+{
+	std::vector<unsigned char>& page = pages[layer];
+	int paddedHeight = image.height + 2 * padding;
+
+	//copy rows, the padding repeats the nearest edge pixel
+	for (int row = 0; row < paddedHeight; row++)
+	{
+		int sourceRow = std::min(std::max(row - padding, 0), image.height - 1);
+		const unsigned char* source = image.pixels.data() + (size_t)sourceRow * image.width * 4;
+		unsigned char* target = page.data() + ((size_t)(y + row) * pageSize + x) * 4;
+
+		for (int column = 0; column < padding; column++)
+		{
+			memcpy(target + column * 4, source, 4);
+			memcpy(target + (padding + image.width + column) * 4, source + (image.width - 1) * 4, 4);
+		}
+		memcpy(target + padding * 4, source, (size_t)image.width * 4);
+	}
+
+	atlasRegion& region = regions[image.region];
+	region.layer = layer;
+	region.x = x + padding;
+	region.y = y + padding;
+	region.width = image.width;
+	region.height = image.height;
+	region.u0 = (float)region.x / pageSize;
+	region.v0 = (float)region.y / pageSize;
+	region.u1 = (float)(region.x + region.width) / pageSize;
+	region.v1 = (float)(region.y + region.height) / pageSize;
+}
+
+bool textureAtlas::build(bool mipmaps)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	bool success = true;
+
+	//large images first, small ones fill the gaps left between them
+	std::sort(queued.begin(), queued.end(), [](const queuedImage& a, const queuedImage& b)
+	{
+		return std::max(a.width, a.height) != std::max(b.width, b.height) ? std::max(a.width, a.height) > std::max(b.width, b.height) : a.height > b.height;
+	});
+
+	for (const queuedImage& image : queued)
+	{
+		int paddedWidth = image.width + 2 * padding;
+		int paddedHeight = image.height + 2 * padding;
+
+		//try every layer before opening a new one
+		int x = 0;
+		int y = 0;
+		int layer = 0;
+		for (; layer < (int)packers.size(); layer++)
+		{
+			if (packers[layer].insert(paddedWidth, paddedHeight, x, y))
+			{
+				break;
+			}
+		}
+		if (layer == (int)packers.size())
+		{
+			packers.push_back(skylinePacker(pageSize, pageSize));
+			pages.push_back(std::vector<unsigned char>((size_t)pageSize * pageSize * 4, 0));
+			if (!packers.back().insert(paddedWidth, paddedHeight, x, y))
+			{
+				success = false;
+				continue;
+			}
+		}
+
+		place(image, layer, x, y);
+		imagePixels += (long long)image.width * image.height;
+	}
+	queued.clear();
+
+	auto packedTime = std::chrono::steady_clock::now();
+
+	//upload all layers
+	if (!pages.empty())
+	{
+		if (!arrayTexture)
+		{
+			glGenTextures(1, &arrayTexture);
+		}
+		glState().bindTexture(0, GL_TEXTURE_2D_ARRAY, arrayTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, pageSize, pageSize, (GLsizei)pages.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		for (size_t layer = 0; layer < pages.size(); layer++)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, pageSize, pageSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, pages[layer].data());
+		}
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		//a texel of mip level L averages 2^L pixels in each direction, beyond 2^L = padding it reaches into the neighbouring images
+		int maxLevel = 0;
+		while (mipmaps && (2 << maxLevel) <= padding)
+		{
+			maxLevel++;
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, maxLevel > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (maxLevel > 0)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+
+	auto uploadedTime = std::chrono::steady_clock::now();
+
+	lastStats.images = (int)regions.size();
+	lastStats.layers = (int)pages.size();
+	lastStats.efficiency = pages.empty() ? 0.0 : (double)imagePixels / ((double)pageSize * pageSize * pages.size());
+	lastStats.packMilliseconds = std::chrono::duration<double, std::milli>(packedTime - startTime).count();
+	lastStats.uploadMilliseconds = std::chrono::duration<double, std::milli>(uploadedTime - packedTime).count();
+	return success;
+}
+
+bool textureAtlas::save(const char* path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR: atlas could not be written to " << path << std::endl;
+		return false;
+	}
+
+	atlasFileHeader header;
+	header.magic = atlasMagic;
+	header.version = atlasVersion;
+	header.pageSize = pageSize;
+	header.padding = padding;
+	header.layerCount = (int)pages.size();
+	header.regionCount = (int)regions.size();
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)regions.data(), regions.size() * sizeof(atlasRegion));
+	for (const std::vector<unsigned char>& page : pages)
+	{
+		file.write((const char*)page.data(), page.size());
+	}
+	return file.good();
+}
+
+bool textureAtlas::load(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	atlasFileHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != atlasMagic || header.version != atlasVersion)
+	{
+		std::cout << "ERROR: " << path << " is not a valid atlas file" << std::endl;
+		return false;
+	}
+
+	pageSize = header.pageSize;
+	padding = header.padding;
+	regions.resize(header.regionCount);
+	file.read((char*)regions.data(), regions.size() * sizeof(atlasRegion));
+
+	pages.assign(header.layerCount, std::vector<unsigned char>((size_t)pageSize * pageSize * 4));
+	for (std::vector<unsigned char>& page : pages)
+	{
+		file.read((char*)page.data(), page.size());
+	}
+	if (!file)
+	{
+		std::cout << "ERROR: atlas file " << path << " is truncated" << std::endl;
+		regions.clear();
+		pages.clear();
+		return false;
+	}
+
+	//the layers are full as far as new images are concerned
+	packers.assign(pages.size(), skylinePacker(pageSize, pageSize));
+	for (skylinePacker& packer : packers)
+	{
+		int x, y;
+		packer.insert(pageSize, pageSize, x, y);
+	}
+	queued.clear();
+
+	imagePixels = 0;
+	for (const atlasRegion& region : regions)
+	{
+		imagePixels += (long long)region.width * region.height;
+	}
+	return true;
+}
+
+unsigned int createTextureArray(const std::vector<const unsigned char*>& layers, int width, int height, bool mipmaps)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glState().bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (GLsizei)layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	for (size_t layer = 0; layer < layers.size(); layer++)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, layers[layer]);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (mipmaps)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	}
+	return texture;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+//packs rectangles into a fixed size area with the skyline bottom left heuristic
+class skylinePacker
+{
+public:
+	skylinePacker(int width, int height);
+
+	bool insert(int width, int height, int& x, int& y);	//returns false if the rectangle does not fit anymore
+	void clear();
+
+	long long usedArea() const { return packedArea; }
+	int width() const { return areaWidth; }
+	int height() const { return areaHeight; }
+
+private:
+	//horizontal segment of the skyline
+	struct skylineNode
+	{
+		int x;
+		int y;	//height of the skyline over this segment
+		int width;
+	};
+
+	int areaWidth;
+	int areaHeight;
+	long long packedArea = 0;
+	std::vector<skylineNode> skyline;	//sorted by x, covers the whole width
+
+	int fit(size_t index, int width, int height) const;	//lowest y a rectangle can be placed at starting at node index, -1 if it does not fit
+};
+
+//image placed in a textureAtlas
+struct atlasRegion
+{
+	int layer = 0;	//layer of the array texture
+	int x = 0;	//position in pixels, without padding
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	float u0 = 0.0f;	//texture coordinates of the bottom left corner
+	float v0 = 0.0f;
+	float u1 = 0.0f;	//texture coordinates of the top right corner
+	float v1 = 0.0f;
+};
+
+//statistics of the last build
+struct atlasStats
+{
+	int images = 0;
+	int layers = 0;
+	double efficiency = 0.0;	//image pixels divided by the pixels of all layers
+	double packMilliseconds = 0.0;
+	double uploadMilliseconds = 0.0;
+};
+
+//packs many images into the layers of one GL_TEXTURE_2D_ARRAY so sprites using them can be drawn without texture switches
+//images are queued with add and packed largest first by build, atlases can be saved after building and loaded instead of packing again
+class textureAtlas
+{
+public:
+	textureAtlas(int pageSize = 2048, int padding = 1);	//padding repeats the edge pixels around every image so filtering does not pick up neighbours, a padding of 2^L allows mip levels up to L
+	~textureAtlas();
+
+	int add(const unsigned char* pixels, int width, int height);	//queue RGBA8 image, returns index of its region or -1 if it is larger than a page
+	int addFile(const char* path);	//queue image file, returns -1 if it could not be loaded
+	bool build(bool mipmaps = false);	//pack all queued images and upload the layers, returns false if an image could not be placed, mipmaps stop at the level the padding covers
+
+	bool save(const char* path) const;	//store packed layers and regions
+	bool load(const char* path);	//replace the atlas with a saved one, call build afterwards to upload it
+
+	const atlasRegion& region(int index) const { return regions[index]; }
+	int regionCount() const { return (int)regions.size(); }
+	unsigned int texture() const { return arrayTexture; }
+	int layerCount() const { return (int)pages.size(); }
+	const atlasStats& stats() const { return lastStats; }
+
+private:
+	//image waiting for build
+	struct queuedImage
+	{
+		int region;
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	int pageSize;
+	int padding;
+	std::vector<skylinePacker> packers;	//one per layer
+	std::vector<std::vector<unsigned char>> pages;	//RGBA8 pixels of every layer
+	std::vector<atlasRegion> regions;
+	std::vector<queuedImage> queued;
+	long long imagePixels = 0;
+	unsigned int arrayTexture = 0;
+	atlasStats lastStats;
+
+	void place(const queuedImage& image, int layer, int x, int y);	//copy image with padding into a layer
+};
+
+//create a GL_TEXTURE_2D_ARRAY with one RGBA8 image of the same size per layer
+unsigned int createTextureArray(const std::vector<const unsigned char*>& layers, int width, int height, bool mipmaps = true);
+
+#endif // !TEXTURE_ATLAS_H
@@ -0,0 +1,254 @@
+#include "TextureCache.h"
+#include "Hash.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sstream>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char* cacheDirectory = "Resources/TextureCache";
+static const unsigned int cacheMagic = 0x58545253;	//"SRTX"
+static const unsigned int cacheVersion = 3;
+
+//header at the start of every cache file, followed by the level table and the pixels
+struct cacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long key;
+	unsigned int channels;
+	unsigned int type;	//pixelType of a channel
+	unsigned int format;	//blockFormat of the levels
+	unsigned int levelCount;
+};
+
+//entry of the level table, offsets are relative to the start of the file
+struct cacheLevelEntry
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned long long offset;
+};
+
+mappedFile::mappedFile(const std::string& path)
+{
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		fileHandle = NULL;
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle)
+	{
+		memory = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		length = (size_t)fileSize.QuadPart;
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return;
+	}
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) == 0 && fileInfo.st_size > 0)
+	{
+		void* mapping = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED)
+		{
+			memory = mapping;
+			length = (size_t)fileInfo.st_size;
+		}
+	}
+	close(file);	//the mapping stays valid after closing the file
+#endif
+}
+
+mappedFile::~mappedFile()
+{
+#ifdef _WIN32
+	if (memory)
+	{
+		UnmapViewOfFile(memory);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle)
+	{
+		CloseHandle(fileHandle);
+	}
+#else
+	if (memory)
+	{
+		munmap(memory, length);
+	}
+#endif
+}
+
+static std::string cachePath(unsigned long long key)
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.tex", key);
+	return std::string(cacheDirectory) + "/" + fileName;
+}
+
+unsigned long long textureCacheKey(const void* fileData, size_t fileSize, bool flipVertically, int channels, unsigned int processing)
+{
+	unsigned long long key = hashBytes(fileData, fileSize);
+
+	//the same file loaded with different flags decodes to different pixels
+	unsigned int flags[] = { flipVertically ? 1u : 0u, (unsigned int)channels };
+	key = hashBytes(flags, sizeof(flags), key);
+
+	if (processing != 0)	//processed images get their own entry, keys of plain images stay unchanged
+	{
+		key = hashBytes(&processing, sizeof(processing), key);
+	}
+	return key;
+}
+
+bool openCachedTexture(unsigned long long key, cachedTexture& texture)
+{
+	mappedFile* file = new mappedFile(cachePath(key));
+	if (!file->isOpen() || file->size() < sizeof(cacheHeader))	//check if image is cached
+	{
+		delete file;
+		return false;
+	}
+
+	const cacheHeader* header = (const cacheHeader*)file->data();
+	size_t tableEnd = sizeof(cacheHeader) + (size_t)header->levelCount * sizeof(cacheLevelEntry);
+	if (header->magic != cacheMagic || header->version != cacheVersion || header->key != key || header->levelCount == 0 || header->channels == 0 || header->channels > 4 || header->type > (unsigned int)pixelType::float32 || header->format > (unsigned int)blockFormat::bc3 || tableEnd > file->size())
+	{
+		delete file;
+		return false;
+	}
+
+	//resolve levels and make sure every level lies inside of the file
+	const cacheLevelEntry* entries = (const cacheLevelEntry*)(file->data() + sizeof(cacheHeader));
+	std::vector<cachedLevel> levels;
+	for (unsigned int i = 0; i < header->levelCount; i++)
+	{
+		unsigned long long levelSize = imageSize((int)entries[i].width, (int)entries[i].height, (int)header->channels, (pixelType)header->type, (blockFormat)header->format);
+		if (entries[i].offset < tableEnd || entries[i].offset + levelSize > file->size())
+		{
+			delete file;
+			return false;
+		}
+
+		cachedLevel level;
+		level.width = (int)entries[i].width;
+		level.height = (int)entries[i].height;
+		level.pixels = file->data() + entries[i].offset;
+		levels.push_back(level);
+	}
+
+	delete texture.file;
+	texture.file = file;
+	texture.channels = (int)header->channels;
+	texture.type = (pixelType)header->type;
+	texture.format = (blockFormat)header->format;
+	texture.levels = levels;
+	return true;
+}
+
+void storeCachedTexture(unsigned long long key, int channels, pixelType type, const std::vector<cachedLevel>& levels, blockFormat format)
+{
+	cacheHeader header;
+	header.magic = cacheMagic;
+	header.version = cacheVersion;
+	header.key = key;
+	header.channels = (unsigned int)channels;
+	header.type = (unsigned int)type;
+	header.format = (unsigned int)format;
+	header.levelCount = (unsigned int)levels.size();
+
+	//pixels start after the level table, every level is aligned to 16 bytes
+	std::vector<cacheLevelEntry> entries;
+	unsigned long long offset = sizeof(cacheHeader) + levels.size() * sizeof(cacheLevelEntry);
+	for (const cachedLevel& level : levels)
+	{
+		offset = (offset + 15) & ~15ull;
+
+		cacheLevelEntry entry;
+		entry.width = (unsigned int)level.width;
+		entry.height = (unsigned int)level.height;
+		entry.offset = offset;
+		entries.push_back(entry);
+
+		offset += imageSize(level.width, level.height, channels, type, format);
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+
+	//write into a temporary file first, so other threads and processes never map a half written file
+	std::string path = cachePath(key);
+	std::stringstream tempPath;
+	tempPath << path << "." << std::this_thread::get_id() << ".tmp";
+
+	{
+		std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "ERROR: texture cache could not be written" << std::endl;
+			return;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)entries.data(), entries.size() * sizeof(cacheLevelEntry));
+
+		const char padding[16] = {};
+		unsigned long long position = sizeof(cacheHeader) + entries.size() * sizeof(cacheLevelEntry);
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			file.write(padding, entries[i].offset - position);
+			size_t levelSize = imageSize(levels[i].width, levels[i].height, channels, type, format);
+			file.write((const char*)levels[i].pixels, levelSize);
+			position = entries[i].offset + levelSize;
+		}
+
+		if (!file)
+		{
+			std::cout << "ERROR: texture cache could not be written" << std::endl;
+			file.close();
+			std::filesystem::remove(tempPath.str(), error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(tempPath.str(), path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath.str(), error);
+	}
+}
+
+void clearTextureCache()
+{
+	std::error_code error;
+	std::filesystem::remove_all(cacheDirectory, error);
+}
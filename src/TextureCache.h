@@ -0,0 +1,62 @@
+#pragma once
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "TextureFormat.h"
+
+#include <string>
+#include <vector>
+
+//read only memory mapping of a whole file
+class mappedFile
+{
+public:
+	mappedFile(const std::string& path);
+	~mappedFile();
+	mappedFile(const mappedFile&) = delete;
+	mappedFile& operator=(const mappedFile&) = delete;
+
+	bool isOpen() const { return memory != NULL; }
+	const unsigned char* data() const { return (const unsigned char*)memory; }
+	size_t size() const { return length; }
+
+private:
+	void* memory = NULL;
+	size_t length = 0;
+#ifdef _WIN32
+	void* fileHandle = NULL;
+	void* mappingHandle = NULL;
+#endif
+};
+
+//level of a cached image
+struct cachedLevel
+{
+	int width;
+	int height;
+	const unsigned char* pixels;	//points into the mapped cache file or into decoded memory
+};
+
+//decoded image stored in the texture cache, the pixels stay valid as long as the object exists
+struct cachedTexture
+{
+	mappedFile* file = NULL;
+	int channels = 0;
+	pixelType type = pixelType::unorm8;
+	blockFormat format = blockFormat::none;	//block compression of the levels
+	std::vector<cachedLevel> levels;	//level 0 is the full size image
+
+	cachedTexture() = default;
+	cachedTexture(const cachedTexture&) = delete;
+	cachedTexture& operator=(const cachedTexture&) = delete;
+	~cachedTexture() { delete file; }
+};
+
+//persistent cache of decoded images, keyed by the content of the encoded file and the load flags
+//on a hit the decoded pixels are mapped straight from disk and no JPEG/PNG decoding is needed
+unsigned long long textureCacheKey(const void* fileData, size_t fileSize, bool flipVertically, int channels, unsigned int processing = 0);	//processing identifies the generated levels and compression, 0 if only the decoded level 0 is stored
+bool openCachedTexture(unsigned long long key, cachedTexture& texture);	//map cached image, returns false on a miss
+void storeCachedTexture(unsigned long long key, int channels, pixelType type, const std::vector<cachedLevel>& levels, blockFormat format = blockFormat::none);	//write decoded image with all its levels into the cache
+void clearTextureCache();	//delete every cached image, the next load decodes again
+
+#endif // !TEXTURE_CACHE_H
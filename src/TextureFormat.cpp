@@ -0,0 +1,69 @@
+#include "TextureFormat.h"
+
+#include <algorithm>
+
+static size_t channelSize(pixelType type)
+{
+	switch (type)
+	{
+	case pixelType::unorm16:
+		return 2;
+	case pixelType::float32:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+size_t pixelSize(int channels, pixelType type)
+{
+	return channels * channelSize(type);
+}
+
+size_t imageSize(int width, int height, int channels, pixelType type, blockFormat compression)
+{
+	if (compression != blockFormat::none)
+	{
+		return compressedSize(width, height, compression);
+	}
+	return (size_t)width * height * pixelSize(channels, type);
+}
+
+textureFormat uncompressedFormat(int channels, pixelType type)
+{
+	static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	static const GLenum internalFormats[3][4] =
+	{
+		{ GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 },
+		{ GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 },
+		{ GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F }
+	};
+
+	channels = std::min(std::max(channels, 1), 4);
+
+	textureFormat format;
+	format.internalFormat = internalFormats[(int)type][channels - 1];
+	format.format = formats[channels - 1];
+	format.type = type == pixelType::unorm8 ? GL_UNSIGNED_BYTE : type == pixelType::unorm16 ? GL_UNSIGNED_SHORT : GL_FLOAT;
+
+	//grey and grey alpha images would otherwise show up red and red green
+	GLint identity[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+	GLint grey[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+	GLint greyAlpha[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+	const GLint* swizzle = channels == 1 ? grey : channels == 2 ? greyAlpha : identity;
+	std::copy(swizzle, swizzle + 4, format.swizzle);
+	return format;
+}
+
+int unpackAlignment(int width, int channels, pixelType type)
+{
+	size_t rowSize = (size_t)width * pixelSize(channels, type);
+	for (int alignment = 8; alignment > 1; alignment /= 2)
+	{
+		if (rowSize % alignment == 0)
+		{
+			return alignment;
+		}
+	}
+	return 1;
+}
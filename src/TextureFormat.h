@@ -0,0 +1,33 @@
+#pragma once
+#ifndef TEXTURE_FORMAT_H
+#define TEXTURE_FORMAT_H
+
+#include <glad/glad.h>
+
+#include "BlockCompressor.h"
+
+#include <cstddef>
+
+//data type of one channel of decoded pixels
+enum class pixelType
+{
+	unorm8,	//stbi_load
+	unorm16,	//stbi_load_16, 16 bit PNG
+	float32	//stbi_loadf, Radiance HDR
+};
+
+//GL formats matching decoded pixels, the internal format has the same layout as the data so the driver does not convert it
+struct textureFormat
+{
+	GLenum internalFormat;
+	GLenum format;
+	GLenum type;
+	GLint swizzle[4];	//maps the stored channels onto RGBA, grey images are spread over RGB
+};
+
+size_t pixelSize(int channels, pixelType type);	//bytes of one pixel
+size_t imageSize(int width, int height, int channels, pixelType type, blockFormat compression);	//bytes of one level, compressed levels ignore channels and type
+textureFormat uncompressedFormat(int channels, pixelType type);	//formats for 1 to 4 channels
+int unpackAlignment(int width, int channels, pixelType type);	//largest GL_UNPACK_ALIGNMENT the rows of an image satisfy
+
+#endif // !TEXTURE_FORMAT_H
@@ -0,0 +1,437 @@
+#include "TextureManager.h"
+#include "ImageDecoder.h"
+#include "GLState.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+
+textureManager::textureManager(int threadCount, size_t stagingSize) : decoders(threadCount), stagingSize(stagingSize)
+{
+	s3tcSupported = compressionSupported();
+
+	glGenBuffers(1, &stagingBuff);
+	glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuff);
+
+	if (GLAD_GL_VERSION_4_4)	//map the staging buffer once and keep it mapped
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, stagingSize, NULL, flags);
+		stagingMemory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stagingSize, flags);
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, NULL, GL_STREAM_DRAW);
+	}
+
+	glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+textureManager::~textureManager()
+{
+	finish();
+
+	for (stagingRegion& region : stagingInFlight)
+	{
+		glDeleteSync(region.fence);
+	}
+
+	if (stagingMemory)
+	{
+		glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuff);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &stagingBuff);
+	glState().bufferDeleted(stagingBuff);
+}
+
+unsigned int textureManager::load(const std::string& path, const textureParams& params)
+{
+	textureRequest request;
+	request.path = path;
+	request.params = params;
+	if (params.compression != blockFormat::none && !s3tcSupported)
+	{
+		std::cout << "ERROR: S3TC textures are not supported, loading uncompressed: " << path << std::endl;
+		request.params.compression = blockFormat::none;
+	}
+	glGenTextures(1, &request.texture);	//generate texture object
+
+	int index = (int)requests.size();
+	requests.push_back(request);
+	pendingUploads++;
+
+	//decode on a worker thread
+	decoders.run([this, path, index, params = request.params]()
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		decodedImage image;
+		image.request = index;
+		decode(image, path, params);
+		image.decodeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			decoded.push_back(image);
+		}
+		decodedAvailable.notify_one();
+	});
+
+	return request.texture;
+}
+
+void textureManager::decode(decodedImage& image, const std::string& path, const textureParams& params)
+{
+	image.pixels = NULL;
+
+	//read the encoded file
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return;
+	}
+	std::vector<unsigned char> fileData((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)fileData.data(), fileData.size());
+	if (!file)
+	{
+		return;
+	}
+
+	//pick channels and precision from the file header, the block compressor works on RGBA8
+	bool compress = params.compression != blockFormat::none;
+	imageInfo info;
+	if (!readImageInfo(fileData.data(), fileData.size(), compress ? 4 : params.channels, params.highPrecision && !compress, info))
+	{
+		return;
+	}
+	image.width = info.width;
+	image.height = info.height;
+	image.channels = info.channels;
+	image.type = info.type;
+
+	//the CPU mip generator works on RGBA8, other images get their mipmaps from the driver
+	bool generateMips = params.mipmaps && ((params.cpuMipmaps && image.channels == 4 && image.type == pixelType::unorm8) || compress);	//glGenerateMipmap cannot fill compressed textures
+
+	//use the already decoded pixels if this exact file was loaded with the same flags before
+	unsigned int processing = generateMips ? mipSettingsHash(params.mipGeneration) : 0;
+	if (compress)
+	{
+		processing |= ((unsigned int)params.compression << 8) | ((unsigned int)params.compressionLevel << 10);
+	}
+	processing |= (unsigned int)image.type << 12;
+	unsigned long long cacheKey = textureCacheKey(fileData.data(), fileData.size(), params.flipVertically, image.channels, processing);
+	if (params.useCache)
+	{
+		std::shared_ptr<cachedTexture> cached = std::make_shared<cachedTexture>();
+		if (openCachedTexture(cacheKey, *cached))
+		{
+			image.cached = cached;
+			image.width = cached->levels[0].width;
+			image.height = cached->levels[0].height;
+			image.pixels = cached->levels[0].pixels;
+			image.channels = cached->channels;
+			image.type = cached->type;
+			if (generateMips || compress)
+			{
+				image.levels = cached->levels;
+				image.format = cached->format;
+			}
+			return;
+		}
+	}
+
+	image.pixels = decodeImage(fileData.data(), fileData.size(), info, params.flipVertically);
+
+	if (!image.pixels)
+	{
+		return;
+	}
+
+	std::vector<cachedLevel> levels(1);
+	levels[0].width = image.width;
+	levels[0].height = image.height;
+	levels[0].pixels = image.pixels;
+
+	if (generateMips)	//filter the mipmaps here so the GL thread only has to upload them
+	{
+		image.mipData = std::make_shared<std::vector<unsigned char>>();
+		generateMipChain(image.pixels, image.width, image.height, params.mipGeneration, *image.mipData, levels);
+		image.levels = levels;
+	}
+
+	if (compress)	//encode every level into blocks, the levels then point at the compressed data
+	{
+		size_t totalSize = 0;
+		for (const cachedLevel& level : levels)
+		{
+			totalSize += compressedSize(level.width, level.height, params.compression);
+		}
+
+		image.compressedData = std::make_shared<std::vector<unsigned char>>(totalSize);
+		unsigned char* destination = image.compressedData->data();
+		for (cachedLevel& level : levels)
+		{
+			compressImage(level.pixels, level.width, level.height, params.compression, params.compressionLevel, destination);
+			level.pixels = destination;
+			destination += compressedSize(level.width, level.height, params.compression);
+		}
+
+		image.levels = levels;
+		image.format = params.compression;
+	}
+
+	if (params.useCache)
+	{
+		storeCachedTexture(cacheKey, image.channels, image.type, levels, image.format);
+	}
+}
+
+bool textureManager::update()
+{
+	while (pendingUploads > 0)
+	{
+		decodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			if (decoded.empty())
+			{
+				return false;
+			}
+			image = decoded.front();
+			decoded.pop_front();
+		}
+		upload(image);
+	}
+	return true;
+}
+
+void textureManager::finish()
+{
+	while (pendingUploads > 0)
+	{
+		decodedImage image;
+		{
+			std::unique_lock<std::mutex> lock(decodedMutex);
+			decodedAvailable.wait(lock, [this] { return !decoded.empty(); });
+			image = decoded.front();
+			decoded.pop_front();
+		}
+		upload(image);
+	}
+}
+
+void textureManager::upload(decodedImage& image)
+{
+	textureRequest& request = requests[image.request];
+	pendingUploads--;
+	loadStats.decodeMilliseconds += image.decodeMilliseconds;
+
+	if (!image.pixels)	//check if there is data is not NULL
+	{
+		std::cout << "ERROR: texture loading failed: " << request.path << std::endl;
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	glState().bindTexture(0, GL_TEXTURE_2D, request.texture);	//bind texture to GL_TEXTURE_2D
+
+	//texture wrapping and filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, request.params.wrapS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, request.params.wrapT);
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, request.params.borderColor);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, request.params.minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, request.params.magFilter);
+
+	//upload the CPU generated levels as well, otherwise only level 0
+	std::vector<cachedLevel> levels = image.levels;
+	if (levels.empty())
+	{
+		cachedLevel level;
+		level.width = image.width;
+		level.height = image.height;
+		level.pixels = image.pixels;
+		levels.push_back(level);
+	}
+
+	textureFormat format = uncompressedFormat(image.channels, image.type);
+	if (image.format == blockFormat::none)
+	{
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle);
+	}
+	else
+	{
+		format.internalFormat = compressedInternalFormat(image.format);
+	}
+
+	//allocate every level at once, the levels the driver generates included
+	bool immutable = request.params.immutableStorage && GLAD_GL_VERSION_4_2;
+	if (immutable)
+	{
+		int levelCount = levels.size() == 1 && request.params.mipmaps ? mipLevelCount(image.width, image.height) : (int)levels.size();
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, format.internalFormat, image.width, image.height);
+	}
+
+	for (int i = 0; i < (int)levels.size(); i++)
+	{
+		const cachedLevel& level = levels[i];
+		size_t size = imageSize(level.width, level.height, image.channels, image.type, image.format);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(level.width, image.channels, image.type));
+		loadStats.uploadedBytes += size;
+
+		if (size > stagingSize)	//level does not fit into the staging buffer, stream it through in strips of rows
+		{
+			uploadStrips(i, level, image.channels, image.type, format, image.format, immutable);
+			continue;
+		}
+
+		size_t offset = stage(level.pixels, size);
+		uploadLevel(i, level.width, level.height, format, image.format, immutable, size, (void*)offset);	//generate texture from staging buffer
+		releaseStaging(offset, size);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//back to the GL default for other uploads
+
+	if (levels.size() > 1)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)levels.size() - 1);
+	}
+	else if (request.params.mipmaps)	//the driver only has to generate the levels if they were not made on the CPU
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);	//generate Mipmap
+	}
+
+	if (!image.cached)
+	{
+		freeImage(image.pixels);	//free image memory
+	}
+
+	loadStats.textures++;
+	loadStats.cacheHits += image.cached ? 1 : 0;
+	loadStats.uploadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void textureManager::uploadLevel(int level, int width, int height, const textureFormat& format, blockFormat compression, bool immutable, size_t size, const void* data)
+{
+	if (compression != blockFormat::none)
+	{
+		if (immutable)
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format.internalFormat, (GLsizei)size, data);
+		}
+		else
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, width, height, 0, (GLsizei)size, data);
+		}
+	}
+	else if (immutable)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format.format, format.type, data);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, format.internalFormat, width, height, 0, format.format, format.type, data);
+	}
+}
+
+void textureManager::uploadStrips(int level, const cachedLevel& pixels, int channels, pixelType type, const textureFormat& format, blockFormat compression, bool immutable)
+{
+	//compressed levels are streamed in whole rows of blocks
+	int rowHeight = compression == blockFormat::none ? 1 : 4;
+	size_t rowSize = imageSize(pixels.width, rowHeight, channels, type, compression);
+	size_t size = imageSize(pixels.width, pixels.height, channels, type, compression);
+	if (rowSize > stagingSize / 2)	//not even a few rows fit, upload from client memory instead
+	{
+		uploadLevel(level, pixels.width, pixels.height, format, compression, immutable, size, pixels.pixels);
+		return;
+	}
+
+	if (!immutable)	//allocate the level, the strips only fill it
+	{
+		uploadLevel(level, pixels.width, pixels.height, format, compression, false, size, NULL);
+	}
+
+	//strips of half the staging buffer, so the next strip can be copied while the driver reads the previous one
+	int stripHeight = (int)(stagingSize / 2 / rowSize) * rowHeight;
+	for (int y = 0; y < pixels.height; y += stripHeight)
+	{
+		int rows = std::min(stripHeight, pixels.height - y);
+		size_t stripSize = imageSize(pixels.width, rows, channels, type, compression);
+		size_t offset = stage(pixels.pixels + (size_t)(y / rowHeight) * rowSize, stripSize);
+
+		if (compression != blockFormat::none)
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, pixels.width, rows, format.internalFormat, (GLsizei)stripSize, (void*)offset);
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, pixels.width, rows, format.format, format.type, (void*)offset);
+		}
+		releaseStaging(offset, stripSize);
+	}
+}
+
+size_t textureManager::stage(const unsigned char* data, size_t size)
+{
+	size_t offset = allocateStaging(size);
+
+	glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuff);
+	if (stagingMemory)
+	{
+		memcpy(stagingMemory + offset, data, size);
+	}
+	else
+	{
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		memcpy(mapped, data, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	return offset;
+}
+
+void textureManager::releaseStaging(size_t offset, size_t size)
+{
+	glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	//the region can be reused once the driver has read it
+	stagingRegion region;
+	region.offset = offset;
+	region.size = size;
+	region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	stagingInFlight.push_back(region);
+}
+
+size_t textureManager::allocateStaging(size_t size)
+{
+	if (size > stagingSize)
+	{
+		return (size_t)-1;
+	}
+
+	if (stagingHead + size > stagingSize)	//wrap around to the start of the ring
+	{
+		stagingHead = 0;
+	}
+
+	//regions are allocated in order, so the oldest region in flight is the only one that can be in the way
+	while (!stagingInFlight.empty())
+	{
+		stagingRegion& oldest = stagingInFlight.front();
+		bool overlaps = oldest.offset < stagingHead + size && stagingHead < oldest.offset + oldest.size;
+		if (!overlaps)
+		{
+			break;
+		}
+
+		glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);	//wait until the driver has read the region
+		glDeleteSync(oldest.fence);
+		stagingInFlight.pop_front();
+	}
+
+	size_t offset = stagingHead;
+	stagingHead += (size + 255) & ~(size_t)255;	//keep allocations aligned
+	return offset;
+}
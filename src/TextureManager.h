@@ -0,0 +1,123 @@
+#pragma once
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+
+#include "ThreadPool.h"
+#include "TextureCache.h"
+#include "MipGenerator.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+//sampling state and load flags of a texture
+struct textureParams
+{
+	GLint wrapS = GL_REPEAT;
+	GLint wrapT = GL_REPEAT;
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	float borderColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	bool flipVertically = true;	//flip image on the y axis while loading
+	int channels = 0;	//channels to decode, 0 keeps the channels of the file
+	bool highPrecision = true;	//keep 16 bit and HDR images at their precision instead of reducing them to 8 bit
+	bool mipmaps = true;	//generate mipmaps after the upload
+	bool cpuMipmaps = true;	//generate the mipmaps on the decoder threads and cache them instead of calling glGenerateMipmap
+	mipSettings mipGeneration;	//filter of the CPU generated mipmaps
+	blockFormat compression = blockFormat::none;	//block compress all levels on the decoder threads, the mipmaps are then always generated on the CPU
+	compressionQuality compressionLevel = compressionQuality::fast;	//encoder effort of the block compression
+	bool useCache = true;	//keep the decoded pixels in the texture cache so later runs skip decoding
+	bool immutableStorage = true;	//allocate all levels with glTexStorage2D if GL 4.2 is available, otherwise every level is allocated by glTexImage2D
+};
+
+//statistics of all textures loaded by a textureManager
+struct textureLoadStats
+{
+	int textures = 0;	//textures that have been uploaded
+	int cacheHits = 0;	//textures mapped from the texture cache instead of decoded
+	size_t uploadedBytes = 0;	//pixel data of every uploaded level
+	double decodeMilliseconds = 0.0;	//reading, decoding, mipmap filtering, compression and cache access, summed over the decoder threads
+	double uploadMilliseconds = 0.0;	//time spent uploading on the GL thread
+};
+
+//loads textures by decoding images on a thread pool and uploading them on the GL thread through a staging buffer
+//levels larger than the staging buffer are streamed through it in strips of rows
+//decoding of the next images overlaps the upload of the current one
+class textureManager
+{
+public:
+	textureManager(int threadCount = 0, size_t stagingSize = 64 * 1024 * 1024);
+	~textureManager();
+
+	unsigned int load(const std::string& path, const textureParams& params);	//queue texture for loading, the texture object is created right away
+	bool update();	//upload all textures that have been decoded so far without waiting, returns true once every queued texture is uploaded
+	void finish();	//wait for and upload all queued textures
+
+	const textureLoadStats& stats() const { return loadStats; }
+	int threadCount() const { return decoders.threadCount(); }
+
+private:
+	//image that finished decoding and waits for its upload
+	struct decodedImage
+	{
+		int request;	//index into requests
+		int width;
+		int height;
+		const unsigned char* pixels;	//level 0 with channels of type, NULL if the decoding failed
+		int channels = 4;
+		pixelType type = pixelType::unorm8;
+		std::vector<cachedLevel> levels;	//level 0 followed by the CPU generated mipmaps, empty if the mipmaps are left to the driver
+		std::shared_ptr<std::vector<unsigned char>> mipData;	//memory of the generated levels, shared so copies of the image keep it alive
+		std::shared_ptr<std::vector<unsigned char>> compressedData;	//memory of the compressed levels
+		blockFormat format = blockFormat::none;	//block compression of levels
+		std::shared_ptr<cachedTexture> cached;	//set if the pixels are mapped from the texture cache instead of decoded
+		double decodeMilliseconds = 0.0;
+	};
+
+	//texture that has been queued with load
+	struct textureRequest
+	{
+		std::string path;
+		textureParams params;
+		unsigned int texture;
+	};
+
+	//part of the staging buffer that is read by an upload which might still be in flight
+	struct stagingRegion
+	{
+		size_t offset;
+		size_t size;
+		GLsync fence;
+	};
+
+	threadPool decoders;
+	std::vector<textureRequest> requests;
+	int pendingUploads = 0;
+
+	std::deque<decodedImage> decoded;	//filled by the decoder threads
+	std::mutex decodedMutex;
+	std::condition_variable decodedAvailable;
+
+	unsigned int stagingBuff;
+	size_t stagingSize;
+	size_t stagingHead = 0;
+	unsigned char* stagingMemory = NULL;	//persistent mapping, NULL if buffer storage is not supported
+	std::deque<stagingRegion> stagingInFlight;
+	bool s3tcSupported;	//true if S3TC textures can be uploaded
+	textureLoadStats loadStats;
+
+	static void decode(decodedImage& image, const std::string& path, const textureParams& params);	//load image from the texture cache or decode it, runs on the decoder threads
+	void upload(decodedImage& image);	//upload decoded image into its texture
+	static void uploadLevel(int level, int width, int height, const textureFormat& format, blockFormat compression, bool immutable, size_t size, const void* data);	//fill a level of the bound texture, with immutable storage the level is already allocated
+	void uploadStrips(int level, const cachedLevel& pixels, int channels, pixelType type, const textureFormat& format, blockFormat compression, bool immutable);	//upload a level larger than the staging buffer in strips of rows, so neither side needs a second copy of the whole level
+	size_t stage(const unsigned char* data, size_t size);	//copy into staging memory and bind the staging buffer, returns the offset to pass as pixel pointer
+	void releaseStaging(size_t offset, size_t size);	//unbind the staging buffer and fence the region read by the last upload
+	size_t allocateStaging(size_t size);	//get offset of free staging memory, waits for old uploads if needed
+};
+
+#endif // !TEXTURE_MANAGER_H
@@ -0,0 +1,187 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+//indices [next, end) still to be done by one worker of a parallelFor
+struct workRange
+{
+	std::mutex lock;
+	int next = 0;
+	int end = 0;
+};
+
+//move the upper half of the fullest other range into the empty range of the thief, false once all ranges are empty
+static bool stealWork(std::vector<workRange>& ranges, int thief)
+{
+	while (true)
+	{
+		int victim = -1;
+		int mostLeft = 0;
+		for (int i = 0; i < (int)ranges.size(); i++)
+		{
+			if (i == thief)
+			{
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(ranges[i].lock);
+			if (ranges[i].end - ranges[i].next > mostLeft)
+			{
+				mostLeft = ranges[i].end - ranges[i].next;
+				victim = i;
+			}
+		}
+		if (victim < 0)
+		{
+			return false;
+		}
+
+		int stolenFirst;
+		int stolenEnd;
+		{
+			std::lock_guard<std::mutex> lock(ranges[victim].lock);
+			int left = ranges[victim].end - ranges[victim].next;
+			if (left <= 0)	//emptied in the meantime, look for another victim
+			{
+				continue;
+			}
+			stolenEnd = ranges[victim].end;
+			stolenFirst = stolenEnd - (left + 1) / 2;
+			ranges[victim].end = stolenFirst;
+		}
+
+		std::lock_guard<std::mutex> lock(ranges[thief].lock);
+		ranges[thief].next = stolenFirst;
+		ranges[thief].end = stolenEnd;
+		return true;
+	}
+}
+
+threadPool::threadPool(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency();
+		threadCount = threadCount > 0 ? threadCount : 1;
+	}
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&threadPool::workerLoop, this);
+	}
+}
+
+threadPool::~threadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void threadPool::run(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void threadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobsDone.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void threadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+			if (jobs.empty())	//only reached when stopping
+			{
+				return;
+			}
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			activeJobs--;
+			if (jobs.empty() && activeJobs == 0)
+			{
+				jobsDone.notify_all();
+			}
+		}
+	}
+}
+
+void threadPool::parallelFor(int count, const std::function<void(int index)>& job)
+{
+	int workerCount = std::min(threadCount(), count);
+	if (workerCount <= 0)
+	{
+		return;
+	}
+
+	std::vector<workRange> ranges(workerCount);
+	for (int i = 0; i < workerCount; i++)
+	{
+		ranges[i].next = (int)((long long)count * i / workerCount);
+		ranges[i].end = (int)((long long)count * (i + 1) / workerCount);
+	}
+
+	std::mutex doneMutex;
+	std::condition_variable allDone;
+	int runningWorkers = workerCount;
+	for (int worker = 0; worker < workerCount; worker++)
+	{
+		run([&, worker]
+		{
+			while (true)
+			{
+				int index = -1;
+				{
+					std::lock_guard<std::mutex> lock(ranges[worker].lock);
+					if (ranges[worker].next < ranges[worker].end)
+					{
+						index = ranges[worker].next++;
+					}
+				}
+
+				if (index >= 0)
+				{
+					job(index);
+				}
+				else if (!stealWork(ranges, worker))
+				{
+					break;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if (--runningWorkers == 0)
+			{
+				allDone.notify_all();
+			}
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	allDone.wait(lock, [&] { return runningWorkers == 0; });
+}
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+//fixed number of worker threads executing queued jobs
+class threadPool
+{
+public:
+	threadPool(int threadCount = 0);	//0 uses one thread per hardware thread
+	~threadPool();
+
+	void run(std::function<void()> job);	//queue job for execution on a worker
+	void wait();	//block until the queue is empty and all workers are idle
+
+	//call job for every index in [0, count) and block until all calls returned
+	//every worker starts on its own contiguous share of the range and steals half of the largest remaining share once it runs out
+	//this must not be called from a job running on the same pool
+	void parallelFor(int count, const std::function<void(int index)>& job);
+	int threadCount() const { return (int)workers.size(); }
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobMutex;
+	std::condition_variable jobAvailable;	//signaled when a job is queued or the pool is stopped
+	std::condition_variable jobsDone;	//signaled when the last running job finished
+	int activeJobs = 0;
+	bool stopping = false;
+
+	void workerLoop();
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,179 @@
+#include "UniformBuffer.h"
+#include "GLState.h"
+
+#include <iostream>
+#include <algorithm>
+
+bool uniformBlockLayout::reflect(unsigned int program, const char* blockName)
+{
+	blockMembers.clear();
+	dataSize = 0;
+
+	unsigned int blockIndex = glGetUniformBlockIndex(program, blockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		std::cout << "ERROR: uniform block " << blockName << " is not active in program " << program << std::endl;
+		return false;
+	}
+
+	int blockSize = 0;
+	int memberCount = 0;
+	glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);	//includes the std140 padding
+	glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+	dataSize = blockSize;
+
+	std::vector<int> indices(memberCount);
+	glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+	//query the layout of all members at once
+	std::vector<GLuint> uniformIndices(indices.begin(), indices.end());
+	std::vector<int> offsets(memberCount), types(memberCount), arraySizes(memberCount), arrayStrides(memberCount), matrixStrides(memberCount);
+	glGetActiveUniformsiv(program, memberCount, uniformIndices.data(), GL_UNIFORM_OFFSET, offsets.data());
+	glGetActiveUniformsiv(program, memberCount, uniformIndices.data(), GL_UNIFORM_TYPE, types.data());
+	glGetActiveUniformsiv(program, memberCount, uniformIndices.data(), GL_UNIFORM_SIZE, arraySizes.data());
+	glGetActiveUniformsiv(program, memberCount, uniformIndices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+	glGetActiveUniformsiv(program, memberCount, uniformIndices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+
+	int maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<char> nameBuffer(maxNameLength + 1);
+
+	for (int i = 0; i < memberCount; i++)
+	{
+		int nameLength = 0;
+		glGetActiveUniformName(program, uniformIndices[i], (GLsizei)nameBuffer.size(), &nameLength, nameBuffer.data());
+
+		uniformBlockMember member;
+		member.name.assign(nameBuffer.data(), nameLength);
+		member.type = (GLenum)types[i];
+		member.offset = offsets[i];
+		member.arraySize = arraySizes[i];
+		member.arrayStride = arrayStrides[i];
+		member.matrixStride = matrixStrides[i];
+		blockMembers.push_back(member);
+	}
+	return true;
+}
+
+int uniformBlockLayout::offset(const std::string& member) const
+{
+	const uniformBlockMember* entry = find(member);
+	return entry ? entry->offset : -1;
+}
+
+int uniformBlockLayout::offset(const std::string& member, int index) const
+{
+	const uniformBlockMember* entry = find(member);
+	return entry && index >= 0 && index < entry->arraySize ? entry->offset + index * entry->arrayStride : -1;
+}
+
+const uniformBlockMember* uniformBlockLayout::find(const std::string& member) const
+{
+	for (const uniformBlockMember& entry : blockMembers)
+	{
+		//arrays are reported as name[0]
+		if (entry.name == member || (entry.arrayStride > 0 && entry.name.size() == member.size() + 3 && entry.name.compare(0, member.size(), member) == 0))
+		{
+			return &entry;
+		}
+	}
+	return NULL;
+}
+
+uniformRing::uniformRing(size_t frameSize) : frameUsed(0)
+{
+	int alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	offsetAlignment = alignment > 0 ? alignment : 256;
+	segmentSize = (frameSize + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+	size_t bufferSize = segmentSize * segmentCount;
+
+	glGenBuffers(1, &buffer);
+	glState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+	if (GLAD_GL_VERSION_4_4)	//map the buffer once and keep it mapped
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, bufferSize, NULL, flags);
+		mappedData = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, bufferSize, flags);
+	}
+	else
+	{
+		glBufferData(GL_UNIFORM_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+		shadowData.resize(segmentSize);
+	}
+}
+
+uniformRing::~uniformRing()
+{
+	for (GLsync fence : segmentFences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (mappedData)
+	{
+		glState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+
+	glDeleteBuffers(1, &buffer);
+	glState().bufferDeleted(buffer);
+}
+
+void uniformRing::beginFrame()
+{
+	//wait until the GPU has finished reading this segment
+	if (segmentFences[segment])
+	{
+		glClientWaitSync(segmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(segmentFences[segment]);
+		segmentFences[segment] = 0;
+	}
+	frameUsed.store(0, std::memory_order_relaxed);
+	flushedUpTo = 0;
+}
+
+uniformAllocation uniformRing::allocate(size_t size)
+{
+	uniformAllocation allocation;
+	size_t alignedSize = (size + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+	size_t offset = frameUsed.fetch_add(alignedSize, std::memory_order_relaxed);
+	if (offset + alignedSize > segmentSize)	//segment is full
+	{
+		return allocation;
+	}
+
+	allocation.data = mappedData ? mappedData + segment * segmentSize + offset : shadowData.data() + offset;
+	allocation.buffer = buffer;
+	allocation.offset = segment * segmentSize + offset;
+	allocation.size = size;
+	return allocation;
+}
+
+void uniformRing::flush()
+{
+	if (mappedData)	//coherent mapping, writes are visible to the next draw
+	{
+		return;
+	}
+
+	//upload everything allocated since the last flush with one call
+	size_t usedBytes = std::min(used(), segmentSize);
+	if (usedBytes > flushedUpTo)
+	{
+		glState().bindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, segment * segmentSize + flushedUpTo, usedBytes - flushedUpTo, shadowData.data() + flushedUpTo);
+		flushedUpTo = usedBytes;
+	}
+}
+
+void uniformRing::endFrame()
+{
+	segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);	//signaled once the GPU is done with this segment
+	segment = (segment + 1) % segmentCount;
+}
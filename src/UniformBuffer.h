@@ -0,0 +1,91 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstring>
+
+//member of a uniform block as laid out by the linked program
+struct uniformBlockMember
+{
+	std::string name;
+	GLenum type;
+	int offset;	//byte offset from the start of the block
+	int arraySize;
+	int arrayStride;	//0 if the member is not an array
+	int matrixStride;	//0 if the member is not a matrix
+};
+
+//layout of a std140 uniform block reflected from a linked program
+//the layout has to be reflected again if the program is reloaded
+class uniformBlockLayout
+{
+public:
+	bool reflect(unsigned int program, const char* blockName);	//returns false if the program has no active block with that name
+
+	int offset(const std::string& member) const;	//byte offset of member, -1 if the block has no such member
+	int offset(const std::string& member, int index) const;	//byte offset of an element of an array member, -1 if there is no such element
+	size_t size() const { return dataSize; }
+	const std::vector<uniformBlockMember>& members() const { return blockMembers; }
+
+private:
+	std::vector<uniformBlockMember> blockMembers;
+	size_t dataSize = 0;
+
+	const uniformBlockMember* find(const std::string& member) const;
+};
+
+//copy a value into block memory at an offset from uniformBlockLayout::offset, negative offsets and failed allocations are ignored
+template<typename T>
+inline void writeUniform(void* block, int offset, const T& value)
+{
+	if (block && offset >= 0)
+	{
+		memcpy((char*)block + offset, &value, sizeof(T));
+	}
+}
+
+//range of the uniform ring holding the data of one draw
+struct uniformAllocation
+{
+	void* data = NULL;	//write the block here, NULL if the ring is full
+	unsigned int buffer = 0;
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+//ring buffer of uniform block data, split into one segment per frame in flight
+//draws sub-allocate their block data with allocate and bind it with glBindBufferRange, a fence per segment keeps the CPU from overwriting data the GPU still reads
+class uniformRing
+{
+public:
+	uniformRing(size_t frameSize = 4 * 1024 * 1024);	//bytes available per frame
+	~uniformRing();
+
+	void beginFrame();	//wait until the GPU is done with the segment of this frame
+	uniformAllocation allocate(size_t size);	//thread safe, aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	void flush();	//make all allocations of this frame visible to GL, has to be called before drawing
+	void endFrame();	//fence the segment of this frame
+
+	size_t used() const { return frameUsed.load(std::memory_order_relaxed); }
+	size_t alignment() const { return offsetAlignment; }
+
+private:
+	static const int segmentCount = 3;
+
+	size_t segmentSize;
+	size_t offsetAlignment;
+	unsigned int buffer;
+	unsigned char* mappedData = NULL;	//persistent mapping of the whole buffer, NULL if buffer storage is not supported
+	std::vector<unsigned char> shadowData;	//CPU copy of the current segment used without persistent mapping
+	GLsync segmentFences[segmentCount] = {};
+	int segment = 0;	//segment used by the current frame
+	std::atomic<size_t> frameUsed;
+	size_t flushedUpTo = 0;	//bytes of the current segment already uploaded
+};
+
+#endif // !UNIFORM_BUFFER_H
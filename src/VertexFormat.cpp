@@ -0,0 +1,182 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+size_t attribTypeSize(attribType type)
+{
+	switch (type)
+	{
+	case attribType::float32:
+		return 4;
+	case attribType::half16:
+	case attribType::snorm16:
+	case attribType::unorm16:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+//GL type and normalization flag of an attribute type
+static void attribTypeInfo(attribType type, GLenum& glType, GLboolean& normalized)
+{
+	normalized = GL_TRUE;
+	switch (type)
+	{
+	case attribType::float32:
+		glType = GL_FLOAT;
+		normalized = GL_FALSE;
+		break;
+	case attribType::half16:
+		glType = GL_HALF_FLOAT;
+		normalized = GL_FALSE;
+		break;
+	case attribType::snorm16:
+		glType = GL_SHORT;
+		break;
+	case attribType::unorm16:
+		glType = GL_UNSIGNED_SHORT;
+		break;
+	case attribType::snorm8:
+		glType = GL_BYTE;
+		break;
+	default:
+		glType = GL_UNSIGNED_BYTE;
+		break;
+	}
+}
+
+vertexFormat& vertexFormat::add(unsigned int location, int components, attribType type)
+{
+	vertexAttrib attrib;
+	attrib.location = location;
+	attrib.components = components;
+	attrib.type = type;
+	attrib.offset = vertexSize;
+	attribs.push_back(attrib);
+
+	//keep every attribute 4 byte aligned, unaligned attributes are slow or unsupported on some hardware
+	vertexSize += (components * attribTypeSize(type) + 3) & ~(size_t)3;
+	return *this;
+}
+
+vertexFormat& vertexFormat::setDivisor(unsigned int divisor)
+{
+	attribDivisor = divisor;
+	return *this;
+}
+
+void vertexFormat::apply(size_t bufferOffset) const
+{
+	for (const vertexAttrib& attrib : attribs)
+	{
+		GLenum glType;
+		GLboolean normalized;
+		attribTypeInfo(attrib.type, glType, normalized);
+
+		glVertexAttribPointer(attrib.location, attrib.components, glType, normalized, (GLsizei)vertexSize, (void*)(bufferOffset + attrib.offset));	//define how to interpret the vertex data of this attribute
+		glVertexAttribDivisor(attrib.location, attribDivisor);
+		glEnableVertexAttribArray(attrib.location);
+	}
+}
+
+//read one component as float
+static float readComponent(const unsigned char* data, attribType type)
+{
+	switch (type)
+	{
+	case attribType::float32:
+	{
+		float value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+	case attribType::half16:
+	{
+		glm::uint16 value;
+		memcpy(&value, data, sizeof(value));
+		return glm::unpackHalf1x16(value);
+	}
+	case attribType::snorm16:
+	{
+		glm::uint16 value;
+		memcpy(&value, data, sizeof(value));
+		return glm::unpackSnorm1x16(value);
+	}
+	case attribType::unorm16:
+	{
+		glm::uint16 value;
+		memcpy(&value, data, sizeof(value));
+		return glm::unpackUnorm1x16(value);
+	}
+	case attribType::snorm8:
+		return glm::unpackSnorm1x8(*data);
+	default:
+		return glm::unpackUnorm1x8(*data);
+	}
+}
+
+//write one component from float
+static void writeComponent(unsigned char* data, attribType type, float value)
+{
+	glm::uint16 packed16;
+	switch (type)
+	{
+	case attribType::float32:
+		memcpy(data, &value, sizeof(value));
+		return;
+	case attribType::half16:
+		packed16 = glm::packHalf1x16(value);
+		break;
+	case attribType::snorm16:
+		packed16 = glm::packSnorm1x16(value);
+		break;
+	case attribType::unorm16:
+		packed16 = glm::packUnorm1x16(value);
+		break;
+	case attribType::snorm8:
+		*data = glm::packSnorm1x8(value);
+		return;
+	default:
+		*data = glm::packUnorm1x8(value);
+		return;
+	}
+	memcpy(data, &packed16, sizeof(packed16));
+}
+
+std::vector<unsigned char> convertVertices(const void* vertices, size_t vertexCount, const vertexFormat& sourceFormat, const vertexFormat& targetFormat)
+{
+	std::vector<unsigned char> converted(vertexCount * targetFormat.stride(), 0);
+	const unsigned char* source = (const unsigned char*)vertices;
+
+	for (const vertexAttrib& target : targetFormat.attributes())
+	{
+		//find source attribute with the same location
+		const vertexAttrib* match = NULL;
+		for (const vertexAttrib& attrib : sourceFormat.attributes())
+		{
+			if (attrib.location == target.location)
+			{
+				match = &attrib;
+			}
+		}
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const unsigned char* sourceVertex = source + i * sourceFormat.stride();
+			unsigned char* targetVertex = converted.data() + i * targetFormat.stride();
+
+			for (int c = 0; c < target.components; c++)
+			{
+				float value = c == 3 ? 1.0f : 0.0f;
+				if (match && c < match->components)
+				{
+					value = readComponent(sourceVertex + match->offset + c * attribTypeSize(match->type), match->type);
+				}
+				writeComponent(targetVertex + target.offset + c * attribTypeSize(target.type), target.type, value);
+			}
+		}
+	}
+	return converted;
+}
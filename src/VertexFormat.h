@@ -0,0 +1,54 @@
+#pragma once
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstddef>
+
+//storage type of a vertex attribute component
+enum class attribType
+{
+	float32,	//32 bit float
+	half16,	//16 bit float
+	snorm16,	//signed 16 bit integer mapped to [-1, 1]
+	unorm16,	//unsigned 16 bit integer mapped to [0, 1]
+	snorm8,	//signed 8 bit integer mapped to [-1, 1]
+	unorm8	//unsigned 8 bit integer mapped to [0, 1]
+};
+
+//attribute of a vertex format
+struct vertexAttrib
+{
+	unsigned int location;	//layout location in the vertex shader
+	int components;
+	attribType type;
+	size_t offset;	//byte offset inside of a vertex
+};
+
+//describes the layout of an interleaved vertex and sets up the matching attribute pointers
+class vertexFormat
+{
+public:
+	vertexFormat& add(unsigned int location, int components, attribType type);	//append attribute, offsets are padded to 4 bytes
+	vertexFormat& setDivisor(unsigned int divisor);	//advance all attributes once per divisor instances instead of once per vertex
+	void apply(size_t bufferOffset = 0) const;	//set attribute pointers of the bound vertex array for the bound GL_ARRAY_BUFFER
+
+	size_t stride() const { return vertexSize; }
+	unsigned int divisor() const { return attribDivisor; }
+	const std::vector<vertexAttrib>& attributes() const { return attribs; }
+
+private:
+	std::vector<vertexAttrib> attribs;
+	size_t vertexSize = 0;
+	unsigned int attribDivisor = 0;	//0 for per vertex data
+};
+
+size_t attribTypeSize(attribType type);	//size of a single component in bytes
+
+//convert vertices from one format into another, attributes are matched by location
+//components missing in the source are filled like GL does for missing attribute components (0, 0, 0, 1)
+std::vector<unsigned char> convertVertices(const void* vertices, size_t vertexCount, const vertexFormat& sourceFormat, const vertexFormat& targetFormat);
+
+#endif // !VERTEX_FORMAT_H